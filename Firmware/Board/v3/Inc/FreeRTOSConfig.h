@@ -168,6 +168,21 @@ standard names. */
 /* USER CODE BEGIN Defines */   	      
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
 #define configAPPLICATION_ALLOCATED_HEAP 1 // ucHeap allocated in freertos.c
+
+/* Per-thread CPU load (see vApplicationIdleHook() in main.cpp). The time base
+is the cycle counter minus the time spent in the control interrupts and is set
+up in system_init(). */
+#define configUSE_TRACE_FACILITY                 1
+#define configGENERATE_RUN_TIME_STATS            1
+#define INCLUDE_xTaskGetIdleTaskHandle           1
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+    #ifdef __cplusplus
+    extern "C"
+    #endif
+    uint32_t get_run_time_counter(void); // defined in board.cpp
+#endif
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()         get_run_time_counter()
 /* USER CODE END Defines */ 
 
 #endif /* FREERTOS_CONFIG_H */
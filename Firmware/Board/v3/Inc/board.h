@@ -67,6 +67,13 @@
 
 #define TIM_TIME_BASE TIM14
 
+// Flash sectors reserved for the black box recorder (see STM32F405RGTx_FLASH.ld)
+#define BLACK_BOX_SECTOR_A FLASH_SECTOR_8
+#define BLACK_BOX_SECTOR_A_BASE 0x08080000UL
+#define BLACK_BOX_SECTOR_B FLASH_SECTOR_9
+#define BLACK_BOX_SECTOR_B_BASE 0x080A0000UL
+#define BLACK_BOX_SECTOR_SIZE 0x20000UL
+
 // Run control loop at the same frequency as the current measurements.
 #define CONTROL_TIMER_PERIOD_TICKS  (2 * TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1))
 
@@ -15,9 +15,6 @@
 #include <usart.h>
 #include <freertos_vars.h>
 
-// this should technically be in task_timer.cpp but let's not make a one-line file
-bool TaskTimer::enabled = false;
-
 extern "C" void SystemClock_Config(void); // defined in main.c generated by CubeMX
 
 #define ControlLoop_IRQHandler OTG_HS_IRQHandler
@@ -276,6 +273,12 @@ void system_init() {
     // Configure the system clock
     SystemClock_Config();
 
+    // Enable the cycle counter. It is the time base of the CPU load
+    // measurements and the FreeRTOS run time stats.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     // If the OTP is pristine, use the fake-otp in RAM instead
     const uint8_t* otp_ptr = (const uint8_t*)FLASH_OTP_BASE;
     if (*otp_ptr == 0xff) {
@@ -321,6 +324,13 @@ bool board_init() {
     HAL_NVIC_SetPriority(EXTI15_10_IRQn, 1, 0);
     HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
 
+    // The encoder timers only enable their capture interrupt while the
+    // encoder uses edge timing
+    HAL_NVIC_SetPriority(TIM3_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(TIM3_IRQn);
+    HAL_NVIC_SetPriority(TIM4_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(TIM4_IRQn);
+
     HAL_NVIC_SetPriority(ControlLoop_IRQn, 5, 0);
     HAL_NVIC_EnableIRQ(ControlLoop_IRQn);
 
@@ -466,6 +476,16 @@ void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
     }
 }
 
+void TIM3_IRQHandler(void) {
+    COUNT_IRQ(TIM3_IRQn);
+    encoders[0].enc_edge_cb();
+}
+
+void TIM4_IRQHandler(void) {
+    COUNT_IRQ(TIM4_IRQn);
+    encoders[1].enc_edge_cb();
+}
+
 void TIM5_IRQHandler(void) {
     COUNT_IRQ(TIM5_IRQn);
     pwm0_input.on_capture();
@@ -474,7 +494,22 @@ void TIM5_IRQHandler(void) {
 volatile uint32_t timestamp_ = 0;
 volatile bool counting_down_ = false;
 
+// The TIM1/TIM8 clock is the same as the CPU clock so the control period can
+// be compared directly to the cycle counter.
+static_assert(TIM_1_8_CLOCK_HZ == 168000000, "CPU load measurement assumes TIM_1_8_CLOCK_HZ == CPU clock");
+uint32_t control_isr_start_ = 0; // [cycles] entry into the TIM8 update interrupt that kicked off the current control loop
+volatile uint32_t control_isr_cycles_ = 0; // [cycles] total time spent in the control interrupts (wraps around)
+
+// FreeRTOS run time counter. The control interrupts are excluded so that they
+// don't count towards the thread that happened to be interrupted. This is only
+// read from thread context and from PendSV, both of which never run while the
+// control interrupts are in progress.
+uint32_t get_run_time_counter(void) {
+    return DWT->CYCCNT - control_isr_cycles_;
+}
+
 void TIM8_UP_TIM13_IRQHandler(void) {
+    uint32_t isr_start = DWT->CYCCNT;
     COUNT_IRQ(TIM8_UP_TIM13_IRQn);
     
     // Entry into this function happens at 21-23 clock cycles after the timer
@@ -496,6 +531,12 @@ void TIM8_UP_TIM13_IRQHandler(void) {
     timestamp_ += TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1);
 
     if (!counting_down) {
+        // The control loop of the previous period must be done by now
+        if (NVIC_GetActive(ControlLoop_IRQn)) {
+            odrv.task_times_.control_loop.overruns_++;
+        }
+
+        control_isr_start_ = isr_start;
         TaskTimer::enabled = odrv.task_timers_armed_;
         // Run sampling handlers and kick off control tasks when TIM8 is
         // counting up.
@@ -517,6 +558,7 @@ void TIM8_UP_TIM13_IRQHandler(void) {
 
 void ControlLoop_IRQHandler(void) {
     COUNT_IRQ(ControlLoop_IRQn);
+    uint32_t control_loop_start = odrv.task_times_.control_loop.start();
     uint32_t timestamp = timestamp_;
 
     // Ensure that all the ADCs are done
@@ -562,6 +604,8 @@ void ControlLoop_IRQHandler(void) {
     motors[0].pwm_update_cb(timestamp + 3 * TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1) - TIM1_INIT_COUNT);
     motors[1].pwm_update_cb(timestamp + 3 * TIM_1_8_PERIOD_CLOCKS * (TIM_1_8_RCR + 1));
 
+    odrv.task_times_.control_loop.stop(control_loop_start);
+
     // If we did everything right, the TIM8 update handler should have been
     // called exactly once between the start of this function and now.
 
@@ -572,6 +616,11 @@ void ControlLoop_IRQHandler(void) {
 
     odrv.task_timers_armed_ = odrv.task_timers_armed_ && !TaskTimer::enabled;
     TaskTimer::enabled = false;
+
+    uint32_t busy = DWT->CYCCNT - control_isr_start_;
+    control_isr_cycles_ += busy;
+    uint32_t window = std::min(odrv.config_.cpu_load_window, (uint32_t)25000) * (TIM_1_8_CLOCK_HZ / 1000);
+    odrv.system_stats_.control_isr.push(busy, CONTROL_TIMER_PERIOD_TICKS, window);
 }
 
 void I2C1_EV_IRQHandler(void) {
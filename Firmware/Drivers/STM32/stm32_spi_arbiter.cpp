@@ -60,25 +60,65 @@ bool Stm32SpiArbiter::start() {
     return status == HAL_OK;
 }
 
+static bool is_expired(const Stm32SpiArbiter::SpiTask& task) {
+    return task.deadline.has_value() && (int32_t)(DWT->CYCCNT - *task.deadline) > 0;
+}
+
+// Whether the new task a goes ahead of the queued task b
+static bool goes_before(const Stm32SpiArbiter::SpiTask& a, const Stm32SpiArbiter::SpiTask& b) {
+    if (a.priority != b.priority) {
+        return a.priority > b.priority;
+    }
+    return a.deadline.has_value()
+        && (!b.deadline.has_value() || (int32_t)(*a.deadline - *b.deadline) < 0);
+}
+
+// Starts the task at the head of the list, which must not be started yet.
+// Tasks that are past their deadline or fail to start are completed
+// unsuccessfully and removed.
+void Stm32SpiArbiter::start_queue(SpiTask* task) {
+    while (task) {
+        if (!is_expired(*task) && start()) {
+            return;
+        }
+        // If the list runs empty, a new task starts itself in transfer_async()
+        SpiTask* next = nullptr;
+        CRITICAL_SECTION() {
+            next = task_list_ = task->next;
+        }
+        if (task->on_complete) {
+            (*task->on_complete)(task->on_complete_ctx, false);
+        }
+        task = next;
+    }
+}
+
 void Stm32SpiArbiter::transfer_async(SpiTask* task) {
-    task->next = nullptr;
-    
-    // Append new task to task list.
+    // Insert new task into the task list. The head of the list is the
+    // transfer in progress, if any.
     // We could try to do this lock free but we could also use our time for useful things.
     SpiTask** ptr = &task_list_;
+    uint32_t length = 1;
     CRITICAL_SECTION() {
-        while (*ptr)
+        if (*ptr) {
+            ptr = &(*ptr)->next;
+            length++;
+        }
+        while (*ptr && !goes_before(*task, **ptr)) {
             ptr = &(*ptr)->next;
+            length++;
+        }
+        task->next = *ptr;
         *ptr = task;
+        for (SpiTask* t = task->next; t; t = t->next) {
+            length++;
+        }
+        max_queue_length_ = std::max(max_queue_length_, length);
     }
 
     // If the list was empty before, kick off the SPI arbiter now
     if (ptr == &task_list_) {
-        if (!start()) {
-            if (task->on_complete) {
-                (*task->on_complete)(task->on_complete_ctx, false);
-            }
-        }
+        start_queue(task);
     }
 }
 
@@ -94,6 +134,8 @@ bool Stm32SpiArbiter::transfer(SPI_InitTypeDef config, Stm32Gpio ncs_gpio, const
         .length = length,
         .on_complete = [](void* ctx, bool success) { *(volatile uint8_t*)ctx = success ? 1 : 0; },
         .on_complete_ctx = (void*)&result,
+        .priority = 0,
+        .deadline = std::nullopt,
         .is_in_use = false,
         .next = nullptr
     };
@@ -123,7 +165,5 @@ void Stm32SpiArbiter::on_complete() {
     CRITICAL_SECTION() {
         next = task_list_ = task_list_->next;
     }
-    if (next) {
-        start();
-    }
+    start_queue(next);
 }
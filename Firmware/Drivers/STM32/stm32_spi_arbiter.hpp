@@ -4,6 +4,7 @@
 #include "stm32_gpio.hpp"
 
 #include <spi.h>
+#include <optional>
 
 class Stm32SpiArbiter {
 public:
@@ -15,6 +16,8 @@ public:
         size_t length;
         void (*on_complete)(void*, bool);
         void* on_complete_ctx;
+        uint8_t priority = 0; // tasks with a higher priority are started first
+        std::optional<uint32_t> deadline = std::nullopt; // [DWT cycles] the task is dropped if it can't start by then
         bool is_in_use = false;
         struct SpiTask* next;
     };
@@ -49,6 +52,11 @@ public:
      * 
      * Once the transfer completes, fails or is aborted, the callback is invoked.
      * 
+     * The transfer in progress is never interrupted. Behind it, the queue is
+     * ordered by priority, then by deadline (earliest first), then by
+     * submission. A task that is past its deadline when it's due to start
+     * completes unsuccessfully without a transfer.
+     * 
      * This function is thread-safe with respect to all other public functions
      * of this class.
      * 
@@ -84,8 +92,11 @@ public:
      */
     void on_complete();
 
+    uint32_t max_queue_length_ = 0; // high-water mark of enqueued tasks, including the active one
+
 private:
     bool start();
+    void start_queue(SpiTask* task);
     
     SPI_HandleTypeDef* hspi_;
     SpiTask* task_list_ = nullptr;
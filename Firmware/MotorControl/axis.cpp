@@ -145,6 +145,14 @@ void Axis::set_step_dir_active(bool active) {
     }
 }
 
+// @brief Sets error bits and records the new ones in the journal
+void Axis::set_error(Error error) {
+    if (error & ~error_) {
+        odrv.journal_.log(Journal::JOURNAL_ENTRY_TYPE_AXIS_ERROR, axis_num_, error, current_state_);
+    }
+    error_ |= error;
+}
+
 // @brief Do axis level checks and call subcomponent do_checks
 // Returns true if everything is ok.
 bool Axis::do_checks(uint32_t timestamp) {
@@ -154,9 +162,9 @@ bool Axis::do_checks(uint32_t timestamp) {
 
     // Check for endstop presses
     if (min_endstop_.config_.enabled && min_endstop_.rose() && !(current_state_ == AXIS_STATE_HOMING)) {
-        error_ |= ERROR_MIN_ENDSTOP_PRESSED;
+        set_error(ERROR_MIN_ENDSTOP_PRESSED);
     } else if (max_endstop_.config_.enabled && max_endstop_.rose() && !(current_state_ == AXIS_STATE_HOMING)) {
-        error_ |= ERROR_MAX_ENDSTOP_PRESSED;
+        set_error(ERROR_MAX_ENDSTOP_PRESSED);
     }
 
     return check_for_errors();
@@ -176,7 +184,7 @@ bool Axis::watchdog_check() {
         watchdog_current_value_--;
         return true;
     } else {
-        error_ |= ERROR_WATCHDOG_TIMER_EXPIRED;
+        set_error(ERROR_WATCHDOG_TIMER_EXPIRED);
         return false;
     }
 }
@@ -275,7 +283,7 @@ bool Axis::start_closed_loop_control() {
             Axis* ax = &axes[controller_.config_.load_encoder_axis];
             controller_.pos_estimate_circular_src_.connect_to(&ax->encoder_.pos_circular_);
             controller_.pos_wrap_src_.connect_to(&controller_.config_.circular_setpoint_range);
-            controller_.pos_estimate_linear_src_.connect_to(&ax->encoder_.pos_estimate_);
+            controller_.pos_estimate_linear_src_.connect_to(&ax->encoder_.pos_estimate_turns_);
             controller_.vel_estimate_src_.connect_to(&ax->encoder_.vel_estimate_);
         } else {
             controller_.pos_estimate_circular_src_.disconnect();
@@ -289,16 +297,15 @@ bool Axis::start_closed_loop_control() {
         // To avoid any transient on startup, we intialize the setpoint to be the current position
         // note - input_pos_ is not set here. It is set to 0 earlier in this method and velocity control is used.
         if (controller_.config_.control_mode >= Controller::CONTROL_MODE_POSITION_CONTROL) {
-            std::optional<float> pos_init = (controller_.config_.circular_setpoints ?
-                                    controller_.pos_estimate_circular_src_ :
-                                    controller_.pos_estimate_linear_src_).any();
+            std::optional<Position> pos_init = controller_.config_.circular_setpoints ?
+                                    controller_.pos_estimate_circular_src_.any() :
+                                    controller_.pos_estimate_linear_src_.any();
             if (!pos_init.has_value()) {
                 return false;
             } else {
-                controller_.pos_setpoint_ = *pos_init;
-                controller_.input_pos_ = *pos_init;
+                controller_.set_input_pos_and_setpoint(*pos_init, *pos_init);
                 float range = controller_.config_.circular_setpoint_range;
-                steps_ = (int64_t)(fmodf_pos(*pos_init, range) / range * controller_.config_.steps_per_circular_range);
+                steps_ = (int64_t)(fmodf_pos(pos_init->to_float(), range) / range * controller_.config_.steps_per_circular_range);
             }
         }
         controller_.input_pos_updated();
@@ -373,19 +380,25 @@ bool Axis::run_homing() {
     // TODO: theoretically this check should be inside the update loop,
     // otherwise someone could disable the endstop while homing is in progress.
     if (!min_endstop_.config_.enabled) {
-        return error_ |= ERROR_HOMING_WITHOUT_ENDSTOP, false;
+        set_error(ERROR_HOMING_WITHOUT_ENDSTOP);
+        return false;
     }
 
     controller_.config_.control_mode = Controller::CONTROL_MODE_VELOCITY_CONTROL;
     controller_.config_.input_mode = Controller::INPUT_MODE_VEL_RAMP;
 
-    controller_.input_pos_ = 0.0f;
-    controller_.input_pos_updated();
+    controller_.set_input_pos(0.0f);
     controller_.input_vel_ = -controller_.config_.homing_speed;
     controller_.input_torque_ = 0.0f;
 
     homing_.is_homed = false;
 
+    // The home position is derived from the encoder count that is latched at
+    // the moment the endstop (or index) triggers, not from the position where
+    // the axis eventually comes to a stop. Therefore we don't need to creep
+    // into the endstop slowly.
+    min_endstop_.arm_latch();
+
     start_closed_loop_control();
 
     // Driving toward the endstop
@@ -393,38 +406,76 @@ bool Axis::run_homing() {
         osDelay(1);
     }
 
-    stop_closed_loop_control();
-    
-    controller_.input_vel_ = 0.0f;
+    std::optional<int32_t> home_count = min_endstop_.get_latched_count();
+    min_endstop_.disarm_latch();
+
+    // Keep going until the next index pulse, which must show up within one
+    // turn past the endstop
+    if (min_endstop_.config_.home_on_index && home_count.has_value()) {
+        uint32_t endstop_count = (uint32_t)*home_count;
+        home_count = std::nullopt;
+        if (!encoder_.arm_index_latch()) {
+            odrv.misconfigured_ = true;
+        } else {
+            while ((requested_state_ == AXIS_STATE_UNDEFINED) && motor_.is_armed_
+                   && !(home_count = encoder_.get_index_latched_count()).has_value()) {
+                int32_t distance = (int32_t)((uint32_t)encoder_.get_shadow_count() - endstop_count);
+                if (std::abs(distance) > encoder_.config_.cpr) {
+                    encoder_.set_error(Encoder::ERROR_INDEX_NOT_FOUND_YET);
+                    break;
+                }
+                osDelay(1);
+            }
+        }
+        encoder_.disarm_index_latch();
+    }
 
     error_ &= ~ERROR_MIN_ENDSTOP_PRESSED; // clear this error since we deliberately drove into the endstop
 
-    std::optional<float> pos_estimate_local = encoder_.pos_estimate_.any();
-    if (pos_estimate_local == std::nullopt || !pos_estimate_local.has_value()){
-        return error_ |= ERROR_UNKNOWN_POSITION, false;
+    // Position is not written atomically by the control loop
+    std::optional<Position> pos_estimate_local;
+    int64_t shadow_count;
+    CRITICAL_SECTION() {
+        pos_estimate_local = encoder_.pos_estimate_turns_.any();
+        shadow_count = encoder_.shadow_count_;
+    }
+    if (!home_count.has_value() || !pos_estimate_local.has_value()) {
+        stop_closed_loop_control();
+        controller_.input_vel_ = 0.0f;
+        controller_.config_.control_mode = stored_control_mode;
+        controller_.config_.input_mode = stored_input_mode;
+        if (requested_state_ == AXIS_STATE_UNDEFINED && motor_.is_armed_) {
+            set_error(ERROR_UNKNOWN_POSITION);
+        }
+        return false;
+    }
+
+    // The latched counts are the lower 32 bits of the encoder count
+    int64_t home_count_64 = shadow_count + (int32_t)((uint32_t)*home_count - (uint32_t)shadow_count);
+    Position home_pos = Position::from_count(home_count_64).divide(encoder_.config_.cpr) + min_endstop_.config_.offset;
+
+    // Decelerate and move to the home position in a single trapezoidal
+    // move, starting from the current velocity.
+    CRITICAL_SECTION() {
+        controller_.input_vel_ = 0.0f;
+        controller_.config_.control_mode = Controller::CONTROL_MODE_POSITION_CONTROL;
+        controller_.config_.input_mode = Controller::INPUT_MODE_TRAP_TRAJ;
+        controller_.set_input_pos_and_setpoint(home_pos, pos_estimate_local.value());
     }
-    
-    controller_.config_.control_mode = Controller::CONTROL_MODE_POSITION_CONTROL;
-    controller_.config_.input_mode = Controller::INPUT_MODE_TRAP_TRAJ;
 
-    // Initialize closed loop control, and then set the desired location.
-    start_closed_loop_control();
-    
-    controller_.input_pos_ = pos_estimate_local.value() + min_endstop_.config_.offset;
-    controller_.pos_setpoint_ = pos_estimate_local.value();
-    controller_.vel_setpoint_ = 0.0f;
-    controller_.input_pos_updated();
-    
     while ((requested_state_ == AXIS_STATE_UNDEFINED) && motor_.is_armed_ && !controller_.trajectory_done_) {
         osDelay(1);
     }
 
     stop_closed_loop_control();
 
-    // Set the current position to 0.
-    encoder_.set_linear_count(0);
-    controller_.input_pos_ = 0;
-    controller_.input_pos_updated();
+    // Set the home position to 0. This is relative to the latched count, so
+    // any tracking error at standstill doesn't affect the result.
+    CRITICAL_SECTION() {
+        encoder_.set_linear_count((int32_t)(encoder_.shadow_count_ - home_count_64
+                - (int64_t)std::round(min_endstop_.config_.offset * (float)encoder_.config_.cpr)));
+    }
+    controller_.set_input_pos(0.0f);
 
     controller_.config_.control_mode = stored_control_mode;
     controller_.config_.input_mode = stored_input_mode;
@@ -433,6 +484,85 @@ bool Axis::run_homing() {
     return check_for_errors();
 }
 
+// Excites the mechanism with a torque relay, identifies its inertia and
+// friction and derives the controller gains and inertia feedforward from it.
+bool Axis::run_autotune() {
+    const AutotuneConfig_t& config = config_.autotune;
+    Controller::ControlMode stored_control_mode = controller_.config_.control_mode;
+    Controller::InputMode stored_input_mode = controller_.config_.input_mode;
+
+    // The controller keeps running while its output is not used. Zero torque
+    // keeps it from winding up and from tripping the spinout detection.
+    controller_.config_.control_mode = Controller::CONTROL_MODE_TORQUE_CONTROL;
+    controller_.config_.input_mode = Controller::INPUT_MODE_PASSTHROUGH;
+    controller_.input_torque_ = 0.0f;
+
+    bool started = start_closed_loop_control();
+    if (started) {
+        CRITICAL_SECTION() {
+            mechanical_identifier_.start(config.torque, config.vel, config.n_cycles,
+                    config.min_duration, current_meas_period);
+            motor_.torque_setpoint_src_.connect_to(&autotune_torque_);
+        }
+
+        uint32_t timeout_ms = (uint32_t)(config.timeout * 1000.0f);
+        for (uint32_t t = 0; t < timeout_ms && mechanical_identifier_.running(); ++t) {
+            if ((requested_state_ != AXIS_STATE_UNDEFINED) || !motor_.is_armed_) {
+                break;
+            }
+            osDelay(1);
+        }
+    }
+
+    bool interrupted = (requested_state_ != AXIS_STATE_UNDEFINED) || !motor_.is_armed_;
+    mechanical_identifier_.stop();
+    stop_closed_loop_control();
+    controller_.config_.control_mode = stored_control_mode;
+    controller_.config_.input_mode = stored_input_mode;
+
+    if (!started) {
+        return false;
+    }
+
+    MechanicalIdentifier::Result_t result;
+    if (!mechanical_identifier_.done() || !mechanical_identifier_.solve(&result)) {
+        if (!interrupted) {
+            set_error(ERROR_AUTOTUNE_FAILED);
+        }
+        return false;
+    }
+
+    float vel_gain, vel_integrator_gain;
+    MechanicalIdentifier::compute_gains(result, config.bandwidth, config.phase_margin,
+            &vel_gain, &vel_integrator_gain);
+
+    autotune_.inertia = result.inertia;
+    autotune_.viscous_friction = result.viscous_friction;
+    autotune_.coulomb_friction = result.coulomb_friction;
+    controller_.config_.inertia = result.inertia;
+    controller_.config_.viscous_friction = result.viscous_friction;
+    controller_.config_.vel_gain = vel_gain;
+    controller_.config_.vel_integrator_gain = vel_integrator_gain;
+    controller_.config_.pos_gain = 0.25f * config.bandwidth;
+
+    return check_for_errors();
+}
+
+// Called by the control loop. Runs the relay of run_autotune().
+void Axis::update_autotune() {
+    if (current_state_ != AXIS_STATE_AUTOTUNE) {
+        return;
+    }
+
+    std::optional<float> vel_estimate = controller_.vel_estimate_src_.present();
+    if (!vel_estimate.has_value()) {
+        return; // the motor fails due to the missing torque setpoint
+    }
+
+    float torque = motor_.direction_ * motor_.config_.torque_constant * motor_.current_control_.Iq_measured_;
+    autotune_torque_ = mechanical_identifier_.update(torque, *vel_estimate);
+}
+
 bool Axis::run_idle_loop() {
     last_drv_fault_ = motor_.gate_driver_.get_error();
     mechanical_brake_.engage();
@@ -481,6 +611,7 @@ void Axis::run_state_machine_loop() {
         }
 
         // Note that current_state is a reference to task_chain_[0]
+        odrv.journal_.log(Journal::JOURNAL_ENTRY_TYPE_STATE_CHANGE, axis_num_, error_, current_state_);
 
         // Run the specified state
         // Handlers should exit if requested_state != AXIS_STATE_UNDEFINED
@@ -536,6 +667,13 @@ void Axis::run_state_machine_loop() {
                 status = encoder_.run_hall_phase_calibration();
             } break;
 
+            case AXIS_STATE_ENCODER_ECCENTRICITY_CALIBRATION: {
+                if (!motor_.is_calibrated_)
+                    goto invalid_state_label;
+
+                status = encoder_.run_eccentricity_calibration();
+            } break;
+
             case AXIS_STATE_HOMING: {
                 //if (odrv.any_error())
                 //    goto invalid_state_label;
@@ -567,6 +705,13 @@ void Axis::run_state_machine_loop() {
                 status = run_closed_loop_control_loop();
             } break;
 
+            case AXIS_STATE_AUTOTUNE: {
+                if (!motor_.is_calibrated_ || encoder_.config_.direction==0
+                        || motor_.config_.motor_type != Motor::MOTOR_TYPE_HIGH_CURRENT)
+                    goto invalid_state_label;
+                status = run_autotune();
+            } break;
+
             case AXIS_STATE_IDLE: {
                 run_idle_loop();
                 status = true;
@@ -574,7 +719,7 @@ void Axis::run_state_machine_loop() {
 
             default:
             invalid_state_label:
-                error_ |= ERROR_INVALID_STATE;
+                set_error(ERROR_INVALID_STATE);
                 status = false;  // this will set the state to idle
                 break;
         }
@@ -11,6 +11,7 @@ class Axis;
 #include "trapTraj.hpp"
 #include "endstop.hpp"
 #include "mechanical_brake.hpp"
+#include "mechanical_identifier.hpp"
 #include "low_level.h"
 #include "utils.hpp"
 #include "task_timer.hpp"
@@ -34,6 +35,7 @@ public:
     struct TaskTimes {
         TaskTimer thermistor_update;
         TaskTimer encoder_update;
+        TaskTimer encoder_latency;
         TaskTimer sensorless_estimator_update;
         TaskTimer endstop_update;
         TaskTimer can_heartbeat;
@@ -47,6 +49,16 @@ public:
         TaskTimer pwm_update;
     };
 
+    struct AutotuneConfig_t {
+        float torque = 0.2f;         // [Nm] amplitude of the relay excitation
+        float vel = 2.0f;            // [turn/s] velocity at which the relay reverses
+        uint32_t n_cycles = 10;      // minimum number of relay cycles
+        float min_duration = 1.0f;   // [s] minimum duration of the excitation
+        float timeout = 10.0f;       // [s]
+        float bandwidth = 100.0f;    // [rad/s] velocity loop crossover
+        float phase_margin = 60.0f;  // [deg] velocity loop phase margin
+    };
+
     static LockinConfig_t default_calibration();
     static LockinConfig_t default_sensorless();
     static LockinConfig_t default_lockin();
@@ -86,6 +98,8 @@ public:
         LockinConfig_t sensorless_ramp = default_sensorless();
         LockinConfig_t general_lockin;
 
+        AutotuneConfig_t autotune;
+
         CANConfig_t can;
 
         // custom setters
@@ -98,6 +112,12 @@ public:
         bool is_homed = false;
     };
 
+    struct Autotune_t {
+        float inertia = 0.0f;          // [Nm/(turn/s^2)]
+        float viscous_friction = 0.0f; // [Nm/(turn/s)]
+        float coulomb_friction = 0.0f; // [Nm]
+    };
+
     struct CAN_t {
         uint32_t last_heartbeat = 0;
         uint32_t last_encoder = 0;
@@ -126,6 +146,7 @@ public:
     void set_step_dir_active(bool enable);
     void decode_step_dir_pins();
 
+    void set_error(Error error);
     bool do_checks(uint32_t timestamp);
 
     void watchdog_feed();
@@ -142,8 +163,11 @@ public:
                 std::function<bool(bool)> loop_cb = {} );
     bool run_closed_loop_control_loop();
     bool run_homing();
+    bool run_autotune();
     bool run_idle_loop();
 
+    void update_autotune();
+
     constexpr uint32_t get_watchdog_reset() {
         return static_cast<uint32_t>(std::clamp<float>(config_.watchdog_timeout, 0, UINT32_MAX / (current_meas_hz + 1)) * current_meas_hz);
     }
@@ -189,6 +213,11 @@ public:
     Homing_t homing_;
     CAN_t can_;
 
+    // autotune
+    Autotune_t autotune_;
+    MechanicalIdentifier mechanical_identifier_;
+    OutputPort<float> autotune_torque_ = 0.0f; // [Nm]
+
 
     // watchdog
     uint32_t watchdog_current_value_= 0;
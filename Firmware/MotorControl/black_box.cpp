@@ -0,0 +1,330 @@
+
+#include "black_box.hpp"
+#include "raw_cursor.hpp"
+
+#include <odrive_main.h>
+#include <string.h>
+#include <algorithm>
+
+const BlackBox::Sector_t BlackBox::sectors_[2] = {
+    {BLACK_BOX_SECTOR_A, BLACK_BOX_SECTOR_A_BASE},
+    {BLACK_BOX_SECTOR_B, BLACK_BOX_SECTOR_B_BASE},
+};
+
+static void unlock_flash() {
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+}
+
+static bool erase_sector(uint32_t sector_id) {
+    FLASH_EraseInitTypeDef erase_struct = {};
+    erase_struct.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase_struct.Sector = sector_id;
+    erase_struct.NbSectors = 1;
+    erase_struct.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+    uint32_t sector_error;
+    unlock_flash();
+    bool success = HAL_FLASHEx_Erase(&erase_struct, &sector_error) == HAL_OK;
+    HAL_FLASH_Lock();
+    return success;
+}
+
+/**
+ * @brief Calls on_incident(addr, header) for every complete incident in the
+ * sector and returns the address after the last incident.
+ *
+ * If a header is corrupt (e.g. power loss while its size was programmed), the
+ * rest of the sector is considered used.
+ */
+template<typename TFunc>
+uintptr_t BlackBox::scan(const Sector_t& sector, TFunc on_incident) {
+    uintptr_t addr = sector.base;
+    uintptr_t end = sector.base + BLACK_BOX_SECTOR_SIZE;
+
+    while (addr + sizeof(IncidentHeader_t) <= end) {
+        const IncidentHeader_t* header = reinterpret_cast<const IncidentHeader_t*>(addr);
+        if (header->size == 0xffffffff) {
+            break; // erased
+        }
+        if (header->size < sizeof(IncidentHeader_t) || header->size > end - addr) {
+            return end;
+        }
+        if (header->magic == kMagic) {
+            on_incident(addr, *header);
+        }
+        addr += (header->size + 7) & ~7;
+    }
+
+    return addr;
+}
+
+/**
+ * @brief Finds the sector to which the next incident is written.
+ *
+ * If the newer sector cannot take another incident, the older one is erased.
+ * This takes up to 2 seconds during which the CPU is stalled, so this must run
+ * during startup before any interrupts that matter are enabled.
+ */
+void BlackBox::init() {
+    bool used[2] = {false, false};
+    uint32_t max_seq[2] = {0, 0};
+    uintptr_t free_addr[2];
+
+    for (size_t i = 0; i < 2; ++i) {
+        free_addr[i] = scan(sectors_[i], [&](uintptr_t addr, const IncidentHeader_t& header) {
+            used[i] = true;
+            max_seq[i] = std::max(max_seq[i], header.seq);
+            next_seq_ = std::max(next_seq_, header.seq + 1);
+        });
+    }
+
+    active_sector_ = (used[1] && (!used[0] || max_seq[1] > max_seq[0])) ? 1 : 0;
+    write_addr_ = free_addr[active_sector_];
+
+    if (sectors_[active_sector_].base + BLACK_BOX_SECTOR_SIZE - write_addr_ < kMaxIncidentSize) {
+        active_sector_ ^= 1;
+        write_addr_ = erase_sector(sectors_[active_sector_].id) ? sectors_[active_sector_].base : 0;
+    }
+}
+
+void BlackBox::sample(uint32_t timestamp) {
+    Frame_t& frame = frames_[write_idx_];
+    frame.timestamp = timestamp;
+    frame.vbus_voltage = vbus_voltage;
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        Axis& axis = axes[i];
+        AxisFrame_t& dst = frame.axes[i];
+        dst.Iq_measured = axis.motor_.current_control_.Iq_measured_;
+        dst.Id_measured = axis.motor_.current_control_.Id_measured_;
+        dst.vel_estimate = axis.encoder_.vel_estimate_.present().value_or(NAN);
+        dst.pos_estimate = axis.encoder_.pos_estimate_.present().value_or(NAN);
+        dst.fet_temp = axis.motor_.fet_thermistor_.temperature_;
+        dst.motor_temp = axis.motor_.motor_thermistor_.temperature_;
+        dst.state = axis.current_state_;
+    }
+
+    write_idx_ = (write_idx_ + 1 < BLACK_BOX_FRAMES) ? (write_idx_ + 1) : 0;
+    n_frames_ = std::min(n_frames_ + 1, (size_t)BLACK_BOX_FRAMES);
+}
+
+void BlackBox::trigger(size_t axis_num) {
+    header_.size = sizeof(IncidentHeader_t) + n_frames_ * sizeof(Frame_t);
+    header_.magic = kMagic;
+    header_.seq = next_seq_++;
+    header_.uptime = HAL_GetTick();
+    header_.n_frames = n_frames_;
+    header_.frame_size = sizeof(Frame_t);
+    header_.decimation = decimation_;
+    header_.trigger_axis = axis_num;
+    header_.n_axes = AXIS_COUNT;
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        header_.axes[i].motor_error = last_motor_error_[i];
+        header_.axes[i].axis_error = last_axis_error_[i];
+        header_.axes[i].state = axes[i].current_state_;
+    }
+    pending_ = true;
+}
+
+/**
+ * @brief Records a frame every decimation_ iterations and checks for new
+ * errors. Called at the end of every control loop iteration.
+ */
+void BlackBox::update(uint32_t timestamp) {
+    if (pending_) {
+        return; // frozen until the incident is written
+    }
+
+    bool sampled = false;
+    if (++decimation_counter_ >= decimation_) {
+        decimation_counter_ = 0;
+        sample(timestamp);
+        sampled = true;
+    }
+
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        uint32_t axis_error = axes[i].error_;
+        uint64_t motor_error = axes[i].motor_.error_;
+        bool new_error = (axis_error & ~last_axis_error_[i]) || (motor_error & ~last_motor_error_[i]);
+        last_axis_error_[i] = axis_error;
+        last_motor_error_[i] = motor_error;
+
+        if (new_error && !pending_) {
+            // Make sure the moment of the error is part of the incident
+            if (!sampled) {
+                sample(timestamp);
+            }
+            trigger(i);
+        }
+    }
+}
+
+/**
+ * @brief Returns the word that is programmed in the given step of writing the
+ * pending incident and sets offset to its position within the incident.
+ *
+ * The size goes first and the magic number last so that an incident that was
+ * interrupted by a power loss can be skipped.
+ */
+uint32_t BlackBox::incident_word(uint32_t step, uint32_t* offset) {
+    uint32_t n_words = header_.size / 4;
+    if (step == 0) {
+        *offset = 0; // size
+    } else if (step < n_words - 1) {
+        *offset = (step + 1) * 4;
+    } else {
+        *offset = 4; // magic
+    }
+
+    uint32_t word;
+    if (*offset < sizeof(IncidentHeader_t)) {
+        memcpy(&word, reinterpret_cast<const uint8_t*>(&header_) + *offset, sizeof(word));
+    } else {
+        uint32_t frame_offset = *offset - sizeof(IncidentHeader_t);
+        size_t oldest = (write_idx_ + BLACK_BOX_FRAMES - n_frames_) % BLACK_BOX_FRAMES;
+        size_t idx = (oldest + frame_offset / sizeof(Frame_t)) % BLACK_BOX_FRAMES;
+        memcpy(&word, reinterpret_cast<const uint8_t*>(&frames_[idx]) + frame_offset % sizeof(Frame_t), sizeof(word));
+    }
+    return word;
+}
+
+/**
+ * @brief Writes a pending incident to flash while all motors are disarmed.
+ * Called from the idle thread.
+ *
+ * Each word is programmed in a critical section that first checks that no
+ * motor is armed. Motor::arm() sets is_armed_ in a critical section too, so
+ * once a motor is armed, no further word is programmed. The write resumes
+ * where it stopped when all motors are disarmed again.
+ */
+void BlackBox::service() {
+    if (!pending_) {
+        return;
+    }
+
+    uintptr_t end = sectors_[active_sector_].base + BLACK_BOX_SECTOR_SIZE;
+    if (!write_addr_ || end - write_addr_ < header_.size) {
+        n_dropped_++;
+        write_addr_ = 0;
+    } else {
+        uint32_t n_words = header_.size / 4;
+        bool success = true;
+
+        unlock_flash();
+        while (success && write_step_ < n_words) {
+            uint32_t offset;
+            uint32_t word = incident_word(write_step_, &offset);
+            bool any_armed = true;
+            CRITICAL_SECTION() {
+                any_armed = std::any_of(axes.begin(), axes.end(),
+                    [](auto& axis){ return axis.motor_.is_armed_; });
+                if (!any_armed) {
+                    // Stalls the CPU for about 16us
+                    success = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, write_addr_ + offset, word) == HAL_OK;
+                }
+            }
+            if (any_armed) {
+                break;
+            }
+            write_step_++;
+        }
+        HAL_FLASH_Lock();
+
+        // The data cache might still hold the erased values
+        __HAL_FLASH_DATA_CACHE_DISABLE();
+        __HAL_FLASH_DATA_CACHE_RESET();
+        __HAL_FLASH_DATA_CACHE_ENABLE();
+
+        if (success && write_step_ < n_words) {
+            return; // a motor was armed, resume later
+        }
+
+        write_addr_ += (header_.size + 7) & ~7;
+        if (!success || end - write_addr_ < kMaxIncidentSize) {
+            write_addr_ = 0; // the next incident goes to the other sector after a reboot
+        }
+    }
+
+    // Start over with an empty history
+    CRITICAL_SECTION() {
+        write_idx_ = 0;
+        n_frames_ = 0;
+        decimation_counter_ = 0;
+        write_step_ = 0;
+        pending_ = false;
+    }
+}
+
+uint32_t BlackBox::get_n_incidents() {
+    uint32_t n = 0;
+    for (auto& sector: sectors_) {
+        scan(sector, [&](uintptr_t, const IncidentHeader_t&) { n++; });
+    }
+    return n;
+}
+
+/**
+ * @brief Selects the incident that is read through read_raw() and resets
+ * read_offset_. Index 0 is the most recent incident.
+ * Returns the size of the incident in bytes or 0 if there is no such incident.
+ */
+uint32_t BlackBox::select_incident(uint32_t index) {
+    selected_addr_ = 0;
+    selected_size_ = 0;
+    read_offset_ = 0;
+
+    // Within a sector the incidents are in chronological order. The sector
+    // that was written last is the active one.
+    for (size_t i = 0; i < 2; ++i) {
+        const Sector_t& sector = sectors_[active_sector_ ^ i];
+        uint32_t n = 0;
+        scan(sector, [&](uintptr_t, const IncidentHeader_t&) { n++; });
+
+        if (index < n) {
+            uint32_t target = n - 1 - index;
+            scan(sector, [&](uintptr_t addr, const IncidentHeader_t& header) {
+                if (target-- == 0) {
+                    selected_addr_ = addr;
+                    selected_size_ = header.size;
+                }
+            });
+            break;
+        }
+        index -= n;
+    }
+
+    return selected_size_;
+}
+
+/**
+ * @brief Returns the next 8 bytes of the selected incident and advances
+ * read_offset_. Reading past the end returns 0.
+ */
+uint64_t BlackBox::read_raw() {
+    return raw_read(reinterpret_cast<const void*>(selected_addr_), selected_addr_ ? selected_size_ : 0, &read_offset_);
+}
+
+/**
+ * @brief Erases all incidents and reboots.
+ *
+ * Like save_configuration(), this is only allowed while all motors are
+ * disarmed and reboots because interrupts are missed while the flash is
+ * erased.
+ */
+bool BlackBox::clear() {
+    CRITICAL_SECTION() {
+        bool any_armed = std::any_of(axes.begin(), axes.end(),
+            [](auto& axis){ return axis.motor_.is_armed_; });
+        if (any_armed) {
+            return false;
+        }
+
+        for (auto& sector: sectors_) {
+            erase_sector(sector.id);
+        }
+
+        NVIC_SystemReset();
+    }
+
+    return true;
+}
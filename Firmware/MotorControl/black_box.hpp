@@ -0,0 +1,118 @@
+#ifndef __BLACK_BOX_HPP
+#define __BLACK_BOX_HPP
+
+#include <autogen/interfaces.hpp>
+#include <board.h>
+
+// Number of frames in the RAM ring. This is the history that is saved to
+// flash when an error occurs.
+#define BLACK_BOX_FRAMES 128
+
+/**
+ * @brief Records a low-rate history of key signals and saves it to flash when
+ * an axis or motor error occurs.
+ *
+ * The history is kept in a RAM ring that is updated from the control loop.
+ * When a new bit appears in `Axis::error_` or `Motor::error_` of any axis,
+ * the ring is frozen and becomes an incident that is written to flash from
+ * the idle thread. The ring resumes once the incident is written.
+ *
+ * On the STM32F405 the CPU stalls while the flash is being programmed or
+ * erased. To keep this away from the control loop, incidents are only written
+ * while all motors are disarmed (which is usually the case right after an
+ * error), one word at a time, and sectors are only erased during startup or
+ * by clear(). If a motor is armed in the middle of a write, the write pauses
+ * until all motors are disarmed again.
+ *
+ * Two flash sectors are used alternately. Each incident is stored as an
+ * IncidentHeader_t followed by n_frames Frame_t in chronological order.
+ */
+class BlackBox : public ODriveIntf::BlackBoxIntf {
+public:
+    static constexpr uint32_t kMagic = 0xB1AC0B0C;
+
+    struct AxisFrame_t {
+        float Iq_measured;  // [A]
+        float Id_measured;  // [A]
+        float vel_estimate; // [turn/s]
+        float pos_estimate; // [turn]
+        float fet_temp;     // [°C]
+        float motor_temp;   // [°C]
+        uint32_t state;     // AxisState
+    };
+
+    struct Frame_t {
+        uint32_t timestamp; // [clocks] control loop timestamp
+        float vbus_voltage; // [V]
+        AxisFrame_t axes[AXIS_COUNT];
+    };
+
+    struct AxisInfo_t {
+        uint64_t motor_error;
+        uint32_t axis_error;
+        uint32_t state;
+    };
+
+    struct IncidentHeader_t {
+        uint32_t size;        // [bytes] including this header, written first
+        uint32_t magic;       // written last, kMagic if the incident is complete
+        uint32_t seq;         // incrementing incident number
+        uint32_t uptime;      // [ms] at the time of the error
+        uint16_t n_frames;
+        uint16_t frame_size;  // [bytes]
+        uint16_t decimation;
+        uint8_t trigger_axis; // axis on which the new error appeared
+        uint8_t n_axes;
+        AxisInfo_t axes[AXIS_COUNT];
+    };
+
+    static_assert(sizeof(Frame_t) % 4 == 0, "flash is programmed in words");
+    static_assert(sizeof(IncidentHeader_t) % 8 == 0, "raw readout is in units of 8 bytes");
+
+    void init();
+    void update(uint32_t timestamp);
+    void service();
+
+    uint32_t get_n_incidents();
+    uint32_t select_incident(uint32_t index) override;
+    bool clear() override;
+    uint64_t read_raw();
+
+    uint32_t decimation_ = (uint32_t)(CURRENT_MEAS_HZ / 100.0f); // only every n-th control loop iteration is recorded (default: 100Hz)
+    bool pending_ = false; // an incident is waiting to be written to flash
+    uint32_t n_dropped_ = 0; // incidents that were lost because the flash was full
+    uint32_t read_offset_ = 0; // [bytes] position of the next read_raw() within the selected incident
+
+private:
+    static constexpr size_t kMaxIncidentSize = sizeof(IncidentHeader_t) + BLACK_BOX_FRAMES * sizeof(Frame_t);
+
+    struct Sector_t {
+        uint32_t id;   // HAL sector number
+        uintptr_t base;
+    };
+
+    template<typename TFunc>
+    static uintptr_t scan(const Sector_t& sector, TFunc on_incident);
+    uint32_t incident_word(uint32_t step, uint32_t* offset);
+    void trigger(size_t axis_num);
+    void sample(uint32_t timestamp);
+
+    static const Sector_t sectors_[2];
+    size_t active_sector_ = 0;
+    uintptr_t write_addr_ = 0; // 0 if the flash is full
+    uint32_t next_seq_ = 0;
+
+    Frame_t frames_[BLACK_BOX_FRAMES];
+    size_t write_idx_ = 0; // next frame to be written
+    size_t n_frames_ = 0;  // valid frames, saturates at BLACK_BOX_FRAMES
+    uint32_t decimation_counter_ = 0;
+    uint32_t last_axis_error_[AXIS_COUNT] = {0};
+    uint64_t last_motor_error_[AXIS_COUNT] = {0};
+    IncidentHeader_t header_;
+    uint32_t write_step_ = 0; // [words] programmed of the pending incident
+
+    uintptr_t selected_addr_ = 0;
+    uint32_t selected_size_ = 0;
+};
+
+#endif // __BLACK_BOX_HPP
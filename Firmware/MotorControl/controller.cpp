@@ -15,9 +15,15 @@ void Controller::reset() {
     torque_setpoint_ = 0.0f;
     mechanical_power_ = 0.0f;
     electrical_power_ = 0.0f;
+    freq_response_.stop();
+    inertia_estimator_.reset(config_.inertia);
+    disturbance_observer_.reset();
 }
 
 void Controller::set_error(Error error) {
+    if (error & ~error_) {
+        odrv.journal_.log(Journal::JOURNAL_ENTRY_TYPE_CONTROLLER_ERROR, axis_->axis_num_, error, axis_->current_state_);
+    }
     error_ |= error;
     last_error_time_ = odrv.n_evt_control_loop_ * current_meas_period;
 }
@@ -27,8 +33,46 @@ void Controller::set_error(Error error) {
 //--------------------------------
 
 
-void Controller::move_to_pos(float goal_point) {
-    axis_->trap_traj_.planTrapezoidal(goal_point, pos_setpoint_, vel_setpoint_,
+// @brief Sets input_pos_ from outside of the control loop and notifies the
+// trajectory planner.
+void Controller::set_input_pos(Position value) {
+    CRITICAL_SECTION() {
+        input_pos_ = value;
+        input_pos_updated();
+    }
+}
+
+// @brief Sets input_pos_ and pos_setpoint_ from outside of the control loop,
+// e.g. to start from the current position.
+void Controller::set_input_pos_and_setpoint(Position input_pos, Position pos_setpoint) {
+    CRITICAL_SECTION() {
+        input_pos_ = input_pos;
+        pos_setpoint_ = pos_setpoint;
+        input_pos_updated();
+    }
+}
+
+Position Controller::get_input_pos() {
+    Position pos;
+    CRITICAL_SECTION() {
+        pos = input_pos_;
+    }
+    return pos;
+}
+
+Position Controller::get_pos_setpoint() {
+    Position pos;
+    CRITICAL_SECTION() {
+        pos = pos_setpoint_;
+    }
+    return pos;
+}
+
+void Controller::move_to_pos(Position goal_point) {
+    // Planned relative to the start, so the trajectory has the same resolution
+    // anywhere in the travel range
+    trajectory_start_ = pos_setpoint_;
+    axis_->trap_traj_.planTrapezoidal(goal_point - pos_setpoint_, 0.0f, vel_setpoint_,
                                  axis_->trap_traj_.config_.vel_limit,
                                  axis_->trap_traj_.config_.accel_limit,
                                  axis_->trap_traj_.config_.decel_limit);
@@ -37,13 +81,15 @@ void Controller::move_to_pos(float goal_point) {
 }
 
 void Controller::move_incremental(float displacement, bool from_input_pos = true){
-    if(from_input_pos){
-        input_pos_ += displacement;
-    } else{
-        input_pos_ = pos_setpoint_ + displacement;
-    }
+    CRITICAL_SECTION() {
+        if(from_input_pos){
+            input_pos_ += displacement;
+        } else{
+            input_pos_ = pos_setpoint_ + displacement;
+        }
 
-    input_pos_updated();
+        input_pos_updated();
+    }
 }
 
 void Controller::start_anticogging_calibration() {
@@ -100,7 +146,7 @@ static float limitVel(const float vel_limit, const float vel_estimate, const flo
 }
 
 bool Controller::update() {
-    std::optional<float> pos_estimate_linear = pos_estimate_linear_src_.present();
+    std::optional<Position> pos_estimate_linear = pos_estimate_linear_src_.present();
     std::optional<float> pos_estimate_circular = pos_estimate_circular_src_.present();
     std::optional<float> pos_wrap = pos_wrap_src_.present();
     std::optional<float> vel_estimate = vel_estimate_src_.present();
@@ -131,7 +177,27 @@ bool Controller::update() {
             set_error(ERROR_INVALID_CIRCULAR_RANGE);
             return false;
         }
-        input_pos_ = fmodf_pos(input_pos_, *pos_wrap);
+        input_pos_ = fmodf_pos(input_pos_.to_float(), *pos_wrap);
+    }
+
+    // Online inertia and load torque estimate
+    if (config_.enable_inertia_estimation && vel_estimate.has_value()) {
+        inertia_estimator_.update(torque_output_.previous().value_or(0.0f), *vel_estimate, current_meas_period,
+                config_.inertia_estimation_time_constant, config_.inertia_estimation_min_acc);
+    }
+    bool adapt_inertia = config_.enable_inertia_estimation && config_.enable_inertia_adaptation;
+    if (adapt_inertia) {
+        inertia_estimator_.update_scale(config_.inertia, config_.inertia_adaptation_range,
+                config_.inertia_adaptation_rate, current_meas_period);
+    }
+    float inertia_scale = adapt_inertia ? inertia_estimator_.scale() : 1.0f;
+    float inertia = config_.inertia * inertia_scale;
+
+    // Disturbance observer
+    float disturbance_torque = 0.0f;
+    if (config_.enable_disturbance_observer && vel_estimate.has_value()) {
+        disturbance_torque = disturbance_observer_.update(torque_output_.previous().value_or(0.0f), *vel_estimate,
+                inertia, config_.viscous_friction, config_.disturbance_observer_bandwidth, current_meas_period);
     }
 
     // Update inputs
@@ -150,7 +216,7 @@ bool Controller::update() {
             float step = std::clamp(full_step, -max_step_size, max_step_size);
 
             vel_setpoint_ += step;
-            torque_setpoint_ = (step / current_meas_period) * config_.inertia;
+            torque_setpoint_ = (step / current_meas_period) * inertia;
         } break;
         case INPUT_MODE_TORQUE_RAMP: {
             float max_step_size = std::abs(current_meas_period * config_.torque_ramp_rate);
@@ -171,7 +237,7 @@ bool Controller::update() {
             }
             float delta_vel = input_vel_ - vel_setpoint_; // Vel error
             float accel = input_filter_kp_*delta_pos + input_filter_ki_*delta_vel; // Feedback
-            torque_setpoint_ = accel * config_.inertia; // Accel
+            torque_setpoint_ = accel * inertia; // Accel
             vel_setpoint_ += current_meas_period * accel; // delta vel
             pos_setpoint_ += current_meas_period * vel_setpoint_; // Delta pos
         } break;
@@ -189,6 +255,12 @@ bool Controller::update() {
                 pos_setpoint_ = *other_pos * config_.mirror_ratio;
                 vel_setpoint_ = *other_vel * config_.mirror_ratio;
                 torque_setpoint_ = *other_torque * config_.torque_mirror_ratio;
+
+                // Inertia feedforward if the other axis estimates its acceleration
+                std::optional<float> other_acc = axes[config_.axis_to_mirror].encoder_.acc_estimate_.present();
+                if (other_acc.has_value()) {
+                    torque_setpoint_ += *other_acc * config_.mirror_ratio * inertia;
+                }
             } else {
                 set_error(ERROR_INVALID_MIRROR_AXIS);
                 return false;
@@ -215,12 +287,12 @@ bool Controller::update() {
                 trajectory_done_ = true;
             } else {
                 TrapezoidalTrajectory::Step_t traj_step = axis_->trap_traj_.eval(axis_->trap_traj_.t_);
-                pos_setpoint_ = traj_step.Y;
+                pos_setpoint_ = trajectory_start_ + traj_step.Y;
                 vel_setpoint_ = traj_step.Yd;
-                torque_setpoint_ = traj_step.Ydd * config_.inertia;
+                torque_setpoint_ = traj_step.Ydd * inertia;
                 axis_->trap_traj_.t_ += current_meas_period;
             }
-            anticogging_pos_estimate = pos_setpoint_; // FF the position setpoint instead of the pos_estimate
+            anticogging_pos_estimate = pos_setpoint_.to_float(); // FF the position setpoint instead of the pos_estimate
         } break;
         case INPUT_MODE_TUNING: {
             autotuning_phase_ = wrap_pm_pi(autotuning_phase_ + (2.0f * M_PI * autotuning_.frequency * current_meas_period));
@@ -238,7 +310,7 @@ bool Controller::update() {
     // Position control
     // TODO Decide if we want to use encoder or pll position here
     float gain_scheduling_multiplier = 1.0f;
-    float vel_des = vel_setpoint_;
+    float vel_des = vel_setpoint_ + freq_response_.get_excitation(FreqResponse::EXCITATION_POINT_VELOCITY);
     if (config_.control_mode >= CONTROL_MODE_POSITION_CONTROL) {
         float pos_err;
 
@@ -248,9 +320,9 @@ bool Controller::update() {
                 return false;
             }
             // Keep pos setpoint from drifting
-            pos_setpoint_ = fmodf_pos(pos_setpoint_, *pos_wrap);
+            pos_setpoint_ = fmodf_pos(pos_setpoint_.to_float(), *pos_wrap);
             // Circular delta
-            pos_err = pos_setpoint_ - *pos_estimate_circular;
+            pos_err = pos_setpoint_.to_float() - *pos_estimate_circular;
             pos_err = wrap_pm(pos_err, *pos_wrap);
         } else {
             if (!pos_estimate_linear.has_value()) {
@@ -259,6 +331,7 @@ bool Controller::update() {
             }
             pos_err = pos_setpoint_ - *pos_estimate_linear;
         }
+        pos_err += freq_response_.get_excitation(FreqResponse::EXCITATION_POINT_POSITION);
 
         vel_des += config_.pos_gain * pos_err;
         // V-shaped gain shedule based on position error
@@ -288,8 +361,8 @@ bool Controller::update() {
 
     // TODO: Change to controller working in torque units
     // Torque per amp gain scheduling (ACIM)
-    float vel_gain = config_.vel_gain;
-    float vel_integrator_gain = config_.vel_integrator_gain;
+    float vel_gain = config_.vel_gain * inertia_scale;
+    float vel_integrator_gain = config_.vel_integrator_gain * inertia_scale;
     if (axis_->motor_.config_.motor_type == Motor::MOTOR_TYPE_ACIM) {
         float effective_flux = axis_->acim_estimator_.rotor_flux_;
         float minflux = axis_->motor_.config_.acim_gain_min_flux;
@@ -302,7 +375,7 @@ bool Controller::update() {
     }
 
     // Velocity control
-    float torque = torque_setpoint_;
+    float torque = torque_setpoint_ + freq_response_.get_excitation(FreqResponse::EXCITATION_POINT_TORQUE);
 
     // Anti-cogging is enabled after calibration
     // We get the current position and apply a current feed-forward
@@ -326,6 +399,9 @@ bool Controller::update() {
         v_err = vel_des - *vel_estimate;
         torque += (vel_gain * gain_scheduling_multiplier) * v_err;
 
+        // Disturbance rejection
+        torque += disturbance_torque;
+
         // Velocity integral action before limiting
         torque += vel_integrator_torque_;
     }
@@ -385,6 +461,10 @@ bool Controller::update() {
         return false;
     }
 
+    if (vel_estimate.has_value()) {
+        freq_response_.update(torque, *vel_estimate);
+    }
+
     torque_output_ = torque;
 
     // TODO: this is inconsistent with the other errors which are sticky.
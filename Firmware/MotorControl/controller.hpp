@@ -1,6 +1,11 @@
 #ifndef __CONTROLLER_HPP
 #define __CONTROLLER_HPP
 
+#include "position.hpp"
+#include "freq_response.hpp"
+#include "inertia_estimator.hpp"
+#include "disturbance_observer.hpp"
+
 class Controller : public ODriveIntf::ControllerIntf {
 public:
     struct Anticogging_t {
@@ -55,6 +60,15 @@ public:
         float electrical_power_bandwidth = 20.0f; // [rad/s] filter cutoff for electrical power for spinout detection
         float spinout_electrical_power_threshold = 10.0f; // [W] electrical power threshold for spinout detection
         float spinout_mechanical_power_threshold = -10.0f; // [W] mechanical power threshold for spinout detection
+        bool enable_inertia_estimation = false;
+        float inertia_estimation_time_constant = 0.1f; // [s] forgetting time constant of the inertia and load torque estimate
+        float inertia_estimation_min_acc = 10.0f;      // [turn/s^2] less acceleration does not update the estimate
+        bool enable_inertia_adaptation = false;        // scale vel gains and inertia feedforward by the estimated inertia / inertia (requires enable_inertia_estimation)
+        float inertia_adaptation_rate = 4.0f;          // [1/s] maximum relative change of the scale per second
+        float inertia_adaptation_range = 10.0f;        // the scale stays within [1 / range, range]
+        bool enable_disturbance_observer = false;
+        float disturbance_observer_bandwidth = 200.0f; // [rad/s] Q-filter bandwidth
+        float viscous_friction = 0.0f;                 // [Nm/(turn/s)] nominal plant of the disturbance observer, together with inertia
 
         // custom setters
         Controller* parent;
@@ -75,8 +89,15 @@ public:
 
     bool select_encoder(size_t encoder_num);
 
+    // Position is not written atomically, so threads access input_pos_ and
+    // pos_setpoint_ only through these
+    void set_input_pos(Position value);
+    void set_input_pos_and_setpoint(Position input_pos, Position pos_setpoint);
+    Position get_input_pos();
+    Position get_pos_setpoint();
+
     // Trajectory-Planned control
-    void move_to_pos(float goal_point);
+    void move_to_pos(Position goal_point);
     void move_incremental(float displacement, bool from_goal_point);
     
     // TODO: make this more similar to other calibration loops
@@ -93,18 +114,18 @@ public:
     float last_error_time_ = 0.0f;
 
     // Inputs
-    InputPort<float> pos_estimate_linear_src_;
+    InputPort<Position> pos_estimate_linear_src_;
     InputPort<float> pos_estimate_circular_src_;
     InputPort<float> vel_estimate_src_;
     InputPort<float> pos_wrap_src_; 
 
-    float pos_setpoint_ = 0.0f; // [turns]
+    Position pos_setpoint_; // [turns]
     float vel_setpoint_ = 0.0f; // [turn/s]
     // float vel_setpoint = 800.0f; <sensorless example>
     float vel_integrator_torque_ = 0.0f;    // [Nm]
     float torque_setpoint_ = 0.0f;  // [Nm]
 
-    float input_pos_ = 0.0f;     // [turns]
+    Position input_pos_;         // [turns]
     float input_vel_ = 0.0f;     // [turn/s]
     float input_torque_ = 0.0f;  // [Nm]
     float input_filter_kp_ = 0.0f;
@@ -116,16 +137,18 @@ public:
     bool input_pos_updated_ = false;
     
     bool trajectory_done_ = true;
+    Position trajectory_start_; // [turns] the trajectory is planned relative to this
 
     bool anticogging_valid_ = false;
     float mechanical_power_ = 0.0f; // [W]
     float electrical_power_ = 0.0f; // [W]
 
+    FreqResponse freq_response_;
+    InertiaEstimator inertia_estimator_;
+    DisturbanceObserver disturbance_observer_;
+
     // Outputs
     OutputPort<float> torque_output_ = 0.0f;
-
-    // custom setters
-    void set_input_pos(float value) { input_pos_ = value; input_pos_updated(); }
 };
 
 #endif // __CONTROLLER_HPP
@@ -0,0 +1,64 @@
+#ifndef __DISTURBANCE_OBSERVER_HPP
+#define __DISTURBANCE_OBSERVER_HPP
+
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief Estimates the disturbance torque acting on an axis by comparing the
+ * commanded torque with the torque that the nominal plant needs for the
+ * measured motion.
+ *
+ * With the nominal plant J * dv/dt + b * v, the disturbance is
+ *   d = T - J * dv/dt - b * v
+ * which is low pass filtered by the Q-filter (first order, bandwidth in
+ * rad/s). Adding the estimate to the torque command makes the axis behave
+ * like the nominal plant up to the bandwidth of the Q-filter, so load steps
+ * are rejected without raising the loop gains.
+ *
+ * The Q-filter must be slower than the velocity estimate (for instance the
+ * encoder PLL bandwidth), otherwise the lag of the estimate makes the loop
+ * oscillate. The velocity noise enters the estimate with a gain of about
+ * J * bandwidth.
+ */
+class DisturbanceObserver {
+public:
+    void reset() {
+        torque_ = 0.0f;
+        has_prev_vel_ = false;
+    }
+
+    /**
+     * @brief Updates and returns the estimate.
+     *
+     * @param torque: Torque that was commanded since the previous call.
+     * @param vel: Velocity at the time of this call.
+     * @param inertia: Nominal inertia [Nm/(turn/s^2)].
+     * @param viscous_friction: Nominal viscous friction [Nm/(turn/s)].
+     * @param bandwidth: Bandwidth of the Q-filter [rad/s].
+     * @param period: Time since the previous call.
+     */
+    float update(float torque, float vel, float inertia, float viscous_friction, float bandwidth, float period) {
+        if (!has_prev_vel_) {
+            prev_vel_ = vel;
+            has_prev_vel_ = true;
+            return torque_;
+        }
+        float acc = (vel - prev_vel_) / period;
+        prev_vel_ = vel;
+
+        float disturbance = torque - inertia * acc - viscous_friction * vel;
+        float alpha = std::clamp(bandwidth * period, 0.0f, 1.0f);
+        torque_ += alpha * (disturbance - torque_);
+        return torque_;
+    }
+
+    float torque() const { return torque_; } // [Nm]
+
+private:
+    float torque_ = 0.0f;
+    float prev_vel_ = 0.0f;
+    bool has_prev_vel_ = false;
+};
+
+#endif // __DISTURBANCE_OBSERVER_HPP
@@ -0,0 +1,159 @@
+#ifndef __ECCENTRICITY_LUT_HPP
+#define __ECCENTRICITY_LUT_HPP
+
+#include <stdint.h>
+#include <math.h>
+#include <array>
+#include <optional>
+#include "running_stats.hpp"
+
+// The table holds the error of the encoder at the raw positions k * cpr / size
+// in units of 1 / kEccentricityLutScale counts, i.e. up to +/-2048 counts.
+static constexpr size_t kEccentricityLutSize = 128;
+static constexpr float kEccentricityLutScale = 16.0f;
+using EccentricityLut = std::array<int16_t, kEccentricityLutSize>;
+
+// Returns the error [count] at a raw position [count], linearly interpolated
+// between the table entries. The count n covers the positions [n, n+1).
+inline float eccentricity_error(const EccentricityLut& lut, int32_t cpr, float raw) {
+    float x = raw * ((float)kEccentricityLutSize / (float)cpr);
+    x -= (float)kEccentricityLutSize * floorf(x / (float)kEccentricityLutSize);
+    size_t i = std::min((size_t)x, kEccentricityLutSize - 1);
+    float frac = x - (float)i;
+    float below = (float)lut[i];
+    float above = (float)lut[(i + 1) % kEccentricityLutSize];
+    return (below + frac * (above - below)) * (1.0f / kEccentricityLutScale);
+}
+
+/**
+ * @brief Collects the eccentricity table of an absolute encoder while the
+ * motor turns at a constant velocity.
+ *
+ * At a constant velocity the smoothed position is a straight line over time.
+ * The deviation of every sample from the line is averaged into the table
+ * entries next to its raw position, weighted by the distance to them. The
+ * line is fitted to the whole run, so unlike a tracking filter it does not
+ * follow the once-per-turn error itself. To avoid storing the samples, the
+ * deviations are first taken from the velocity of the first turn, and the
+ * table is corrected by the fitted velocity at the end.
+ *
+ * The table has zero mean, so a constant offset remains with the offset
+ * calibration.
+ */
+class EccentricityCalibrator {
+public:
+    void start(int32_t cpr, float period) {
+        cpr_ = cpr;
+        period_ = period;
+        n_ = 0;
+        n_samples_ = 0;
+        last_raw_ = std::nullopt;
+        unwrapped_ = 0;
+        vel_ = std::nullopt;
+        sum_w_.fill(0.0f);
+        sum_we_.fill(0.0f);
+        sum_wt_.fill(0.0f);
+        fit_.reset();
+    }
+
+    // Called once per control period with the raw position, or nothing if
+    // there is no new sample in this period
+    void push(std::optional<int32_t> raw) {
+        float t = (float)(n_++) * period_;
+        if (!raw.has_value()) {
+            return;
+        }
+        int32_t delta = (*raw - last_raw_.value_or(*raw)) % cpr_;
+        if (delta > cpr_ / 2) delta -= cpr_;
+        if (delta < -cpr_ / 2) delta += cpr_;
+        unwrapped_ += delta;
+        last_raw_ = *raw;
+
+        // The first turn determines the provisional line
+        if (!vel_.has_value()) {
+            if (std::abs(unwrapped_) >= cpr_) {
+                vel_ = (float)unwrapped_ / t;
+                t0_ = t;
+                p0_ = unwrapped_;
+            }
+            return;
+        }
+
+        t -= t0_;
+        float e = (float)(unwrapped_ - p0_) - *vel_ * t;
+        fit_.push(t, e);
+        n_samples_++;
+
+        float x = ((float)*raw + 0.5f) * ((float)kEccentricityLutSize / (float)cpr_);
+        size_t i = std::min((size_t)x, kEccentricityLutSize - 1);
+        float frac = x - (float)i;
+        accumulate(i, 1.0f - frac, e, t);
+        accumulate((i + 1) % kEccentricityLutSize, frac, e, t);
+    }
+
+    // Turns covered after the first one
+    float turns() const {
+        return vel_.has_value() ? std::abs((float)(unwrapped_ - p0_)) / (float)cpr_ : 0.0f;
+    }
+
+    // RMS deviation [count] from the line, before compensation
+    float residual_rms() const {
+        return fit_.residual_rms();
+    }
+
+    /**
+     * @brief Computes the table.
+     *
+     * @param min_turns: Turns that must be covered for a valid table.
+     * @returns false if fewer turns were covered or if the error exceeds the
+     *          range of the table, in which case lut is not modified.
+     */
+    bool finish(float min_turns, EccentricityLut* lut) const {
+        if (turns() < min_turns || n_samples_ < 3) {
+            return false;
+        }
+        float slope = fit_.slope();
+        std::array<float, kEccentricityLutSize> error;
+        float mean = 0.0f;
+        for (size_t i = 0; i < kEccentricityLutSize; ++i) {
+            if (!(sum_w_[i] > 0.0f)) {
+                return false;
+            }
+            error[i] = (sum_we_[i] - slope * sum_wt_[i]) / sum_w_[i];
+            mean += error[i] / (float)kEccentricityLutSize;
+        }
+        EccentricityLut result;
+        for (size_t i = 0; i < kEccentricityLutSize; ++i) {
+            float scaled = roundf((error[i] - mean) * kEccentricityLutScale);
+            if (!(std::abs(scaled) <= (float)INT16_MAX)) {
+                return false;
+            }
+            result[i] = (int16_t)scaled;
+        }
+        *lut = result;
+        return true;
+    }
+
+private:
+    void accumulate(size_t i, float w, float e, float t) {
+        sum_w_[i] += w;
+        sum_we_[i] += w * e;
+        sum_wt_[i] += w * t;
+    }
+
+    int32_t cpr_ = 1;
+    float period_ = 0.0f;
+    uint32_t n_ = 0; // control periods since start()
+    uint32_t n_samples_ = 0; // samples in the table
+    std::optional<int32_t> last_raw_;
+    int32_t unwrapped_ = 0; // [count] relative to the first sample
+    std::optional<float> vel_; // [count/s] provisional velocity from the first turn
+    float t0_ = 0.0f; // [s] start of the provisional line
+    int32_t p0_ = 0; // [count] start of the provisional line
+    std::array<float, kEccentricityLutSize> sum_w_;
+    std::array<float, kEccentricityLutSize> sum_we_; // deviation from the provisional line
+    std::array<float, kEccentricityLutSize> sum_wt_; // time since t0_
+    RunningLinearFit fit_; // deviation from the provisional line vs time
+};
+
+#endif // __ECCENTRICITY_LUT_HPP
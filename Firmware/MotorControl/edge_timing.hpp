@@ -0,0 +1,110 @@
+#ifndef __EDGE_TIMING_HPP
+#define __EDGE_TIMING_HPP
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief Velocity and position of an incremental encoder from the time of its
+ * edges (1/T method).
+ *
+ * At low speed the count changes only every few control periods, so the
+ * count difference per period is a poor velocity measurement. Instead the
+ * rising edges of channel A are timestamped. They are exactly one quadrature
+ * cycle (4 counts) apart, independent of the phase error between A and B, so
+ * the velocity is 4 counts over the time between the last two edges.
+ *
+ * The estimate is blended with the PLL velocity by the edge spacing: with
+ * edges further apart than kMaxEdgePeriods control periods only the edge
+ * velocity is used, with edges closer than kMinEdgePeriods only the PLL.
+ *
+ * on_edge() is called from the capture interrupt and sample() from a context
+ * that this interrupt cannot preempt, so that the sampled pair of edges is
+ * consistent.
+ */
+class EdgeTiming {
+public:
+    static constexpr float kMinEdgePeriods = 1.0f;
+    static constexpr float kMaxEdgePeriods = 4.0f;
+
+    // Must not race with on_edge(), i.e. call it while the interrupt is disabled
+    void reset() {
+        n_edges_ = 0;
+    }
+
+    void on_edge(int16_t count, uint32_t timestamp) {
+        prev_count_ = last_count_;
+        prev_timestamp_ = last_timestamp_;
+        last_count_ = count;
+        last_timestamp_ = timestamp;
+        if (n_edges_ < 2) {
+            n_edges_++;
+        }
+    }
+
+    void sample(uint32_t timestamp) {
+        sampled_ = {prev_count_, last_count_, prev_timestamp_, last_timestamp_, n_edges_};
+        sample_timestamp_ = timestamp;
+    }
+
+    /**
+     * @brief Computes the estimates for the last sample().
+     *
+     * @param count: Timer count at the time of sample().
+     * @param pll_vel: Velocity of the PLL [count/s].
+     * @param clock_hz: Frequency of the timestamps.
+     * @param period: Control period [s].
+     * @param vel: Set to the blended velocity [count/s].
+     * @param interpolation: Set to the position within the current count,
+     *        in [0, 1].
+     * @returns false if there are no edges to go by or they are too close
+     *        together, in which case vel and interpolation are not set.
+     */
+    bool update(int16_t count, float pll_vel, float clock_hz, float period, float* vel, float* interpolation) const {
+        if (sampled_.n_edges < 2) {
+            return false;
+        }
+        int32_t delta_count = (int16_t)(sampled_.last_count - sampled_.prev_count);
+        float interval = (float)(uint32_t)(sampled_.last_timestamp - sampled_.prev_timestamp) / clock_hz;
+        float since_edge = (float)(uint32_t)(sample_timestamp_ - sampled_.last_timestamp) / clock_hz;
+        if (!(interval > 0.0f)) {
+            return false;
+        }
+
+        float weight = std::clamp((interval / period - kMinEdgePeriods) / (kMaxEdgePeriods - kMinEdgePeriods), 0.0f, 1.0f);
+        if (weight <= 0.0f) {
+            return false;
+        }
+
+        // Without a new edge the speed is at most one edge since the last one
+        float edge_vel = (float)delta_count / std::max(interval, since_edge);
+        *vel = pll_vel + weight * (edge_vel - pll_vel);
+
+        // The count changes at the edge, so the axis was at the lower end of
+        // the edge count when moving up and at the upper end when moving down
+        float edge_pos = (float)(int16_t)(sampled_.last_count - count) + (delta_count < 0 ? 1.0f : 0.0f);
+        *interpolation = std::clamp(edge_pos + edge_vel * since_edge, 0.0f, 1.0f);
+        return true;
+    }
+
+private:
+    struct Edges_t {
+        int16_t prev_count;
+        int16_t last_count;
+        uint32_t prev_timestamp;
+        uint32_t last_timestamp;
+        uint32_t n_edges;
+    };
+
+    volatile int16_t prev_count_ = 0;
+    volatile int16_t last_count_ = 0;
+    volatile uint32_t prev_timestamp_ = 0; // [clocks]
+    volatile uint32_t last_timestamp_ = 0; // [clocks]
+    volatile uint32_t n_edges_ = 0;
+
+    Edges_t sampled_ = {};
+    uint32_t sample_timestamp_ = 0; // [clocks]
+};
+
+#endif // __EDGE_TIMING_HPP
@@ -2,6 +2,7 @@
 #include "odrive_main.h"
 #include <Drivers/STM32/stm32_system.h>
 #include <bitset>
+#include "raw_cursor.hpp"
 
 Encoder::Encoder(TIM_HandleTypeDef* timer, Stm32Gpio index_gpio,
                  Stm32Gpio hallA_gpio, Stm32Gpio hallB_gpio, Stm32Gpio hallC_gpio,
@@ -16,6 +17,10 @@ static void enc_index_cb_wrapper(void* ctx) {
     reinterpret_cast<Encoder*>(ctx)->enc_index_cb();
 }
 
+static void enc_hall_edge_cb_wrapper(void* ctx) {
+    reinterpret_cast<Encoder*>(ctx)->enc_hall_edge_cb();
+}
+
 bool Encoder::apply_config(ODriveIntf::MotorIntf::MotorType motor_type) {
     config_.parent = this;
 
@@ -39,6 +44,16 @@ void Encoder::setup() {
 
     mode_ = config_.mode;
 
+    if (mode_ == MODE_HALL && config_.enable_edge_timing) {
+        hall_edge_timing_.reset();
+        hall_edge_timing_active_ = hallA_gpio_.subscribe(true, true, enc_hall_edge_cb_wrapper, this)
+                                && hallB_gpio_.subscribe(true, true, enc_hall_edge_cb_wrapper, this)
+                                && hallC_gpio_.subscribe(true, true, enc_hall_edge_cb_wrapper, this);
+        if (!hall_edge_timing_active_) {
+            odrv.misconfigured_ = true;
+        }
+    }
+
     spi_task_.config = {
         .Mode = SPI_MODE_MASTER,
         .Direction = SPI_DIRECTION_2LINES,
@@ -69,6 +84,9 @@ void Encoder::setup() {
 void Encoder::set_error(Error error) {
     vel_estimate_valid_ = false;
     pos_estimate_valid_ = false;
+    if (error & ~error_) {
+        odrv.journal_.log(Journal::JOURNAL_ENTRY_TYPE_ENCODER_ERROR, axis_->axis_num_, error, axis_->current_state_);
+    }
     error_ |= error;
 }
 
@@ -80,10 +98,61 @@ bool Encoder::do_checks(){
 // Hardware Dependent
 //--------------------
 
+// Triggered by a rising edge of channel A while edge timing is active
+void Encoder::enc_edge_cb() {
+    uint32_t timestamp = DWT->CYCCNT;
+    // The counter is read alongside the timestamp. Edges are far apart while
+    // this interrupt is enabled, so it still holds the count of the edge.
+    int16_t count = (int16_t)timer_->Instance->CNT;
+    // Reading the capture register clears the capture flag. An overcapture
+    // only means that the interrupt was late.
+    (void)timer_->Instance->CCR1;
+    timer_->Instance->SR = ~TIM_SR_CC1OF;
+    edge_timing_.on_edge(count, timestamp);
+}
+
+// Triggered by any edge of the hall sensors while edge timing is enabled
+void Encoder::enc_hall_edge_cb() {
+    uint32_t timestamp = DWT->CYCCNT;
+    uint8_t state = (hallA_gpio_.read() ? 1 : 0)
+                  | (hallB_gpio_.read() ? 2 : 0)
+                  | (hallC_gpio_.read() ? 4 : 0);
+    hall_edge_timing_.on_edge(state, timestamp);
+}
+
+// Enables the capture interrupt at low speed, where there are few edges per
+// control period. The edges are only reset while the interrupt is disabled.
+void Encoder::update_edge_timing_irq() {
+    float edges_per_period = std::abs(vel_estimate_counts_) * current_meas_period / 4.0f;
+    bool active = config_.enable_edge_timing && mode_ == MODE_INCREMENTAL
+            && edges_per_period < (edge_timing_active_ ? 1.0f : 0.5f);
+    if (active == edge_timing_active_)
+        return;
+
+    if (active) {
+        edge_timing_.reset();
+        __HAL_TIM_CLEAR_IT(timer_, TIM_IT_CC1);
+        __HAL_TIM_ENABLE_IT(timer_, TIM_IT_CC1);
+    } else {
+        __HAL_TIM_DISABLE_IT(timer_, TIM_IT_CC1);
+        edge_timing_.reset();
+    }
+    edge_timing_active_ = active;
+}
+
 // Triggered when an encoder passes over the "Index" pin
 // TODO: only arm index edge interrupt when we know encoder has powered up
 // (maybe by attaching the interrupt on start search, synergistic with following)
 void Encoder::enc_index_cb() {
+    if (latch_index_) {
+        // Homing only wants to know where the index is, the encoder state is
+        // not touched.
+        index_latched_count_ = read_live_count();
+        latch_index_ = false;
+        index_gpio_.unsubscribe();
+        return;
+    }
+
     if (config_.use_index) {
         set_circular_count(0, false);
         if (config_.use_index_offset)
@@ -106,6 +175,48 @@ void Encoder::enc_index_cb() {
     index_gpio_.unsubscribe();
 }
 
+/**
+ * @brief Records the encoder count at the next index pulse, without
+ * modifying the encoder state. The count is available from
+ * get_index_latched_count().
+ */
+bool Encoder::arm_index_latch() {
+    CRITICAL_SECTION() {
+        index_latched_count_ = std::nullopt;
+        latch_index_ = true;
+    }
+    return index_gpio_.subscribe(true, false, enc_index_cb_wrapper, this);
+}
+
+void Encoder::disarm_index_latch() {
+    if (latch_index_) {
+        latch_index_ = false;
+        index_gpio_.unsubscribe();
+    }
+}
+
+std::optional<int32_t> Encoder::get_index_latched_count() {
+    std::optional<int32_t> count;
+    CRITICAL_SECTION() {
+        count = index_latched_count_;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the encoder count at this instant, as opposed to
+ * shadow_count_ which is only updated once per control loop iteration.
+ * This is only different from shadow_count_ for incremental encoders.
+ */
+int32_t Encoder::read_live_count() {
+    int32_t shadow_count = (int32_t)shadow_count_;
+    if (mode_ == MODE_INCREMENTAL) {
+        int16_t delta_enc_16 = (int16_t)timer_->Instance->CNT - (int16_t)shadow_count;
+        return shadow_count + (int32_t)delta_enc_16;
+    }
+    return shadow_count;
+}
+
 void Encoder::set_idx_subscribe(bool override_enable) {
     if (config_.use_index && (override_enable || !config_.find_idx_on_lockin_only)) {
         if (!index_gpio_.subscribe(true, false, enc_index_cb_wrapper, this)) {
@@ -117,8 +228,18 @@ void Encoder::set_idx_subscribe(bool override_enable) {
 }
 
 void Encoder::update_pll_gains() {
-    pll_kp_ = 2.0f * config_.bandwidth;  // basic conversion to discrete time
-    pll_ki_ = 0.25f * (pll_kp_ * pll_kp_); // Critically damped
+    if (config_.estimator == ESTIMATOR_KALMAN) {
+        float cpr = (float)config_.cpr;
+        if (!compute_kalman_gains(config_.kalman_process_noise * cpr * cpr, config_.kalman_measurement_noise,
+                                  current_meas_period, &pll_kp_, &pll_ki_, &pll_ka_)) {
+            set_error(ERROR_UNSTABLE_GAIN);
+        }
+    } else {
+        pll_kp_ = 2.0f * config_.bandwidth;  // basic conversion to discrete time
+        pll_ki_ = 0.25f * (pll_kp_ * pll_kp_); // Critically damped
+        pll_ka_ = 0.0f;
+        acc_estimate_counts_ = 0.0f;
+    }
 
     // Check that we don't get problems with discrete time approximation
     if (!(current_meas_period * pll_kp_ < 1.0f)) {
@@ -136,6 +257,26 @@ void Encoder::check_pre_calibrated() {
     }
 }
 
+// @brief Returns shadow_count_ outside of the control loop. The control loop
+// updates it and 64-bit accesses are not atomic.
+int64_t Encoder::get_shadow_count() {
+    int64_t shadow_count;
+    CRITICAL_SECTION() {
+        shadow_count = shadow_count_;
+    }
+    return shadow_count;
+}
+
+// @brief Returns pos_estimate_counts_ outside of the control loop, see
+// get_shadow_count().
+Position Encoder::get_pos_estimate_counts() {
+    Position pos;
+    CRITICAL_SECTION() {
+        pos = pos_estimate_counts_;
+    }
+    return pos;
+}
+
 // Function that sets the current encoder count to a desired 32-bit value.
 void Encoder::set_linear_count(int32_t count) {
     // Disable interrupts to make a critical section to avoid race condition
@@ -143,8 +284,9 @@ void Encoder::set_linear_count(int32_t count) {
 
     // Update states
     shadow_count_ = count;
-    pos_estimate_counts_ = (float)count;
+    pos_estimate_counts_ = Position::from_count(count);
     tim_cnt_sample_ = count;
+    edge_timing_.reset();
 
     //Write hardware last
     timer_->Instance->CNT = count;
@@ -180,7 +322,7 @@ bool Encoder::run_index_search() {
 }
 
 bool Encoder::run_direction_find() {
-    int32_t init_enc_val = shadow_count_;
+    int64_t init_enc_val = get_shadow_count();
 
     Axis::LockinConfig_t lockin_config = axis_->config_.calibration_lockin;
     lockin_config.finish_distance = lockin_config.vel * 3.0f; // run for 3 seconds
@@ -191,10 +333,10 @@ bool Encoder::run_direction_find() {
 
     if (success) {
         // Check response and direction
-        if (shadow_count_ > init_enc_val + 8) {
+        if (get_shadow_count() > init_enc_val + 8) {
             // motor same dir as encoder
             config_.direction = 1;
-        } else if (shadow_count_ < init_enc_val - 8) {
+        } else if (get_shadow_count() < init_enc_val - 8) {
             // motor opposite dir as encoder
             config_.direction = -1;
         } else {
@@ -281,14 +423,23 @@ bool Encoder::run_hall_phase_calibration() {
         return true;
     };
 
-    // TODO: There is a race condition here with the execution in Encoder::update.
-    // We should evaluate making thread execution synchronous with the control loops
-    // at least optionally.
-    // Perhaps the new loop_sync feature will give a loose timing guarantee that may be sufficient
-    calibrate_hall_phase_ = true;
+    // Encoder::update() accumulates the edges in the control loop, so the
+    // state is handed over with interrupts disabled
+    uint32_t prim = cpu_enter_critical();
     config_.hall_edge_phcnt.fill(0.0f);
     hall_phase_calib_seen_count_.fill(0);
+    last_hall_cnt_ = std::nullopt;
+    sample_hall_phase_ = false;
+    calibrate_hall_phase_ = true;
+    cpu_exit_critical(prim);
+
     bool success = axis_->run_lockin_spin(lockin_config, false, loop_cb);
+
+    // Stop accumulating before the results are evaluated
+    prim = cpu_enter_critical();
+    sample_hall_phase_ = false;
+    cpu_exit_critical(prim);
+
     if (error_ & ERROR_ILLEGAL_HALL_STATE)
         success = false;
 
@@ -321,6 +472,74 @@ bool Encoder::run_hall_phase_calibration() {
     return success;
 }
 
+// @brief Spins the motor in lockin at a constant velocity and collects the
+// error of an absolute encoder against its raw position.
+bool Encoder::run_eccentricity_calibration() {
+    if (!(mode_ & MODE_FLAG_ABS)) {
+        set_error(ERROR_UNSUPPORTED_ENCODER_MODE);
+        return false;
+    }
+
+    Axis::LockinConfig_t lockin_config = axis_->config_.calibration_lockin;
+    lockin_config.finish_distance = std::copysign(kEccentricityCalibTurns * 2.0f * (float)M_PI
+            * (float)axis_->motor_.config_.pole_pairs, lockin_config.vel);
+    lockin_config.finish_on_distance = true;
+    lockin_config.finish_on_enc_idx = false;
+    lockin_config.finish_on_vel = false;
+
+    auto loop_cb = [this](bool const_vel) {
+        if (const_vel)
+            sample_eccentricity_ = true;
+        // No need to cancel early
+        return true;
+    };
+
+    // Encoder::update() feeds the calibrator in the control loop
+    uint32_t prim = cpu_enter_critical();
+    eccentricity_calibrator_.start(config_.cpr, current_meas_period);
+    sample_eccentricity_ = false;
+    cpu_exit_critical(prim);
+
+    bool success = axis_->run_lockin_spin(lockin_config, false, loop_cb);
+
+    prim = cpu_enter_critical();
+    sample_eccentricity_ = false;
+    cpu_exit_critical(prim);
+
+    calib_eccentricity_rms_ = eccentricity_calibrator_.residual_rms();
+    // The spin-up and the first turn are not part of the table
+    EccentricityLut lut;
+    if (success && !eccentricity_calibrator_.finish(kEccentricityCalibTurns - 4.0f, &lut)) {
+        set_error(ERROR_ECCENTRICITY_CALIBRATION_FAILED);
+        success = false;
+    }
+
+    // The control loop applies the table if the compensation is enabled
+    if (success) {
+        CRITICAL_SECTION() {
+            config_.eccentricity_lut = lut;
+        }
+    }
+
+    return success;
+}
+
+// @brief Returns the next 8 bytes (4 entries) of the eccentricity table and
+// advances eccentricity_lut_offset_. Reading past the end returns 0.
+uint64_t Encoder::read_eccentricity_lut() {
+    return raw_read(config_.eccentricity_lut.data(), sizeof(config_.eccentricity_lut), &eccentricity_lut_offset_);
+}
+
+// @brief Overwrites the next 8 bytes (4 entries) of the eccentricity table and
+// advances eccentricity_lut_offset_. Writes past the end are ignored.
+// The entries are replaced at once so that the control loop never sees a
+// partially written value.
+void Encoder::write_eccentricity_lut(uint64_t value) {
+    CRITICAL_SECTION() {
+        raw_write(config_.eccentricity_lut.data(), sizeof(config_.eccentricity_lut), &eccentricity_lut_offset_, value);
+    }
+}
+
 // @brief Turns the motor in one direction for a bit and then in the other
 // direction in order to find the offset between the electrical phase 0
 // and the encoder state 0.
@@ -338,11 +557,11 @@ bool Encoder::run_offset_calibration() {
         return false;
     }
 
-    // We use shadow_count_ to do the calibration, but the offset is used by count_in_cpr_
-    // Therefore we have to sync them for calibration
-    shadow_count_ = count_in_cpr_;
-
     CRITICAL_SECTION() {
+        // We use shadow_count_ to do the calibration, but the offset is used by count_in_cpr_
+        // Therefore we have to sync them for calibration
+        shadow_count_ = count_in_cpr_;
+
         // Reset state variables
         axis_->open_loop_controller_.Idq_setpoint_ = {0.0f, 0.0f};
         axis_->open_loop_controller_.Vdq_setpoint_ = {0.0f, 0.0f};
@@ -386,8 +605,11 @@ bool Encoder::run_offset_calibration() {
         osDelay(1);
     }
 
+    if (config_.calib_fit_enable) {
+        return run_offset_calibration_fit();
+    }
 
-    int32_t init_enc_val = shadow_count_;
+    int64_t init_enc_val = get_shadow_count();
     uint32_t num_steps = 0;
     int64_t encvaluesum = 0;
 
@@ -402,16 +624,16 @@ bool Encoder::run_offset_calibration() {
         if (reached_target_dist) {
             break;
         }
-        encvaluesum += shadow_count_;
+        encvaluesum += get_shadow_count();
         num_steps++;
         osDelay(1);
     }
 
     // Check response and direction
-    if (shadow_count_ > init_enc_val + 8) {
+    if (get_shadow_count() > init_enc_val + 8) {
         // motor same dir as encoder
         config_.direction = 1;
-    } else if (shadow_count_ < init_enc_val - 8) {
+    } else if (get_shadow_count() < init_enc_val - 8) {
         // motor opposite dir as encoder
         config_.direction = -1;
     } else {
@@ -424,7 +646,7 @@ bool Encoder::run_offset_calibration() {
     // Check CPR
     float elec_rad_per_enc = axis_->motor_.config_.pole_pairs * 2 * M_PI * (1.0f / (float)(config_.cpr));
     float expected_encoder_delta = config_.calib_scan_distance / elec_rad_per_enc;
-    calib_scan_response_ = std::abs(shadow_count_ - init_enc_val);
+    calib_scan_response_ = (float)std::abs(get_shadow_count() - init_enc_val);
     if (std::abs(calib_scan_response_ - expected_encoder_delta) / expected_encoder_delta > config_.calib_range) {
         set_error(ERROR_CPR_POLEPAIRS_MISMATCH);
         axis_->motor_.disarm();
@@ -441,7 +663,7 @@ bool Encoder::run_offset_calibration() {
         if (reached_target_dist) {
             break;
         }
-        encvaluesum += shadow_count_;
+        encvaluesum += get_shadow_count();
         num_steps++;
         osDelay(1);
     }
@@ -461,22 +683,115 @@ bool Encoder::run_offset_calibration() {
     return true;
 }
 
-static bool decode_hall(uint8_t hall_state, int32_t* hall_cnt) {
-    switch (hall_state) {
-        case 0b001: *hall_cnt = 0; return true;
-        case 0b011: *hall_cnt = 1; return true;
-        case 0b010: *hall_cnt = 2; return true;
-        case 0b110: *hall_cnt = 3; return true;
-        case 0b100: *hall_cnt = 4; return true;
-        case 0b101: *hall_cnt = 5; return true;
-        default: return false;
+/**
+ * @brief Variant of the offset calibration scan that is used if
+ * `calib_fit_enable` is set. Must be called after the motor is armed and locked
+ * at the start position of the scan.
+ *
+ * The encoder count is regressed against the open loop electrical phase at the
+ * control loop rate (see update()). The forward scan ends as soon as the
+ * encoder follows the fitted line within calib_fit_max_residual (but not
+ * before calib_fit_min_distance) and then returns by the same distance so that
+ * the lag of the rotor behind the open loop phase cancels out. A noisy or
+ * cogging scan therefore continues up to calib_scan_distance to average out.
+ */
+bool Encoder::run_offset_calibration_fit() {
+    float elec_rad_per_enc = axis_->motor_.config_.pole_pairs * 2 * M_PI * (1.0f / (float)(config_.cpr));
+    float expected_slope = 1.0f / elec_rad_per_enc; // [count/rad]
+    int64_t init_enc_val = get_shadow_count();
+
+    CRITICAL_SECTION() {
+        offset_fit_.reset();
+        offset_fit_origin_ = init_enc_val;
+        offset_fit_initial_phase_ = axis_->open_loop_controller_.initial_phase_;
+        offset_fit_active_ = true;
+        axis_->open_loop_controller_.target_vel_ = config_.calib_scan_omega;
+        axis_->open_loop_controller_.total_distance_ = 0.0f;
+    }
+
+    // scan forward until the fit converged
+    float scan_distance = 0.0f;
+    while ((axis_->requested_state_ == Axis::AXIS_STATE_UNDEFINED) && axis_->motor_.is_armed_) {
+        scan_distance = axis_->open_loop_controller_.total_distance_.any().value_or(0.0f);
+        if (scan_distance >= config_.calib_scan_distance) {
+            break;
+        }
+        if (scan_distance >= config_.calib_fit_min_distance) {
+            RunningLinearFit fit;
+            CRITICAL_SECTION() {
+                fit = offset_fit_;
+            }
+            if (fit.fits_within(config_.calib_fit_max_residual * expected_slope, 3)) {
+                break;
+            }
+        }
+        osDelay(1);
+    }
+
+    CRITICAL_SECTION() {
+        axis_->open_loop_controller_.target_vel_ = -config_.calib_scan_omega;
+    }
+
+    // scan backwards
+    while ((axis_->requested_state_ == Axis::AXIS_STATE_UNDEFINED) && axis_->motor_.is_armed_) {
+        bool reached_target_dist = axis_->open_loop_controller_.total_distance_.any().value_or(INFINITY) <= 0.0f;
+        if (reached_target_dist) {
+            break;
+        }
+        osDelay(1);
+    }
+
+    RunningLinearFit fit;
+    CRITICAL_SECTION() {
+        offset_fit_active_ = false;
+        fit = offset_fit_;
+    }
+
+    // Motor disarmed because of an error
+    if (!axis_->motor_.is_armed_) {
+        return false;
+    }
+
+    axis_->motor_.disarm();
+
+    // Check response and direction
+    float slope = fit.slope();
+    calib_scan_response_ = std::abs(slope) * scan_distance;
+    if (calib_scan_response_ < 8.0f) {
+        set_error(ERROR_NO_RESPONSE);
+        return false;
     }
+    config_.direction = slope > 0.0f ? 1 : -1;
+
+    // Check CPR
+    if (std::abs(std::abs(slope) - expected_slope) / expected_slope > config_.calib_range) {
+        set_error(ERROR_CPR_POLEPAIRS_MISMATCH);
+        return false;
+    }
+
+    // The phase offset is the encoder count at electrical phase 0. Any multiple
+    // of 2*pi is equivalent so we pick the one closest to the middle of the
+    // scan to avoid extrapolating the fit.
+    float mid_phase = offset_fit_initial_phase_ + 0.5f * scan_distance;
+    float zero_phase = 2.0f * M_PI * std::round(mid_phase / (2.0f * M_PI));
+    float offset = fit.intercept() + slope * zero_phase;
+    float offset_int = std::floor(offset);
+    config_.phase_offset = (int32_t)(init_enc_val + (int64_t)offset_int);
+    config_.phase_offset_float = (offset - offset_int) + 0.5f;  // add 0.5 to center-align state to phase
+    calib_fit_residual_ = fit.residual_rms() * elec_rad_per_enc;
+
+    is_ready_ = true;
+    return true;
 }
 
 void Encoder::sample_now() {
+    sample_time_ = axis_->task_times_.encoder_latency.start();
+
     switch (mode_) {
         case MODE_INCREMENTAL: {
             tim_cnt_sample_ = (int16_t)timer_->Instance->CNT;
+            // The edge interrupt has a lower priority, so the edges don't change meanwhile
+            edge_timing_.sample(DWT->CYCCNT);
         } break;
 
         case MODE_HALL: {
@@ -494,8 +809,7 @@ void Encoder::sample_now() {
         case MODE_SPI_ABS_RLS:
         case MODE_SPI_ABS_MA732:
         {
-            abs_spi_start_transaction();
-            // Do nothing
+            // The read was started at the beginning of ODrive::sampling_cb()
         } break;
 
         default: {
@@ -507,6 +821,12 @@ void Encoder::sample_now() {
     for (size_t i = 0; i < sizeof(ports_to_sample) / sizeof(ports_to_sample[0]); ++i) {
         port_samples_[i] = ports_to_sample[i]->IDR;
     }
+
+    // An edge after the GPIO samples is not recorded either, since the hall
+    // edge interrupt has a lower priority
+    if (mode_ == MODE_HALL) {
+        hall_edge_timing_.sample(DWT->CYCCNT);
+    }
 }
 
 bool Encoder::read_sampled_gpio(Stm32Gpio gpio) {
@@ -527,12 +847,17 @@ void Encoder::decode_hall_samples() {
 bool Encoder::abs_spi_start_transaction() {
     if (mode_ & MODE_FLAG_ABS){
         if (Stm32SpiArbiter::acquire_task(&spi_task_)) {
+            abs_spi_start_cycles_ = DWT->CYCCNT;
+            abs_spi_sample_time_ = axis_->task_times_.encoder_latency.start();
             spi_task_.ncs_gpio = abs_spi_cs_gpio_;
             spi_task_.tx_buf = (uint8_t*)abs_spi_dma_tx_;
             spi_task_.rx_buf = (uint8_t*)abs_spi_dma_rx_;
             spi_task_.length = 1;
             spi_task_.on_complete = [](void* ctx, bool success) { ((Encoder*)ctx)->abs_spi_cb(success); };
             spi_task_.on_complete_ctx = this;
+            // Ahead of slower users such as the gate drivers
+            spi_task_.priority = 1;
+            spi_task_.deadline = abs_spi_start_cycles_ + kAbsSpiDeadline;
             spi_task_.next = nullptr;
             
             spi_arbiter_->transfer_async(&spi_task_);
@@ -601,6 +926,7 @@ void Encoder::abs_spi_cb(bool success) {
     }
 
     pos_abs_ = pos;
+    pos_abs_sample_time_ = abs_spi_sample_time_;
     abs_spi_pos_updated_ = true;
     if (config_.pre_calibrated) {
         is_ready_ = true;
@@ -626,10 +952,10 @@ void Encoder::abs_spi_cs_pin_init(){
 }
 
 // Note that this may return counts +1 or -1 without any wrapping
-int32_t Encoder::hall_model(float internal_pos) {
-    int32_t base_cnt = (int32_t)std::floor(internal_pos);
+int64_t Encoder::hall_model(const Position& internal_pos) {
+    int64_t base_cnt = internal_pos.whole();
 
-    float pos_in_range = fmodf_pos(internal_pos, 6.0f);
+    float pos_in_range = (float)mod((int32_t)(internal_pos.whole() % 6), 6) + internal_pos.frac();
     int pos_idx = (int)pos_in_range;
     if (pos_idx == 6) pos_idx = 5; // in case of rounding error
     int next_i = (pos_idx == 5) ? 0 : pos_idx+1;
@@ -648,14 +974,25 @@ int32_t Encoder::hall_model(float internal_pos) {
 }
 
 bool Encoder::update() {
+    // A read that is still in flight is given until its deadline to complete,
+    // so that it's used in this iteration rather than the next one
+    if (mode_ & MODE_FLAG_ABS) {
+        while (__atomic_load_n(&spi_task_.is_in_use, __ATOMIC_ACQUIRE)
+                && (int32_t)(DWT->CYCCNT - (abs_spi_start_cycles_ + kAbsSpiDeadline)) < 0) {
+        }
+    }
+
     // update internal encoder state.
     int32_t delta_enc = 0;
     int32_t pos_abs_latched = pos_abs_; //LATCH
+    std::optional<float> meas_interpolation; // position within the count, if the sensor resolves it
+    bool sample_is_new = !(mode_ & MODE_FLAG_ABS) || abs_spi_pos_updated_;
+    if (mode_ & MODE_FLAG_ABS) {
+        sample_time_ = pos_abs_sample_time_;
+    }
 
     switch (mode_) {
         case MODE_INCREMENTAL: {
-            //TODO: use count_in_cpr_ instead as shadow_count_ can overflow
-            //or use 64 bit
             int16_t delta_enc_16 = (int16_t)tim_cnt_sample_ - (int16_t)shadow_count_;
             delta_enc = (int32_t)delta_enc_16; //sign extend
         } break;
@@ -685,6 +1022,14 @@ bool Encoder::update() {
                             auto maybe_phase = axis_->open_loop_controller_.phase_.any();
                             if (maybe_phase) {
                                 float phase = maybe_phase.value();
+                                // With edge timing, take the phase at the edge
+                                // rather than at this sample
+                                float since_edge;
+                                auto maybe_phase_vel = axis_->open_loop_controller_.phase_vel_.any();
+                                if (hall_edge_timing_active_ && maybe_phase_vel
+                                        && hall_edge_timing_.time_since_edge(hall_state_, (float)SystemCoreClock, &since_edge)) {
+                                    phase = wrap_pm_pi(phase - *maybe_phase_vel * since_edge);
+                                }
                                 // Early increment to get the right divisor in recursive average
                                 hall_phase_calib_seen_count_[edge_idx]++;
                                 float& edge_phase = config_.hall_edge_phcnt[edge_idx];
@@ -717,14 +1062,29 @@ bool Encoder::update() {
         } break;
 
         case MODE_SINCOS: {
-            float phase = fast_atan2(sincos_sample_s_, sincos_sample_c_);
-            int fake_count = (int)(1000.0f * phase);
-            //CPR = 6283 = 2pi * 1k
+            float phase;
+            if (config_.enable_sincos_calibration) {
+                if (!sincos_calibrator_valid_) {
+                    sincos_calibrator_.reset(sincos_sample_s_, sincos_sample_c_);
+                    sincos_calibrator_valid_ = true;
+                }
+                phase = sincos_calibrator_.update(sincos_sample_s_, sincos_sample_c_, config_.sincos_calibration_rate);
+            } else {
+                sincos_calibrator_valid_ = false;
+                phase = fast_atan2(sincos_sample_s_, sincos_sample_c_);
+            }
+
+            // The phase resolves the position within the count, the whole
+            // periods are counted
+            int32_t counts_per_period = config_.cpr / (int32_t)std::max(config_.sincos_periods, (uint32_t)1);
+            float pos_in_period = fmodf_pos(phase * (0.5f / (float)M_PI), 1.0f) * (float)counts_per_period;
+            int32_t fake_count = std::min((int32_t)pos_in_period, counts_per_period - 1);
+            meas_interpolation = std::clamp(pos_in_period - (float)fake_count, 0.0f, 1.0f);
 
             delta_enc = fake_count - count_in_cpr_;
-            delta_enc = mod(delta_enc, 6283);
-            if (delta_enc > 6283/2)
-                delta_enc -= 6283;
+            delta_enc = mod(delta_enc, counts_per_period);
+            if (delta_enc > counts_per_period/2)
+                delta_enc -= counts_per_period;
         } break;
         
         case MODE_SPI_ABS_RLS:
@@ -745,6 +1105,18 @@ bool Encoder::update() {
             }
 
             abs_spi_pos_updated_ = false;
+
+            if (sample_eccentricity_) {
+                eccentricity_calibrator_.push(sample_is_new ? std::make_optional(pos_abs_latched) : std::nullopt);
+            }
+            if (config_.enable_eccentricity_compensation) {
+                float pos_meas = (float)pos_abs_latched + 0.5f;
+                pos_meas -= eccentricity_error(config_.eccentricity_lut, config_.cpr, pos_meas);
+                pos_meas = fmodf_pos(pos_meas, (float)config_.cpr);
+                pos_abs_latched = std::min((int32_t)pos_meas, config_.cpr - 1);
+                meas_interpolation = std::clamp(pos_meas - (float)pos_abs_latched, 0.0f, 1.0f);
+            }
+
             delta_enc = pos_abs_latched - count_in_cpr_; //LATCH
             delta_enc = mod(delta_enc, config_.cpr);
             if (delta_enc > config_.cpr/2) {
@@ -758,10 +1130,21 @@ bool Encoder::update() {
         } break;
     }
 
+    if (sample_is_new) {
+        axis_->task_times_.encoder_latency.stop_across_period(sample_time_);
+    }
+
     shadow_count_ += delta_enc;
     count_in_cpr_ += delta_enc;
     count_in_cpr_ = mod(count_in_cpr_, config_.cpr);
 
+    if (offset_fit_active_) {
+        std::optional<float> distance = axis_->open_loop_controller_.total_distance_.any();
+        if (distance.has_value()) {
+            offset_fit_.push(offset_fit_initial_phase_ + *distance, (float)(shadow_count_ - offset_fit_origin_));
+        }
+    }
+
     if(mode_ & MODE_FLAG_ABS)
         count_in_cpr_ = pos_abs_latched;
 
@@ -769,19 +1152,32 @@ bool Encoder::update() {
     float pos_cpr_counts_last = pos_cpr_counts_;
 
     //// run pll (for now pll is in units of encoder counts)
+    // The Kalman estimator is the same loop with an acceleration state.
     // Predict current pos
-    pos_estimate_counts_ += current_meas_period * vel_estimate_counts_;
-    pos_cpr_counts_      += current_meas_period * vel_estimate_counts_;
+    float delta_pos_predicted = current_meas_period * (vel_estimate_counts_ + 0.5f * current_meas_period * acc_estimate_counts_);
+    pos_estimate_counts_ += delta_pos_predicted;
+    pos_cpr_counts_      += delta_pos_predicted;
+    vel_estimate_counts_ += current_meas_period * acc_estimate_counts_;
     // Encoder model
-    auto encoder_model = [this](float internal_pos)->int32_t {
+    auto encoder_model = [this](const Position& internal_pos)->int64_t {
         if (config_.mode == MODE_HALL)
             return hall_model(internal_pos);
         else
-            return (int32_t)std::floor(internal_pos);
+            return internal_pos.whole();
     };
     // discrete phase detector
     float delta_pos_counts = (float)(shadow_count_ - encoder_model(pos_estimate_counts_));
     float delta_pos_cpr_counts = (float)(count_in_cpr_ - encoder_model(pos_cpr_counts_));
+    if (meas_interpolation.has_value()) {
+        // The sensor measures the position within the count
+        delta_pos_counts = Position::from_count(shadow_count_, *meas_interpolation) - pos_estimate_counts_;
+        delta_pos_cpr_counts = (float)count_in_cpr_ + *meas_interpolation - pos_cpr_counts_;
+    } else if (config_.estimator == ESTIMATOR_KALMAN && config_.mode != MODE_HALL) {
+        // The Kalman filter models the count as the position plus quantization
+        // noise, so it compares against the middle of the count
+        delta_pos_counts = Position::from_count(shadow_count_, 0.5f) - pos_estimate_counts_;
+        delta_pos_cpr_counts = (float)count_in_cpr_ + 0.5f - pos_cpr_counts_;
+    }
     delta_pos_cpr_counts = wrap_pm(delta_pos_cpr_counts, (float)(config_.cpr));
     delta_pos_cpr_counts_ += 0.1f * (delta_pos_cpr_counts - delta_pos_cpr_counts_); // for debug
     // pll feedback
@@ -789,15 +1185,36 @@ bool Encoder::update() {
     pos_cpr_counts_ += current_meas_period * pll_kp_ * delta_pos_cpr_counts;
     pos_cpr_counts_ = fmodf_pos(pos_cpr_counts_, (float)(config_.cpr));
     vel_estimate_counts_ += current_meas_period * pll_ki_ * delta_pos_cpr_counts;
+    acc_estimate_counts_ += current_meas_period * pll_ka_ * delta_pos_cpr_counts;
+    // At low speed the time between the edges is a better measurement than
+    // the count. It replaces the snapping to zero velocity and the interpolation.
+    float edge_interpolation = 0.5f;
+    bool edge_valid = false;
+    if (mode_ == MODE_HALL) {
+        edge_valid = hall_edge_timing_active_ && config_.hall_polarity_calibrated
+                && hall_edge_timing_.update(config_.hall_polarity, config_.hall_edge_phcnt, mod(count_in_cpr_, 6),
+                                            vel_estimate_counts_, (float)SystemCoreClock, current_meas_period,
+                                            &vel_estimate_counts_, &edge_interpolation);
+    } else {
+        update_edge_timing_irq();
+        edge_valid = edge_timing_active_
+                && edge_timing_.update(tim_cnt_sample_, vel_estimate_counts_, (float)SystemCoreClock,
+                                       current_meas_period, &vel_estimate_counts_, &edge_interpolation);
+    }
     bool snap_to_zero_vel = false;
-    if (std::abs(vel_estimate_counts_) < 0.5f * current_meas_period * pll_ki_) {
+    if (!edge_valid && std::abs(vel_estimate_counts_) < 0.5f * current_meas_period * pll_ki_) {
         vel_estimate_counts_ = 0.0f;  //align delta-sigma on zero to prevent jitter
         snap_to_zero_vel = true;
     }
 
     // Outputs from Encoder for Controller
-    pos_estimate_ = pos_estimate_counts_ / (float)config_.cpr;
+    Position pos_estimate_turns = pos_estimate_counts_.divide(config_.cpr);
+    pos_estimate_turns_ = pos_estimate_turns;
+    pos_estimate_ = pos_estimate_turns.to_float();
     vel_estimate_ = vel_estimate_counts_ / (float)config_.cpr;
+    if (config_.estimator == ESTIMATOR_KALMAN) {
+        acc_estimate_ = acc_estimate_counts_ / (float)config_.cpr;
+    }
     
     // TODO: we should strictly require that this value is from the previous iteration
     // to avoid spinout scenarios. However that requires a proper way to reset
@@ -810,7 +1227,11 @@ bool Encoder::update() {
     //// run encoder count interpolation
     int32_t corrected_enc = count_in_cpr_ - config_.phase_offset;
     // if we are stopped, make sure we don't randomly drift
-    if (snap_to_zero_vel || !config_.enable_phase_interpolation) {
+    if (edge_valid) {
+        interpolation_ = edge_interpolation;
+    } else if (meas_interpolation.has_value()) {
+        interpolation_ = *meas_interpolation;
+    } else if (snap_to_zero_vel || !config_.enable_phase_interpolation) {
         interpolation_ = 0.5f;
     // reset interpolation if encoder edge comes
     // TODO: This isn't correct. At high velocities the first phase in this count may very well not be at the edge.
@@ -8,6 +8,12 @@ class Encoder;
 #include "utils.hpp"
 #include <autogen/interfaces.hpp>
 #include "component.hpp"
+#include "running_stats.hpp"
+#include "edge_timing.hpp"
+#include "hall_edge_timing.hpp"
+#include "sincos_calibrator.hpp"
+#include "eccentricity_lut.hpp"
+#include "position.hpp"
 
 
 class Encoder : public ODriveIntf::EncoderIntf {
@@ -21,7 +27,13 @@ public:
         float calib_range = 0.02f; // Accuracy required to pass encoder cpr check
         float calib_scan_distance = 16.0f * M_PI; // rad electrical
         float calib_scan_omega = 4.0f * M_PI; // rad/s electrical
+        bool calib_fit_enable = false; // Fit the offset by linear regression and end the scan as soon as the encoder follows the fit
+        float calib_fit_min_distance = 2.0f * M_PI; // rad electrical
+        float calib_fit_max_residual = 0.1f; // [rad] electrical, RMS deviation from the fit at which the scan may stop
         float bandwidth = 1000.0f;
+        Estimator estimator = ESTIMATOR_PLL;
+        float kalman_process_noise = 1e3f;            // [turn^2/s^5] power spectral density of the jerk
+        float kalman_measurement_noise = 0.2887f;     // [count] standard deviation, 1/sqrt(12) for quantization
         int32_t phase_offset = 0;        // Offset between encoder count and rotor electrical phase
         float phase_offset_float = 0.0f; // Sub-count phase alignment offset
         int32_t cpr = (2048 * 4);   // Default resolution of CUI-AMT102 encoder,
@@ -35,6 +47,7 @@ public:
         int32_t direction = 0; // direction with respect to motor
         bool use_index_offset = true;
         bool enable_phase_interpolation = true; // Use velocity to interpolate inside the count state
+        bool enable_edge_timing = false; // Timestamp the edges of incremental and hall encoders for velocity and interpolation at low speed
         bool find_idx_on_lockin_only = false; // Only be sensitive during lockin scan constant vel state
         bool ignore_illegal_hall_state = false; // dont error on bad states like 000 or 111
         uint8_t hall_polarity = 0;
@@ -43,6 +56,11 @@ public:
         uint16_t abs_spi_cs_gpio_pin = 1;
         uint16_t sincos_gpio_pin_sin = 3;
         uint16_t sincos_gpio_pin_cos = 4;
+        uint32_t sincos_periods = 1; // sin/cos periods per turn, each period has cpr / sincos_periods counts
+        bool enable_sincos_calibration = false; // Track offsets, amplitudes and quadrature error of the sin/cos signals
+        float sincos_calibration_rate = 0.1f; // Fraction of the signal model error that is corrected per period
+        bool enable_eccentricity_compensation = false; // Correct absolute encoders by eccentricity_lut
+        EccentricityLut eccentricity_lut = {}; // Error vs raw position, found by run_eccentricity_calibration()
 
 
         // custom setters
@@ -52,6 +70,9 @@ public:
         void set_abs_spi_cs_gpio_pin(uint16_t value) { abs_spi_cs_gpio_pin = value; parent->abs_spi_cs_pin_init(); }
         void set_pre_calibrated(bool value) { pre_calibrated = value; parent->check_pre_calibrated(); }
         void set_bandwidth(float value) { bandwidth = value; parent->update_pll_gains(); }
+        void set_estimator(Estimator value) { estimator = value; parent->update_pll_gains(); }
+        void set_kalman_process_noise(float value) { kalman_process_noise = value; parent->update_pll_gains(); }
+        void set_kalman_measurement_noise(float value) { kalman_measurement_noise = value; parent->update_pll_gains(); }
     };
 
     Encoder(TIM_HandleTypeDef* timer, Stm32Gpio index_gpio,
@@ -64,10 +85,18 @@ public:
     bool do_checks();
 
     void enc_index_cb();
+    void enc_edge_cb();
+    void enc_hall_edge_cb();
+    bool arm_index_latch();
+    void disarm_index_latch();
+    std::optional<int32_t> get_index_latched_count();
+    int32_t read_live_count();
     void set_idx_subscribe(bool override_enable = false);
     void update_pll_gains();
     void check_pre_calibrated();
 
+    int64_t get_shadow_count();
+    Position get_pos_estimate_counts();
     void set_linear_count(int32_t count);
     void set_circular_count(int32_t count, bool update_offset);
     bool calib_enc_offset(float voltage_magnitude);
@@ -76,11 +105,16 @@ public:
     bool run_direction_find();
     bool run_hall_polarity_calibration();
     bool run_hall_phase_calibration();
+    bool run_eccentricity_calibration();
+    uint64_t read_eccentricity_lut();
+    void write_eccentricity_lut(uint64_t value);
     bool run_offset_calibration();
+    bool run_offset_calibration_fit();
     void sample_now();
     bool read_sampled_gpio(Stm32Gpio gpio);
     void decode_hall_samples();
-    int32_t hall_model(float internal_pos);
+    int64_t hall_model(const Position& internal_pos);
+    void update_edge_timing_irq();
     bool update();
 
     TIM_HandleTypeDef* timer_;
@@ -95,30 +129,41 @@ public:
 
     Error error_ = ERROR_NONE;
     bool index_found_ = false;
+    bool latch_index_ = false; // if true, the next index pulse only records index_latched_count_
+    std::optional<int32_t> index_latched_count_;
     bool is_ready_ = false;
-    int32_t shadow_count_ = 0;
+    int64_t shadow_count_ = 0; // interrupts only read the lower 32 bits, which are written atomically. Threads use get_shadow_count().
     int32_t count_in_cpr_ = 0;
     float interpolation_ = 0.0f;
     OutputPort<float> phase_ = 0.0f;     // [rad]
     OutputPort<float> phase_vel_ = 0.0f; // [rad/s]
-    float pos_estimate_counts_ = 0.0f;  // [count]
+    Position pos_estimate_counts_;  // [count]
     float pos_cpr_counts_ = 0.0f;  // [count]
     float delta_pos_cpr_counts_ = 0.0f;  // [count] phase detector result for debug
     float vel_estimate_counts_ = 0.0f;  // [count/s]
+    float acc_estimate_counts_ = 0.0f;  // [count/s^2] only tracked by ESTIMATOR_KALMAN
     float pll_kp_ = 0.0f;   // [count/s / count]
     float pll_ki_ = 0.0f;   // [(count/s^2) / count]
+    float pll_ka_ = 0.0f;   // [(count/s^3) / count] 0 for ESTIMATOR_PLL
     float calib_scan_response_ = 0.0f; // debug report from offset calib
+    float calib_fit_residual_ = 0.0f; // [rad] RMS residual of the offset calib fit
     int32_t pos_abs_ = 0;
     float spi_error_rate_ = 0.0f;
 
     OutputPort<float> pos_estimate_ = 0.0f; // [turn]
+    OutputPort<Position> pos_estimate_turns_ = Position(); // [turn] pos_estimate_ without the float rounding far from zero
     OutputPort<float> vel_estimate_ = 0.0f; // [turn/s]
+    OutputPort<float> acc_estimate_ = 0.0f; // [turn/s^2] only present with ESTIMATOR_KALMAN
     OutputPort<float> pos_circular_ = 0.0f; // [turn]
 
     bool pos_estimate_valid_ = false;
     bool vel_estimate_valid_ = false;
 
     int16_t tim_cnt_sample_ = 0; // 
+    EdgeTiming edge_timing_;
+    bool edge_timing_active_ = false; // the capture interrupt of the encoder timer is enabled
+    HallEdgeTiming hall_edge_timing_;
+    bool hall_edge_timing_active_ = false; // the hall GPIOs are subscribed
     static const constexpr GPIO_TypeDef* ports_to_sample[] = { GPIOA, GPIOB, GPIOC };
     uint16_t port_samples_[sizeof(ports_to_sample) / sizeof(ports_to_sample[0])];
     // Updated by low_level pwm_adc_cb
@@ -130,13 +175,40 @@ public:
     std::array<int, 8> states_seen_count_; // for hall polarity calibration
     std::array<int, 6> hall_phase_calib_seen_count_;
 
+    bool offset_fit_active_ = false;
+    int64_t offset_fit_origin_ = 0;
+    float offset_fit_initial_phase_ = 0.0f;
+    RunningLinearFit offset_fit_; // open loop phase [rad] vs encoder count relative to offset_fit_origin_
+
     float sincos_sample_s_ = 0.0f;
     float sincos_sample_c_ = 0.0f;
+    struct FastTrig {
+        static float atan2(float y, float x) { return fast_atan2(y, x); }
+        static float sin(float x) { return our_arm_sin_f32(x); }
+        static float cos(float x) { return our_arm_cos_f32(x); }
+    };
+    BasicSinCosCalibrator<FastTrig> sincos_calibrator_;
+    bool sincos_calibrator_valid_ = false; // initialized from the first sample with enable_sincos_calibration
+
+    // Turns of the eccentricity calibration, including the spin-up
+    static constexpr float kEccentricityCalibTurns = 12.0f;
+    EccentricityCalibrator eccentricity_calibrator_;
+    bool sample_eccentricity_ = false;
+    float calib_eccentricity_rms_ = 0.0f; // [count] RMS error before compensation
+    uint32_t eccentricity_lut_offset_ = 0; // [bytes] position of the next access to eccentricity_lut over the protocol
+
+    // A read that has not started by then is dropped, and the control loop
+    // waits for a read in flight until then
+    static constexpr uint32_t kAbsSpiDeadline = CONTROL_TIMER_PERIOD_TICKS / 4; // [clocks]
 
     bool abs_spi_start_transaction();
     void abs_spi_cb(bool success);
     void abs_spi_cs_pin_init();
     bool abs_spi_pos_updated_ = false;
+    uint32_t abs_spi_start_cycles_ = 0; // [DWT cycles] start of the read in flight
+    uint32_t abs_spi_sample_time_ = 0; // task timer time of the read in flight
+    uint32_t pos_abs_sample_time_ = 0; // task timer time of pos_abs_
+    uint32_t sample_time_ = 0; // task timer time of the sample that update() uses
     Mode mode_ = MODE_INCREMENTAL;
     Stm32Gpio abs_spi_cs_gpio_;
     uint32_t abs_spi_cr1;
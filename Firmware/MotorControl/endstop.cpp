@@ -1,5 +1,8 @@
 #include <odrive_main.h>
 
+static void endstop_latch_cb_wrapper(void* ctx) {
+    reinterpret_cast<Endstop*>(ctx)->latch_cb();
+}
 
 void Endstop::update() {
     debounceTimer_.update();
@@ -10,14 +13,61 @@ void Endstop::update() {
         pin_state_ = get_gpio(config_.gpio_num).read();
 
         // If the pin state has changed, reset the timer
-        if (pin_state_ != last_pin_state)
+        if (pin_state_ != last_pin_state) {
             debounceTimer_.reset();
+            bool pressed = config_.is_active_high ? pin_state_ : !pin_state_;
+            if (latch_armed_ && !latch_subscribed_ && pressed)
+                edge_count_ = (int32_t)axis_->encoder_.shadow_count_;
+        }
 
         if (debounceTimer_.expired())
             endstop_state_ = config_.is_active_high ? pin_state_ : !pin_state_;  // endstop_state is the logical state
     } else {
         endstop_state_ = false;
     }
+
+    if (latch_armed_ && rose() && !latched_count_.has_value())
+        latched_count_ = edge_count_;
+}
+
+/**
+ * @brief Starts recording the encoder count at which the endstop gets pressed.
+ *
+ * If possible the edge is captured by an interrupt which yields the exact
+ * encoder count. Otherwise it is captured at the control loop rate.
+ * The count of the first press that passes the debounce filter is available
+ * from get_latched_count().
+ */
+void Endstop::arm_latch() {
+    CRITICAL_SECTION() {
+        latched_count_ = std::nullopt;
+        edge_count_ = (int32_t)axis_->encoder_.shadow_count_;
+        latch_armed_ = true;
+    }
+    latch_subscribed_ = config_.enabled && get_gpio(config_.gpio_num).subscribe(
+            config_.is_active_high, !config_.is_active_high, endstop_latch_cb_wrapper, this);
+}
+
+void Endstop::disarm_latch() {
+    if (latch_subscribed_) {
+        get_gpio(config_.gpio_num).unsubscribe();
+        latch_subscribed_ = false;
+    }
+    latch_armed_ = false;
+}
+
+void Endstop::latch_cb() {
+    if (latch_armed_) {
+        edge_count_ = axis_->encoder_.read_live_count();
+    }
+}
+
+std::optional<int32_t> Endstop::get_latched_count() {
+    std::optional<int32_t> count;
+    CRITICAL_SECTION() {
+        count = latched_count_;
+    }
+    return count;
 }
 
 bool Endstop::apply_config() {
@@ -2,6 +2,7 @@
 #define __ENDSTOP_HPP
 
 #include "timer.hpp"
+#include <optional>
 class Endstop {
    public:
     struct Config_t {
@@ -10,6 +11,7 @@ class Endstop {
         uint16_t gpio_num = 0;
         bool enabled = false;
         bool is_active_high = false;
+        bool home_on_index = false; // Home on the first encoder index pulse after the endstop was pressed
 
         // custom setters
         Endstop* parent = nullptr;
@@ -26,6 +28,10 @@ class Endstop {
     bool apply_config();
 
     void update();
+    void arm_latch();
+    void disarm_latch();
+    void latch_cb();
+    std::optional<int32_t> get_latched_count();
     constexpr bool get_state(){
         return endstop_state_;
     }
@@ -43,7 +49,10 @@ class Endstop {
    private:
     bool last_state_ = false;
     bool pin_state_ = false;
-    float pos_when_pressed_ = 0.0f;
+    bool latch_armed_ = false;
+    bool latch_subscribed_ = false; // if false, edges are only detected at the control loop rate
+    int32_t edge_count_ = 0; // encoder count (lower 32 bits) at the most recent press edge
+    std::optional<int32_t> latched_count_; // edge_count_ of the press that passed the debounce filter
     Timer<float> debounceTimer_;
 };
 #endif
\ No newline at end of file
@@ -50,6 +50,8 @@ void FieldOrientedController::reset() {
     vbus_voltage_measured_ = std::nullopt;
     Ialpha_beta_measured_ = std::nullopt;
     power_ = 0.0f;
+    final_v_d_ = 0.0f;
+    final_v_q_ = 0.0f;
 }
 
 Motor::Error FieldOrientedController::on_measurement(
@@ -169,6 +171,8 @@ ODriveIntf::MotorIntf::Error FieldOrientedController::get_alpha_beta_output(
     // Report final applied voltage in stationary frame (for sensorless estimator)
     final_v_alpha_ = mod_to_V * mod_alpha;
     final_v_beta_ = mod_to_V * mod_beta;
+    final_v_d_ = mod_to_V * mod_d;
+    final_v_q_ = mod_to_V * mod_q;
 
     *mod_alpha_beta = {mod_alpha, mod_beta};
 
@@ -0,0 +1,47 @@
+#include "freq_response.hpp"
+#include "raw_cursor.hpp"
+
+#include <board.h>
+
+/**
+ * @brief Starts a sweep with the current settings.
+ *
+ * Returns false if the settings are invalid (for instance a frequency above
+ * half the control loop frequency). The previous results are discarded.
+ */
+bool FreqResponse::start() {
+    bool result;
+    CRITICAL_SECTION() {
+        result = analyzer_.start(f_start_, f_end_, n_points_, amplitude_,
+                settle_cycles_, measure_cycles_, (float)current_meas_hz);
+        started_ = result;
+        read_offset_ = 0;
+    }
+    return result;
+}
+
+void FreqResponse::stop() {
+    analyzer_.stop();
+    started_ = false;
+}
+
+FreqResponse::FreqResponseState FreqResponse::get_state() {
+    if (analyzer_.running()) {
+        return FREQ_RESPONSE_STATE_RUNNING;
+    }
+    if (started_) {
+        return FREQ_RESPONSE_STATE_DONE;
+    }
+    return FREQ_RESPONSE_STATE_IDLE;
+}
+
+/**
+ * @brief Returns the next 8 bytes of the result table and advances
+ * read_offset_.
+ *
+ * Only the finished points are valid. The table can be read while the sweep
+ * is running because finished points are not modified anymore.
+ */
+uint64_t FreqResponse::read_raw() {
+    return raw_read(analyzer_.points(), analyzer_.n_done() * sizeof(FreqResponseAnalyzer::Point_t), &read_offset_);
+}
@@ -0,0 +1,46 @@
+#ifndef __FREQ_RESPONSE_HPP
+#define __FREQ_RESPONSE_HPP
+
+#include <autogen/interfaces.hpp>
+#include "freq_response_analyzer.hpp"
+
+/**
+ * @brief Measures the frequency response of an axis' control loop.
+ *
+ * The controller adds get_excitation() to the reference selected by
+ * excitation_point_ and feeds the torque command and the velocity estimate
+ * to update() at the end of every iteration. The resulting table of
+ * FreqResponseAnalyzer::Point_t entries is read out in one block through
+ * read_raw().
+ */
+class FreqResponse : public ODriveIntf::FreqResponseIntf {
+public:
+    bool start() override;
+    void stop() override;
+
+    float get_excitation(ExcitationPoint point) {
+        return excitation_point_ == point ? analyzer_.excitation() : 0.0f;
+    }
+    void update(float command, float response) {
+        analyzer_.update(command, response);
+    }
+
+    FreqResponseState get_state();
+    uint32_t get_n_done() { return analyzer_.n_done(); }
+    uint64_t read_raw();
+
+    ExcitationPoint excitation_point_ = EXCITATION_POINT_VELOCITY;
+    float amplitude_ = 0.5f;        // [turn, turn/s or Nm] depending on excitation_point_
+    float f_start_ = 2.0f;          // [Hz]
+    float f_end_ = 1000.0f;         // [Hz]
+    uint32_t n_points_ = 24;
+    uint32_t settle_cycles_ = 5;
+    uint32_t measure_cycles_ = 10;
+    uint32_t read_offset_ = 0;      // [bytes]
+
+private:
+    FreqResponseAnalyzer analyzer_;
+    bool started_ = false;
+};
+
+#endif // __FREQ_RESPONSE_HPP
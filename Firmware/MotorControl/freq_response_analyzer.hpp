@@ -0,0 +1,190 @@
+#ifndef __FREQ_RESPONSE_ANALYZER_HPP
+#define __FREQ_RESPONSE_ANALYZER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief Stepped-sine frequency response analyzer.
+ *
+ * The analyzer steps through log-spaced frequencies. At each frequency the
+ * caller adds excitation() to a reference and then calls update() with the
+ * command and the response of the plant in that sample. After settle_cycles
+ * periods, the command and the response are correlated with the excitation
+ * (I/Q accumulation) over measure_cycles periods, which yields the plant
+ * response (response / command) and the sensitivity of the loop
+ * (command / excitation) at that frequency.
+ *
+ * Each frequency is snapped such that the measurement window spans a whole
+ * number of periods in a whole number of samples, so DC offsets and harmonics
+ * do not leak into the result.
+ *
+ * The sine is generated by a rotating phasor, so the only trigonometric
+ * functions are evaluated once per frequency.
+ */
+class FreqResponseAnalyzer {
+public:
+    static constexpr size_t kMaxPoints = 32;
+
+    struct Point_t {
+        float frequency;         // [Hz]
+        float magnitude;         // |response / command|
+        float phase;             // [rad] phase of response / command
+        float command_magnitude; // |command / excitation|
+        float command_phase;     // [rad] phase of command / excitation
+    };
+
+    bool start(float f_start, float f_end, uint32_t n_points, float amplitude,
+               uint32_t settle_cycles, uint32_t measure_cycles, float sample_rate) {
+        float f_max = 0.5f * sample_rate;
+        if (n_points < 1 || n_points > kMaxPoints || measure_cycles < 1
+                || !(f_start > 0.0f) || !(f_start < f_max)
+                || !(f_end > 0.0f) || !(f_end < f_max)
+                || !(amplitude > 0.0f) || !(amplitude < INFINITY)) {
+            return false;
+        }
+
+        f_start_ = f_start;
+        f_end_ = f_end;
+        n_points_ = n_points;
+        amplitude_ = amplitude;
+        settle_cycles_ = settle_cycles;
+        measure_cycles_ = measure_cycles;
+        sample_rate_ = sample_rate;
+
+        sin_ = 0.0f;
+        cos_ = 1.0f;
+        n_done_ = 0;
+        start_point();
+        running_ = true;
+        return true;
+    }
+
+    void stop() { running_ = false; }
+    bool running() const { return running_; }
+
+    // Number of valid entries in points()
+    uint32_t n_done() const { return n_done_; }
+    const Point_t* points() const { return points_; }
+
+    // Value to add to the reference in the current sample
+    float excitation() const { return running_ ? amplitude_ * sin_ : 0.0f; }
+
+    // Must be called once per sample after excitation() was applied
+    void update(float command, float response) {
+        if (!running_) {
+            return;
+        }
+
+        if (sample_idx_ >= n_settle_) {
+            if (sample_idx_ == n_settle_) {
+                // Subtracting the first sample keeps the sums small in
+                // float precision. It does not change the result because
+                // the window spans whole periods.
+                command_ref_ = command;
+                response_ref_ = response;
+            }
+            float u = command - command_ref_;
+            float y = response - response_ref_;
+            u_sin_ += u * sin_;
+            u_cos_ += u * cos_;
+            y_sin_ += y * sin_;
+            y_cos_ += y * cos_;
+        }
+
+        if (++sample_idx_ == n_settle_ + n_measure_) {
+            finish_point();
+        }
+
+        // Advance the phasor and pull its length back to 1
+        float s = sin_ * step_cos_ + cos_ * step_sin_;
+        float c = cos_ * step_cos_ - sin_ * step_sin_;
+        float gain = 1.5f - 0.5f * (s * s + c * c);
+        sin_ = s * gain;
+        cos_ = c * gain;
+    }
+
+private:
+    void start_point() {
+        float f = f_start_;
+        if (n_points_ > 1) {
+            f *= powf(f_end_ / f_start_, (float)n_done_ / (float)(n_points_ - 1));
+        }
+
+        // At least 2 samples per period, so the snapped frequency stays below Nyquist
+        float samples = (float)measure_cycles_ * sample_rate_ / f;
+        n_measure_ = std::max((uint32_t)lroundf(samples), 2 * measure_cycles_ + 1);
+        frequency_ = (float)measure_cycles_ * sample_rate_ / (float)n_measure_;
+        n_settle_ = (uint32_t)lroundf((float)settle_cycles_ * sample_rate_ / frequency_);
+
+        // The phasor is not reset so that the excitation has no step
+        float omega = 2.0f * (float)M_PI * frequency_ / sample_rate_;
+        step_sin_ = sinf(omega);
+        step_cos_ = cosf(omega);
+
+        sample_idx_ = 0;
+        u_sin_ = u_cos_ = y_sin_ = y_cos_ = 0.0f;
+    }
+
+    void finish_point() {
+        // With e = A*sin(wt), the sums are N/2 * |X| * (cos(phi) + j*sin(phi))
+        // for a signal x = |X| * sin(wt + phi).
+        float u_mag = sqrtf(u_sin_ * u_sin_ + u_cos_ * u_cos_);
+        float y_mag = sqrtf(y_sin_ * y_sin_ + y_cos_ * y_cos_);
+        float u_phase = atan2f(u_cos_, u_sin_);
+        float y_phase = atan2f(y_cos_, y_sin_);
+        float phase = y_phase - u_phase;
+        if (phase > (float)M_PI) {
+            phase -= 2.0f * (float)M_PI;
+        } else if (phase < -(float)M_PI) {
+            phase += 2.0f * (float)M_PI;
+        }
+
+        Point_t& point = points_[n_done_];
+        point.frequency = frequency_;
+        point.magnitude = y_mag / u_mag;
+        point.phase = phase;
+        point.command_magnitude = u_mag / (0.5f * (float)n_measure_ * amplitude_);
+        point.command_phase = u_phase;
+
+        if (++n_done_ < n_points_) {
+            start_point();
+        } else {
+            running_ = false;
+        }
+    }
+
+    float f_start_ = 0.0f;
+    float f_end_ = 0.0f;
+    uint32_t n_points_ = 0;
+    float amplitude_ = 0.0f;
+    uint32_t settle_cycles_ = 0;
+    uint32_t measure_cycles_ = 0;
+    float sample_rate_ = 0.0f;
+
+    bool running_ = false;
+    uint32_t n_done_ = 0;
+
+    // Current frequency
+    float frequency_ = 0.0f; // [Hz]
+    uint32_t n_settle_ = 0;  // [samples]
+    uint32_t n_measure_ = 0; // [samples]
+    uint32_t sample_idx_ = 0;
+    float step_sin_ = 0.0f;
+    float step_cos_ = 1.0f;
+    float sin_ = 0.0f;
+    float cos_ = 1.0f;
+
+    float command_ref_ = 0.0f;
+    float response_ref_ = 0.0f;
+    float u_sin_ = 0.0f;
+    float u_cos_ = 0.0f;
+    float y_sin_ = 0.0f;
+    float y_cos_ = 0.0f;
+
+    Point_t points_[kMaxPoints] = {};
+};
+
+#endif // __FREQ_RESPONSE_ANALYZER_HPP
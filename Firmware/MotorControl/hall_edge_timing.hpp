@@ -0,0 +1,170 @@
+#ifndef __HALL_EDGE_TIMING_HPP
+#define __HALL_EDGE_TIMING_HPP
+
+#include <stdint.h>
+#include <math.h>
+#include <array>
+#include <algorithm>
+
+// Decodes the hall state (after the polarity correction) to the count within
+// the electrical revolution
+inline bool decode_hall(uint8_t hall_state, int32_t* hall_cnt) {
+    switch (hall_state) {
+        case 0b001: *hall_cnt = 0; return true;
+        case 0b011: *hall_cnt = 1; return true;
+        case 0b010: *hall_cnt = 2; return true;
+        case 0b110: *hall_cnt = 3; return true;
+        case 0b100: *hall_cnt = 4; return true;
+        case 0b101: *hall_cnt = 5; return true;
+        default: return false;
+    }
+}
+
+/**
+ * @brief Electrical position and velocity of hall sensors from the time of
+ * their edges.
+ *
+ * Hall sensors only have 6 states per electrical revolution. Every edge is
+ * timestamped, so the velocity is the distance between the last two edges over
+ * the time between them, and the position is the position of the last edge
+ * plus the time since that edge times the velocity. The position never leaves
+ * the current hall state.
+ *
+ * The edge positions come from the hall phase calibration: edges[i] is the
+ * position where the count changes from i-1 to i, in counts (6 per electrical
+ * revolution). A transition from i to i+1 and back happens at the same edge,
+ * so a reversal reads as zero velocity.
+ *
+ * As with EdgeTiming, the velocity is blended with the PLL between
+ * kMinEdgePeriods and kMaxEdgePeriods control periods per edge.
+ */
+class HallEdgeTiming {
+public:
+    static constexpr float kMinEdgePeriods = 1.0f;
+    static constexpr float kMaxEdgePeriods = 4.0f;
+
+    // Must not race with on_edge(), i.e. call it while the interrupt is disabled
+    void reset() {
+        n_states_ = 0;
+    }
+
+    // state: raw state of the three sensors after the edge
+    void on_edge(uint8_t state, uint32_t timestamp) {
+        if (n_states_ > 0 && state == states_[2]) {
+            return; // a glitch that was over before the interrupt ran
+        }
+        states_[0] = states_[1];
+        states_[1] = states_[2];
+        states_[2] = state;
+        prev_timestamp_ = last_timestamp_;
+        last_timestamp_ = timestamp;
+        if (n_states_ < 3) {
+            n_states_++;
+        }
+    }
+
+    void sample(uint32_t timestamp) {
+        sampled_ = {{states_[0], states_[1], states_[2]}, prev_timestamp_, last_timestamp_, n_states_};
+        sample_timestamp_ = timestamp;
+    }
+
+    // Time from the last edge to sample(), if that edge led to the raw state
+    bool time_since_edge(uint8_t state, float clock_hz, float* time) const {
+        if (sampled_.n_states < 1 || sampled_.states[2] != state) {
+            return false;
+        }
+        *time = (float)(uint32_t)(sample_timestamp_ - sampled_.last_timestamp) / clock_hz;
+        return true;
+    }
+
+    /**
+     * @brief Computes the estimates for the last sample().
+     *
+     * @param polarity: Hall polarity correction.
+     * @param edges: Calibrated edge positions [count].
+     * @param hall_cnt: Decoded hall count at the time of sample().
+     * @param pll_vel: Velocity of the PLL [count/s].
+     * @param clock_hz: Frequency of the timestamps.
+     * @param period: Control period [s].
+     * @param vel: Set to the blended velocity [count/s].
+     * @param interpolation: Set to the position relative to hall_cnt [count].
+     *        This is within the calibrated edges of the state, so it can be
+     *        slightly outside of [0, 1].
+     * @returns false if the last two edges are unknown or don't lead to
+     *        hall_cnt, in which case vel and interpolation are not set.
+     */
+    bool update(uint8_t polarity, const std::array<float, 6>& edges, int32_t hall_cnt, float pll_vel,
+                float clock_hz, float period, float* vel, float* interpolation) const {
+        if (sampled_.n_states < 3) {
+            return false;
+        }
+        int32_t cnt[3];
+        for (size_t i = 0; i < 3; ++i) {
+            if (!decode_hall(sampled_.states[i] ^ polarity, &cnt[i])) {
+                return false;
+            }
+        }
+        // An edge since sample() that the interrupt has not recorded yet
+        if (cnt[2] != hall_cnt) {
+            return false;
+        }
+        float prev_edge, last_edge;
+        if (!edge_position(edges, cnt[0], cnt[1], &prev_edge)
+                || !edge_position(edges, cnt[1], cnt[2], &last_edge)) {
+            return false;
+        }
+        float interval = (float)(uint32_t)(sampled_.last_timestamp - sampled_.prev_timestamp) / clock_hz;
+        float since_edge = (float)(uint32_t)(sample_timestamp_ - sampled_.last_timestamp) / clock_hz;
+        if (!(interval > 0.0f)) {
+            return false;
+        }
+
+        // Without a new edge the speed is at most the width of the current
+        // state since the last edge
+        float lower = wrap(edges[hall_cnt] - (float)hall_cnt);
+        float upper = wrap(edges[(hall_cnt + 1) % 6] - (float)hall_cnt);
+        float edge_vel = wrap(last_edge - prev_edge) / interval;
+        if (std::abs(edge_vel) * since_edge > upper - lower) {
+            edge_vel = copysignf((upper - lower) / since_edge, edge_vel);
+        }
+        float weight = std::clamp((interval / period - kMinEdgePeriods) / (kMaxEdgePeriods - kMinEdgePeriods), 0.0f, 1.0f);
+        *vel = pll_vel + weight * (edge_vel - pll_vel);
+        *interpolation = std::clamp(wrap(last_edge - (float)hall_cnt) + edge_vel * since_edge, lower, upper);
+        return true;
+    }
+
+private:
+    // Wraps a distance in counts to [-3, 3)
+    static float wrap(float x) {
+        return x - 6.0f * floorf((x + 3.0f) / 6.0f);
+    }
+
+    static bool edge_position(const std::array<float, 6>& edges, int32_t from, int32_t to, float* pos) {
+        int32_t delta = ((to - from) % 6 + 6) % 6;
+        if (delta == 1) {
+            *pos = edges[to];
+        } else if (delta == 5) {
+            *pos = edges[from];
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    struct Edges_t {
+        uint8_t states[3]; // oldest first
+        uint32_t prev_timestamp;
+        uint32_t last_timestamp;
+        uint32_t n_states;
+    };
+
+    volatile uint8_t states_[3] = {};
+    volatile uint32_t prev_timestamp_ = 0; // [clocks] edge to states_[1]
+    volatile uint32_t last_timestamp_ = 0; // [clocks] edge to states_[2]
+    volatile uint32_t n_states_ = 0;
+
+    Edges_t sampled_ = {};
+    uint32_t sample_timestamp_ = 0; // [clocks]
+};
+
+#endif // __HALL_EDGE_TIMING_HPP
@@ -0,0 +1,135 @@
+#ifndef __INERTIA_ESTIMATOR_HPP
+#define __INERTIA_ESTIMATOR_HPP
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief Recursive least squares estimate of the inertia and the load torque
+ * of an axis while it moves.
+ *
+ * The model is T = J * dv/dt + T_load. Like MechanicalIdentifier, it is
+ * integrated over a window of kDecimation samples, so each update uses the
+ * mean torque and the velocity change over the window instead of a noisy
+ * acceleration:
+ *   mean(T) = J * (v_end - v_start) / window + T_load
+ * Old windows are forgotten exponentially with the configured time constant.
+ *
+ * With little acceleration, the velocity noise dominates the regressor and
+ * biases the inertia low, so such windows are skipped. The covariance is also
+ * limited to its initial value so that it cannot grow without bound while
+ * the data says little about one of the parameters.
+ *
+ * scale() is the estimated inertia relative to a nominal inertia, bounded and
+ * rate limited, for scaling gains that were tuned for the nominal inertia.
+ */
+class InertiaEstimator {
+public:
+    static constexpr uint32_t kDecimation = 32;
+    static constexpr float kInitialCovariance = 1e3f;
+
+    void reset(float inertia) {
+        inertia_ = inertia;
+        load_torque_ = 0.0f;
+        p00_ = kInitialCovariance;
+        p01_ = 0.0f;
+        p11_ = kInitialCovariance;
+        window_idx_ = 0;
+        has_prev_vel_ = false;
+        scale_ = 1.0f;
+    }
+
+    /**
+     * @brief Records a sample. Returns true if the estimate was updated.
+     *
+     * @param torque: Torque that was commanded since the previous call.
+     * @param vel: Velocity at the time of this call.
+     * @param period: Time since the previous call.
+     * @param time_constant: Time constant of the exponential forgetting.
+     * @param min_acceleration: Windows with less mean acceleration are
+     *        skipped.
+     */
+    bool update(float torque, float vel, float period, float time_constant, float min_acceleration) {
+        if (!has_prev_vel_) {
+            prev_vel_ = vel;
+            has_prev_vel_ = true;
+            return false;
+        }
+        if (window_idx_ == 0) {
+            window_start_vel_ = prev_vel_;
+            window_torque_ = 0.0f;
+        }
+        window_torque_ += torque;
+        prev_vel_ = vel;
+
+        if (++window_idx_ < kDecimation) {
+            return false;
+        }
+        window_idx_ = 0;
+
+        float window = (float)kDecimation * period;
+        float x0 = (vel - window_start_vel_) / window; // mean acceleration
+        float y = window_torque_ / (float)kDecimation; // mean torque
+        if (!(std::abs(x0) >= min_acceleration)) {
+            return false;
+        }
+        float lambda = std::clamp(1.0f - window / time_constant, 0.5f, 1.0f);
+
+        // RLS update with regressor (x0, 1) and parameters (J, T_load)
+        float px0 = p00_ * x0 + p01_;
+        float px1 = p01_ * x0 + p11_;
+        float denom = lambda + x0 * px0 + px1;
+        float k0 = px0 / denom;
+        float k1 = px1 / denom;
+        float err = y - (inertia_ * x0 + load_torque_);
+        inertia_ += k0 * err;
+        load_torque_ += k1 * err;
+
+        p00_ = std::min((p00_ - k0 * px0) / lambda, kInitialCovariance);
+        p01_ = (p01_ - k0 * px1) / lambda;
+        p11_ = std::min((p11_ - k1 * px1) / lambda, kInitialCovariance);
+        // Keep the covariance positive definite after the limiting
+        float max_p01 = sqrtf(p00_ * p11_);
+        p01_ = std::clamp(p01_, -max_p01, max_p01);
+        return true;
+    }
+
+    /**
+     * @brief Moves scale() towards inertia() / nominal_inertia.
+     *
+     * @param range: scale() stays within [1 / range, range].
+     * @param rate: Maximum relative change of scale() per second.
+     * @param period: Time since the previous call.
+     */
+    void update_scale(float nominal_inertia, float range, float rate, float period) {
+        if (!(nominal_inertia > 0.0f) || !(range >= 1.0f)) {
+            scale_ = 1.0f;
+            return;
+        }
+        float target = std::clamp(inertia_ / nominal_inertia, 1.0f / range, range);
+        float max_step = rate * period * scale_;
+        scale_ += std::clamp(target - scale_, -max_step, max_step);
+    }
+
+    float inertia() const { return inertia_; }         // [Nm/(turn/s^2)]
+    float load_torque() const { return load_torque_; } // [Nm]
+    float scale() const { return scale_; }
+
+private:
+    float inertia_ = 0.0f;
+    float load_torque_ = 0.0f;
+    float p00_ = kInitialCovariance; // covariance of the estimate
+    float p01_ = 0.0f;
+    float p11_ = kInitialCovariance;
+
+    uint32_t window_idx_ = 0;
+    float window_start_vel_ = 0.0f;
+    float window_torque_ = 0.0f;
+    float prev_vel_ = 0.0f;
+    bool has_prev_vel_ = false;
+
+    float scale_ = 1.0f;
+};
+
+#endif // __INERTIA_ESTIMATOR_HPP
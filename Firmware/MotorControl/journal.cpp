@@ -0,0 +1,24 @@
+
+#include "journal.hpp"
+
+#include <board.h>
+
+void Journal::log(JournalEntryType type, uint8_t axis, uint64_t error, uint8_t state) {
+    Entry entry = {};
+    entry.timestamp = DWT->CYCCNT;
+    entry.type = type;
+    entry.error = error;
+    entry.uptime = HAL_GetTick();
+    entry.axis = axis;
+    entry.state = state;
+    ring_.push(entry);
+}
+
+/**
+ * @brief Returns the next 8 bytes of the entry read_idx_ and increments
+ * read_idx_ after the last part. Entries that are not available read as
+ * JOURNAL_ENTRY_TYPE_NONE, see RawRingReader.
+ */
+uint64_t Journal::read_raw() {
+    return reader_.read(ring_, &read_idx_);
+}
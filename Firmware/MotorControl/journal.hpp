@@ -0,0 +1,49 @@
+#ifndef __JOURNAL_HPP
+#define __JOURNAL_HPP
+
+#include <autogen/interfaces.hpp>
+#include "trace_ring.hpp"
+#include "raw_cursor.hpp"
+
+// Number of journal entries (24 bytes each). Must be a power of two.
+#define JOURNAL_SIZE 128
+
+// Value of Entry::axis for entries that don't belong to an axis
+#define JOURNAL_NO_AXIS 0xff
+
+/**
+ * @brief Records when errors are set and when axes change their state.
+ *
+ * Unlike the sticky error fields, the journal keeps the order and time of
+ * these events and is not reset by clear_errors(). Entries are appended
+ * lock-free so log() can be called from any thread or interrupt.
+ */
+class Journal : public ODriveIntf::JournalIntf {
+public:
+    struct Entry {
+        uint32_t timestamp; // [clocks]
+        uint16_t type;      // JournalEntryType, 0 means invalid
+        uint16_t seq;       // lower 16 bits of the sequence number
+        uint64_t error;     // newly set error bits or, for state changes, the axis error
+        uint32_t uptime;    // [ms]
+        uint8_t axis;       // JOURNAL_NO_AXIS for system level entries
+        uint8_t state;      // AxisState of the axis at the time of the entry
+        uint16_t reserved;
+    };
+    static_assert(sizeof(Entry) == 24, "unexpected padding");
+
+    void log(JournalEntryType type, uint8_t axis, uint64_t error, uint8_t state);
+
+    uint32_t get_write_idx() { return ring_.write_idx(); }
+    uint64_t read_raw();
+
+    uint32_t read_idx_ = 0; // sequence number of the entry returned by the next read_raw()
+    const uint32_t size_ = JOURNAL_SIZE;
+
+private:
+    using Ring = TraceRing<JOURNAL_SIZE, Entry>;
+    Ring ring_;
+    RawRingReader<Ring> reader_;
+};
+
+#endif // __JOURNAL_HPP
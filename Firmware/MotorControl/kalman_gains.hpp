@@ -0,0 +1,87 @@
+#ifndef __KALMAN_GAINS_HPP
+#define __KALMAN_GAINS_HPP
+
+#include <math.h>
+
+/**
+ * @brief Computes the steady state gains of a Kalman filter that tracks
+ * position, velocity and acceleration from position measurements.
+ *
+ * The model is a constant acceleration driven by white jerk with the power
+ * spectral density process_noise [count^2/s^5]. The measurements have the
+ * standard deviation measurement_noise [count], for instance 1/sqrt(12) for
+ * the quantization of an incremental encoder.
+ *
+ * Each sample the filter predicts
+ *   pos += period * vel + 0.5 * period^2 * acc,  vel += period * acc
+ * and then corrects the states by period * gain * (measured - predicted pos).
+ * The gains are returned per second like the PLL gains, so the PLL is the
+ * special case acc_gain = 0.
+ *
+ * The Riccati equation is iterated in double precision because the entries of
+ * the process noise span many orders of magnitude. This takes a few thousand
+ * iterations, so it is meant to run when the configuration changes, not in
+ * the control loop.
+ *
+ * Returns false if the parameters are invalid or the iteration did not
+ * converge.
+ */
+inline bool compute_kalman_gains(float process_noise, float measurement_noise, float period,
+        float* pos_gain, float* vel_gain, float* acc_gain) {
+    if (!(process_noise > 0.0f) || !(measurement_noise > 0.0f) || !(period > 0.0f)) {
+        return false;
+    }
+    const double q = process_noise;
+    const double r = (double)measurement_noise * (double)measurement_noise;
+    const double dt = period;
+    const double dt2 = dt * dt, dt3 = dt2 * dt, dt4 = dt3 * dt, dt5 = dt4 * dt;
+
+    // Process noise covariance of white jerk integrated over one period
+    const double q00 = q * dt5 / 20.0, q01 = q * dt4 / 8.0, q02 = q * dt3 / 6.0;
+    const double q11 = q * dt3 / 3.0, q12 = q * dt2 / 2.0, q22 = q * dt;
+
+    // Covariance after the correction (symmetric)
+    double p00 = r, p01 = 0.0, p02 = 0.0, p11 = r / dt2, p12 = 0.0, p22 = r / dt4;
+    double k0 = 0.0, k1 = 0.0, k2 = 0.0;
+
+    for (int i = 0; i < 100000; ++i) {
+        // Prediction: F * P * F^T + Q with F = [1 dt dt^2/2; 0 1 dt; 0 0 1]
+        double f00 = p00 + dt * p01 + 0.5 * dt2 * p02;
+        double f01 = p01 + dt * p11 + 0.5 * dt2 * p12;
+        double f02 = p02 + dt * p12 + 0.5 * dt2 * p22;
+        double f11 = p11 + dt * p12;
+        double f12 = p12 + dt * p22;
+        double m00 = f00 + dt * f01 + 0.5 * dt2 * f02 + q00;
+        double m01 = f01 + dt * f02 + q01;
+        double m02 = f02 + q02;
+        double m11 = f11 + dt * f12 + q11;
+        double m12 = f12 + q12;
+        double m22 = p22 + q22;
+
+        // Correction with H = [1 0 0]
+        double s = m00 + r;
+        double n0 = m00 / s, n1 = m01 / s, n2 = m02 / s;
+        p00 = m00 - n0 * m00;
+        p01 = m01 - n0 * m01;
+        p02 = m02 - n0 * m02;
+        p11 = m11 - n1 * m01;
+        p12 = m12 - n1 * m02;
+        p22 = m22 - n2 * m02;
+
+        bool converged = fabs(n0 - k0) <= 1e-9 * n0
+                && fabs(n1 - k1) <= 1e-9 * fabs(n1)
+                && fabs(n2 - k2) <= 1e-9 * fabs(n2);
+        k0 = n0;
+        k1 = n1;
+        k2 = n2;
+        if (converged) {
+            *pos_gain = (float)(k0 / dt);
+            *vel_gain = (float)(k1 / dt);
+            *acc_gain = (float)(k2 / dt);
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // __KALMAN_GAINS_HPP
@@ -0,0 +1,52 @@
+#ifndef __LOAD_METER_HPP
+#define __LOAD_METER_HPP
+
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+
+/**
+ * @brief Measures the load of a periodic task over a window of periods.
+ *
+ * push() is called once per period with the time the task was busy during
+ * that period. Once the accumulated periods reach the window length, the
+ * load and the smallest headroom of that window are published and the next
+ * window starts.
+ *
+ * All times are in clocks. The window must be shorter than 2^32 clocks.
+ */
+class LoadMeter {
+public:
+    void reset() {
+        min_headroom_ = std::numeric_limits<int32_t>::max();
+    }
+
+    void push(uint32_t busy, uint32_t period, uint32_t window) {
+        int32_t headroom = (int32_t)period - (int32_t)busy;
+        window_busy_ += busy;
+        window_length_ += period;
+        window_min_headroom_ = std::min(window_min_headroom_, headroom);
+        min_headroom_ = std::min(min_headroom_, headroom);
+
+        if (window_length_ >= window) {
+            load_ = (float)window_busy_ / (float)window_length_;
+            last_window_min_headroom_ = window_min_headroom_;
+            window_busy_ = 0;
+            window_length_ = 0;
+            window_min_headroom_ = std::numeric_limits<int32_t>::max();
+            window_count_++;
+        }
+    }
+
+    float load_ = 0.0f; // fraction of the last window during which the task was busy
+    int32_t last_window_min_headroom_ = 0; // [clocks] smallest headroom within the last window
+    int32_t min_headroom_ = std::numeric_limits<int32_t>::max(); // [clocks] smallest headroom since the last reset
+    uint32_t window_count_ = 0;
+
+private:
+    uint32_t window_busy_ = 0;
+    uint32_t window_length_ = 0;
+    int32_t window_min_headroom_ = std::numeric_limits<int32_t>::max();
+};
+
+#endif // __LOAD_METER_HPP
@@ -0,0 +1,91 @@
+#ifndef __LOG_HISTOGRAM_HPP
+#define __LOG_HISTOGRAM_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <iterator>
+
+/**
+ * @brief Histogram with logarithmically spaced buckets.
+ *
+ * Each power of two is split into 2^kSubBucketBits buckets, so the relative
+ * bucket width is at most 1/2^kSubBucketBits over the whole range. Values
+ * below 2^kMinLog2 share the first bucket and values of 2^kMaxLog2 and above
+ * share the last bucket.
+ *
+ * push() only takes a count-leading-zeros, a few shifts and an increment so
+ * that it can run on every control loop iteration.
+ */
+template<uint32_t kMinLog2, uint32_t kMaxLog2, uint32_t kSubBucketBits = 2>
+class LogHistogram {
+   public:
+    static_assert(kMinLog2 >= kSubBucketBits, "the first octave must be divisible into sub-buckets");
+    static_assert(kMaxLog2 > kMinLog2 && kMaxLog2 < 32, "invalid range");
+
+    static constexpr size_t kNumBuckets = ((kMaxLog2 - kMinLog2) << kSubBucketBits) + 2;
+
+    static size_t bucket_of(uint32_t val) {
+        uint32_t msb = 31 - __builtin_clz(val | 1);
+        if (msb < kMinLog2) {
+            return 0;
+        } else if (msb >= kMaxLog2) {
+            return kNumBuckets - 1;
+        }
+        uint32_t sub = (val >> (msb - kSubBucketBits)) & ((1 << kSubBucketBits) - 1);
+        return (((msb - kMinLog2) << kSubBucketBits) | sub) + 1;
+    }
+
+    // Smallest value that falls into the specified bucket
+    static uint32_t lower_bound(size_t bucket) {
+        if (bucket == 0) {
+            return 0;
+        }
+        uint32_t msb = ((bucket - 1) >> kSubBucketBits) + kMinLog2;
+        uint32_t sub = (bucket - 1) & ((1 << kSubBucketBits) - 1);
+        return (1UL << msb) + (sub << (msb - kSubBucketBits));
+    }
+
+    void reset() {
+        std::fill(std::begin(buckets_), std::end(buckets_), 0);
+    }
+
+    void push(uint32_t val) {
+        buckets_[bucket_of(val)]++;
+    }
+
+    uint32_t count() const {
+        uint32_t n = 0;
+        for (uint32_t bucket : buckets_) {
+            n += bucket;
+        }
+        return n;
+    }
+
+    /**
+     * @brief Returns the upper bound of the bucket that contains the q-quantile
+     * (0 < q <= 1), i.e. at least a fraction q of all values are below the
+     * returned value.
+     * For values in the last bucket, max_val is returned since the bucket has
+     * no upper bound. Returns 0 if the histogram is empty.
+     */
+    uint32_t quantile(float q, uint32_t max_val) const {
+        uint32_t n = count();
+        if (!n) {
+            return 0;
+        }
+        uint32_t target = std::max((uint32_t)1, (uint32_t)(q * (float)n + 0.999f));
+        uint32_t cumulative = 0;
+        for (size_t i = 0; i < kNumBuckets - 1; ++i) {
+            cumulative += buckets_[i];
+            if (cumulative >= target) {
+                return std::min(lower_bound(i + 1), max_val);
+            }
+        }
+        return max_val;
+    }
+
+    uint32_t buckets_[kNumBuckets] = {0};
+};
+
+#endif // __LOG_HISTOGRAM_HPP
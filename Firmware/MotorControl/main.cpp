@@ -11,9 +11,13 @@
 #include <communication/interface_i2c.h>
 #include <communication/interface_can.hpp>
 
+#include <string.h>
+
 osSemaphoreId sem_usb_irq;
 osMessageQId uart_event_queue;
 osMessageQId usb_event_queue;
+const uint32_t uart_event_queue_length = 4;
+const uint32_t usb_event_queue_length = 7;
 osSemaphoreId sem_can;
 
 #if defined(STM32F405xx)
@@ -24,6 +28,9 @@ uint8_t ucHeap[configTOTAL_HEAP_SIZE];
 
 uint32_t _reboot_cookie __attribute__ ((section (".noinit")));
 extern char _estack; // provided by the linker script
+extern char _heap_end_max; // provided by the linker script, bottom of the main stack
+
+static constexpr uint32_t kStackPaint = 0xa5a5a5a5; // same as FreeRTOS uses for thread stacks
 
 
 ODrive odrv{};
@@ -243,6 +250,7 @@ void ODrive::clear_errors() {
         axis.error_ = Axis::ERROR_NONE;
     }
     error_ = ERROR_NONE;
+    journal_.log(Journal::JOURNAL_ENTRY_TYPE_ERRORS_CLEARED, JOURNAL_NO_AXIS, 0, 0);
     if (odrv.config_.enable_brake_resistor) {
         safety_critical_arm_brake_resistor();
     }
@@ -258,30 +266,134 @@ void vApplicationStackOverflowHook(xTaskHandle *pxTask, signed portCHAR *pcTaskN
     for (;;); // TODO: safe action
 }
 
+// Enumerates all threads once per config.cpu_load_window and updates their
+// free stack space, priority and CPU load in system_stats.threads. This scans
+// the unused part of every thread stack, so it's not done more often. The run
+// time counter of the calling (idle) thread lags behind by its current time
+// slice but that evens out over consecutive windows.
+static void update_thread_stats() {
+    static bool started = false;
+    static uint32_t window_start;
+    static TaskStatus_t status[MAX_THREAD_STATS];
+    static ThreadStats_t threads[MAX_THREAD_STATS];
+
+    uint32_t now = DWT->CYCCNT;
+    uint32_t window = std::min(odrv.config_.cpu_load_window, (uint32_t)25000) * (SystemCoreClock / 1000);
+    if (started && (now - window_start < window)) {
+        return;
+    }
+
+    SystemStats_t& stats = odrv.system_stats_;
+    float inv_window = 1.0f / (float)(now - window_start);
+    window_start = now;
+
+    // Returns 0 if there are more than MAX_THREAD_STATS threads
+    size_t n_threads = uxTaskGetSystemState(status, MAX_THREAD_STATS, nullptr);
+
+    for (size_t i = 0; i < n_threads; ++i) {
+        // The first window only takes the initial run times, as does the
+        // first window of a new thread
+        const ThreadStats_t* prev = std::find_if(stats.threads, stats.threads + stats.n_threads,
+                [&](const ThreadStats_t& thread) { return thread.number == status[i].xTaskNumber; });
+        bool has_prev = started && (prev != stats.threads + stats.n_threads);
+
+        ThreadStats_t& thread = threads[i];
+        thread.number = status[i].xTaskNumber;
+        memset(thread.name, 0, sizeof(thread.name));
+        strncpy(thread.name, status[i].pcTaskName, sizeof(thread.name) - 1);
+        thread.min_stack_space = status[i].usStackHighWaterMark * sizeof(StackType_t);
+        thread.prio = osThreadGetPriority(status[i].xHandle);
+        thread.run_time = status[i].ulRunTimeCounter;
+        thread.cpu_load = has_prev ? (float)(thread.run_time - prev->run_time) * inv_window : 0.0f;
+    }
+
+    CRITICAL_SECTION() {
+        std::copy(threads, threads + n_threads, stats.threads);
+        stats.n_threads = n_threads;
+    }
+    started = true;
+
+    // The stats of the well known threads by their role. The stack sizes of
+    // the threads are not known to FreeRTOS, hence the usage is only reported
+    // for these. The axis threads share one set of stats.
+    stats.cpu_load_axis = 0.0f;
+    for (size_t i = 0; i < n_threads; ++i) {
+        osThreadId handle = status[i].xHandle;
+        const ThreadStats_t& thread = threads[i];
+        auto update = [&](uint32_t stack_size, uint32_t* max_stack_usage, int32_t* prio, float* cpu_load) {
+            *max_stack_usage = std::max(*max_stack_usage, stack_size - thread.min_stack_space);
+            *prio = thread.prio;
+            *cpu_load += thread.cpu_load;
+        };
+        if (handle == usb_thread) {
+            stats.cpu_load_usb = 0.0f;
+            update(stack_size_usb_thread, &stats.max_stack_usage_usb, &stats.prio_usb, &stats.cpu_load_usb);
+        } else if (handle == uart_thread) {
+            stats.cpu_load_uart = 0.0f;
+            update(stack_size_uart_thread, &stats.max_stack_usage_uart, &stats.prio_uart, &stats.cpu_load_uart);
+        } else if (handle == odrv.can_.thread_id_) {
+            stats.cpu_load_can = 0.0f;
+            update(odrv.can_.stack_size_, &stats.max_stack_usage_can, &stats.prio_can, &stats.cpu_load_can);
+        } else if (handle == xTaskGetIdleTaskHandle()) {
+            stats.cpu_load_idle = thread.cpu_load;
+        } else {
+            for (auto& axis: axes) {
+                if (handle == axis.thread_id_) {
+                    update(axis.stack_size_, &stats.max_stack_usage_axis, &stats.prio_axis, &stats.cpu_load_axis);
+                }
+            }
+        }
+    }
+}
+
+// Fills the whole main stack with kStackPaint. Must be called from a thread:
+// starting the scheduler resets the MSP to _estack, so the frame of main() is
+// gone and the main stack is only used by interrupts. An interrupt's frame is
+// dead again by the time the interrupted thread resumes, so the thread can
+// overwrite everything.
+static void paint_isr_stack() {
+    uint32_t* ptr = reinterpret_cast<uint32_t*>(&_heap_end_max);
+    uint32_t* end = reinterpret_cast<uint32_t*>(&_estack);
+    while (ptr < end) {
+        *ptr++ = kStackPaint;
+    }
+}
+
+static uint32_t get_isr_stack_usage() {
+    const uint32_t* ptr = reinterpret_cast<const uint32_t*>(&_heap_end_max);
+    const uint32_t* end = reinterpret_cast<const uint32_t*>(&_estack);
+    while (ptr < end && *ptr == kStackPaint) {
+        ptr++;
+    }
+    return (end - ptr) * sizeof(uint32_t);
+}
+
+// Updates the interrupt stack usage and the other high-water marks at most
+// every 10ms. The interrupt stack scan time grows with its unused part.
+static void update_memory_stats() {
+    static uint32_t last_update = 0;
+
+    uint32_t now = HAL_GetTick();
+    if (now - last_update < 10) {
+        return;
+    }
+    last_update = now;
+
+    SystemStats_t& stats = odrv.system_stats_;
+    stats.max_stack_usage_isr = get_isr_stack_usage();
+    stats.min_heap_space = xPortGetMinimumEverFreeHeapSize();
+    stats.max_spi_queue_length = ext_spi_arbiter.max_queue_length_;
+    stats.max_can_tx_mailbox_usage = odrv.can_.max_tx_mailbox_usage_;
+    stats.max_can_rx_fifo_usage = odrv.can_.max_rx_fifo_usage_;
+}
+
 void vApplicationIdleHook(void) {
     if (odrv.system_stats_.fully_booted) {
         odrv.system_stats_.uptime = xTaskGetTickCount();
-        odrv.system_stats_.min_heap_space = xPortGetMinimumEverFreeHeapSize();
-
-        uint32_t min_stack_space[AXIS_COUNT];
-        std::transform(axes.begin(), axes.end(), std::begin(min_stack_space), [](auto& axis) { return uxTaskGetStackHighWaterMark(axis.thread_id_) * sizeof(StackType_t); });
-        odrv.system_stats_.max_stack_usage_axis = axes[0].stack_size_ - *std::min_element(std::begin(min_stack_space), std::end(min_stack_space));
-        odrv.system_stats_.max_stack_usage_usb = stack_size_usb_thread - uxTaskGetStackHighWaterMark(usb_thread) * sizeof(StackType_t);
-        odrv.system_stats_.max_stack_usage_uart = stack_size_uart_thread - uxTaskGetStackHighWaterMark(uart_thread) * sizeof(StackType_t);
-        odrv.system_stats_.max_stack_usage_startup = stack_size_default_task - uxTaskGetStackHighWaterMark(defaultTaskHandle) * sizeof(StackType_t);
-        odrv.system_stats_.max_stack_usage_can = odrv.can_.stack_size_ - uxTaskGetStackHighWaterMark(odrv.can_.thread_id_) * sizeof(StackType_t);
-
-        odrv.system_stats_.stack_size_axis = axes[0].stack_size_;
-        odrv.system_stats_.stack_size_usb = stack_size_usb_thread;
-        odrv.system_stats_.stack_size_uart = stack_size_uart_thread;
-        odrv.system_stats_.stack_size_startup = stack_size_default_task;
-        odrv.system_stats_.stack_size_can = odrv.can_.stack_size_;
-
-        odrv.system_stats_.prio_axis = osThreadGetPriority(axes[0].thread_id_);
-        odrv.system_stats_.prio_usb = osThreadGetPriority(usb_thread);
-        odrv.system_stats_.prio_uart = osThreadGetPriority(uart_thread);
-        odrv.system_stats_.prio_startup = osThreadGetPriority(defaultTaskHandle);
-        odrv.system_stats_.prio_can = osThreadGetPriority(odrv.can_.thread_id_);
+
+        update_memory_stats();
+        update_thread_stats();
+        odrv.black_box_.service();
 
         status_led_controller.update();
     }
@@ -313,6 +425,9 @@ void ODrive::disarm_with_error(Error error) {
             axis.motor_.disarm_with_error(Motor::ERROR_SYSTEM_LEVEL);
         }
         safety_critical_disarm_brake_resistor();
+        if (error & ~error_) {
+            journal_.log(Journal::JOURNAL_ENTRY_TYPE_SYSTEM_ERROR, JOURNAL_NO_AXIS, error, 0);
+        }
         error_ |= error;
     }
 }
@@ -336,13 +451,20 @@ void ODrive::disarm_with_error(Error error) {
  * control_loop_cb() instead.
  */
 void ODrive::sampling_cb() {
+    TRACE(SAMPLING_BEGIN);
     n_evt_sampling_++;
 
     MEASURE_TIME(task_times_.sampling) {
+        // SPI encoder reads go first so that they can complete before the
+        // control loop of this period uses them
+        for (auto& axis: axes) {
+            axis.encoder_.abs_spi_start_transaction();
+        }
         for (auto& axis: axes) {
             axis.encoder_.sample_now();
         }
     }
+    TRACE(SAMPLING_END);
 }
 
 /**
@@ -359,6 +481,7 @@ void ODrive::sampling_cb() {
  *        must not rely on any interrupts.
  */
 void ODrive::control_loop_cb(uint32_t timestamp) {
+    TRACE(CONTROL_LOOP_BEGIN, timestamp);
     last_update_timestamp_ = timestamp;
     n_evt_control_loop_++;
 
@@ -376,10 +499,13 @@ void ODrive::control_loop_cb(uint32_t timestamp) {
             axis.acim_estimator_.stator_phase_vel_.reset();
             axis.acim_estimator_.stator_phase_.reset();
             axis.controller_.torque_output_.reset();
+            axis.autotune_torque_.reset();
             axis.encoder_.phase_.reset();
             axis.encoder_.phase_vel_.reset();
             axis.encoder_.pos_estimate_.reset();
+            axis.encoder_.pos_estimate_turns_.reset();
             axis.encoder_.vel_estimate_.reset();
+            axis.encoder_.acc_estimate_.reset();
             axis.encoder_.pos_circular_.reset();
             axis.motor_.Vdq_setpoint_.reset();
             axis.motor_.Idq_setpoint_.reset();
@@ -395,6 +521,7 @@ void ODrive::control_loop_cb(uint32_t timestamp) {
 
         uart_poll();
         odrv.oscilloscope_.update();
+        odrv.snapshot_.update(timestamp);
     }
 
     MEASURE_TIME(task_times_.control_loop_checks) {
@@ -437,6 +564,8 @@ void ODrive::control_loop_cb(uint32_t timestamp) {
         MEASURE_TIME(axis.task_times_.controller_update)
             axis.controller_.update(); // uses position and velocity from encoder
 
+        axis.update_autotune();
+
         MEASURE_TIME(axis.task_times_.open_loop_controller_update)
             axis.open_loop_controller_.update(timestamp);
 
@@ -455,10 +584,31 @@ void ODrive::control_loop_cb(uint32_t timestamp) {
     }
 
     get_gpio(odrv.config_.error_gpio_pin).write(odrv.any_error());
+    black_box_.update(timestamp);
+    TRACE(CONTROL_LOOP_END);
 }
 
 
 /** @brief For diagnostics only */
+// All members of a TaskTimes struct are TaskTimers so they can be iterated
+// like an array.
+template<typename T>
+static void reset_task_timers(T& task_times) {
+    static_assert(sizeof(T) % sizeof(TaskTimer) == 0, "TaskTimes struct must only contain TaskTimers");
+    TaskTimer* timers = reinterpret_cast<TaskTimer*>(&task_times);
+    for (size_t i = 0; i < sizeof(T) / sizeof(TaskTimer); ++i) {
+        timers[i].reset();
+    }
+}
+
+void ODrive::reset_task_times() {
+    system_stats_.control_isr.reset();
+    reset_task_timers(task_times_);
+    for (auto& axis: axes) {
+        reset_task_timers(axis.task_times_);
+    }
+}
+
 uint32_t ODrive::get_interrupt_status(int32_t irqn) {
     if ((irqn < -14) || (irqn >= 240)) {
         return 0xffffffff;
@@ -475,6 +625,23 @@ uint32_t ODrive::get_interrupt_status(int32_t irqn) {
     return priority | ((counter & 0x7ffffff) << 8) | (is_enabled ? 0x80000000 : 0);
 }
 
+/**
+ * @brief Returns the stats of the thread at the specified index of
+ * system_stats.threads, or all zeros if there is no such thread.
+ */
+std::tuple<uint64_t, uint64_t, uint32_t, int32_t, float> ODrive::get_thread_stats(uint32_t index) {
+    ThreadStats_t thread = {};
+    CRITICAL_SECTION() {
+        if (index < system_stats_.n_threads) {
+            thread = system_stats_.threads[index];
+        }
+    }
+    static_assert(sizeof(thread.name) == 2 * sizeof(uint64_t), "the name is returned as two words");
+    uint64_t name[2];
+    memcpy(name, thread.name, sizeof(name));
+    return {name[0], name[1], thread.min_stack_space, thread.prio, thread.cpu_load};
+}
+
 /** @brief For diagnostics only */
 uint32_t ODrive::get_dma_status(uint8_t stream_num) {
     DMA_Stream_TypeDef* streams[] = {
@@ -505,10 +672,52 @@ uint32_t ODrive::get_gpio_states() {
     return val;
 }
 
+const uint32_t stack_size_axis_setup_thread = 1024; // Bytes
+static volatile bool axis_setup_done[AXIS_COUNT] = {};
+
+static void setup_axis(Axis& axis) {
+    // Try to initialized gate drivers for fault-free startup.
+    // If this does not succeed, a fault will be raised and the idle loop will
+    // periodically attempt to reinit the gate driver.
+    axis.motor_.setup();
+    axis.encoder_.setup();
+
+    axis_setup_done[axis.axis_num_] = true;
+}
+
+static void axis_setup_thread(void* ctx) {
+    setup_axis(*reinterpret_cast<Axis*>(ctx));
+    vTaskDelete(nullptr);
+}
+
 /**
  * @brief Main thread started from main().
  */
 static void rtos_main(void*) {
+    odrv.system_stats_.boot_times.rtos_start = micros();
+
+    paint_isr_stack();
+
+    // The control loop is the timer whose latency distribution matters most
+    odrv.task_times_.control_loop.set_histogram_enabled(true);
+
+    // Set up the CS pins for absolute encoders (TODO: move to GPIO init switch statement)
+    for(auto& axis : axes){
+        if(axis.encoder_.config_.mode & Encoder::MODE_FLAG_ABS){
+            axis.encoder_.abs_spi_cs_pin_init();
+        }
+    }
+
+    // The axes don't depend on each other or on the communication interfaces
+    // so we set them up concurrently. Most of the time is spent waiting for
+    // the gate drivers.
+    osThreadDef(axis_setup_thread_def, axis_setup_thread, osPriorityNormal, 0, stack_size_axis_setup_thread / sizeof(StackType_t));
+    for (auto& axis: axes) {
+        if (!osThreadCreate(osThread(axis_setup_thread_def), &axis)) {
+            setup_axis(axis); // not enough heap, fall back to serial setup
+        }
+    }
+
     // Init USB device
     MX_USB_DEVICE_Init();
 
@@ -524,23 +733,13 @@ static void rtos_main(void*) {
     // must happen after communication is initialized
     pwm0_input.init();
 
-    // Set up the CS pins for absolute encoders (TODO: move to GPIO init switch statement)
-    for(auto& axis : axes){
-        if(axis.encoder_.config_.mode & Encoder::MODE_FLAG_ABS){
-            axis.encoder_.abs_spi_cs_pin_init();
-        }
-    }
+    odrv.system_stats_.boot_times.interfaces = micros();
 
-    // Try to initialized gate drivers for fault-free startup.
-    // If this does not succeed, a fault will be raised and the idle loop will
-    // periodically attempt to reinit the gate driver.
-    for(auto& axis: axes){
-        axis.motor_.setup();
+    while (!std::all_of(std::begin(axis_setup_done), std::end(axis_setup_done), [](bool done) { return done; })) {
+        osDelay(1);
     }
 
-    for(auto& axis: axes){
-        axis.encoder_.setup();
-    }
+    odrv.system_stats_.boot_times.axis_setup = micros();
 
     for(auto& axis: axes){
         axis.acim_estimator_.idq_src_.connect_to(&axis.motor_.Idq_setpoint_);
@@ -564,6 +763,8 @@ static void rtos_main(void*) {
         osDelay(1);
     }
 
+    odrv.system_stats_.boot_times.adc_calib = micros();
+
     for (auto& axis: axes) {
         axis.sensorless_estimator_.error_ &= ~SensorlessEstimator::ERROR_UNKNOWN_CURRENT_MEASUREMENT;
     }
@@ -575,6 +776,21 @@ static void rtos_main(void*) {
         axes[i].start_thread();
     }
 
+    odrv.system_stats_.boot_times.fully_booted = micros();
+
+    odrv.system_stats_.stack_size_axis = axes[0].stack_size_;
+    odrv.system_stats_.stack_size_usb = stack_size_usb_thread;
+    odrv.system_stats_.stack_size_uart = stack_size_uart_thread;
+    odrv.system_stats_.stack_size_startup = stack_size_default_task;
+    odrv.system_stats_.stack_size_can = odrv.can_.stack_size_;
+    odrv.system_stats_.stack_size_isr = &_estack - &_heap_end_max;
+    odrv.system_stats_.queue_size_usb = usb_event_queue_length;
+    odrv.system_stats_.queue_size_uart = uart_event_queue_length;
+
+    // The startup thread is deleted below so its stats are final at this point
+    odrv.system_stats_.max_stack_usage_startup = stack_size_default_task - uxTaskGetStackHighWaterMark(nullptr) * sizeof(StackType_t);
+    odrv.system_stats_.prio_startup = osThreadGetPriority(defaultTaskHandle);
+
     odrv.system_stats_.fully_booted = true;
 
     // Main thread finished starting everything and can delete itself now (yes this is legal).
@@ -651,6 +867,7 @@ extern "C" int main(void) {
 
     // Init low level system functions (clocks, flash interface)
     system_init();
+    odrv.system_stats_.boot_times.system_init = micros();
 
     // Load configuration from NVM. This needs to happen after system_init()
     // since the flash interface must be initialized and before board_init()
@@ -666,6 +883,11 @@ extern "C" int main(void) {
         config_clear_all();
         config_apply_all();
     }
+    odrv.system_stats_.boot_times.config_load = micros();
+
+    // Prepare the black box flash sectors. This can erase a sector so it must
+    // happen before any time critical interrupts are enabled.
+    odrv.black_box_.init();
 
     odrv.misconfigured_ = odrv.misconfigured_
             || (odrv.config_.enable_uart_a && !uart_a)
@@ -676,6 +898,7 @@ extern "C" int main(void) {
     if (!board_init()) {
         for (;;); // TODO: handle properly
     }
+    odrv.system_stats_.boot_times.board_init = micros();
 
     // Init GPIOs according to their configured mode
     for (size_t i = 0; i < GPIO_COUNT; ++i) {
@@ -816,11 +1039,11 @@ extern "C" int main(void) {
     osSemaphoreWait(sem_usb_irq, 0);
 
     // Create an event queue for UART
-    osMessageQDef(uart_event_queue, 4, uint32_t);
+    osMessageQDef(uart_event_queue, uart_event_queue_length, uint32_t);
     uart_event_queue = osMessageCreate(osMessageQ(uart_event_queue), NULL);
 
     // Create an event queue for USB
-    osMessageQDef(usb_event_queue, 7, uint32_t);
+    osMessageQDef(usb_event_queue, usb_event_queue_length, uint32_t);
     usb_event_queue = osMessageCreate(osMessageQ(usb_event_queue), NULL);
 
     osSemaphoreDef(sem_can);
@@ -0,0 +1,233 @@
+#ifndef __MECHANICAL_IDENTIFIER_HPP
+#define __MECHANICAL_IDENTIFIER_HPP
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <iterator>
+
+/**
+ * @brief Identifies inertia, viscous and Coulomb friction of a mechanism
+ * under a relay excitation.
+ *
+ * The excitation switches between +torque and -torque whenever the velocity
+ * reaches +vel or -vel. This keeps the speed bounded without any knowledge
+ * of the mechanism: a light mechanism oscillates quickly, a heavy one slowly.
+ *
+ * The model is J * dv/dt = T - b * v - Fc * sign(v). Integrating it over a
+ * window of samples gives one row of a linear least squares problem in
+ * (J, b, Fc) that does not need the noisy acceleration:
+ *   sum(T) * dt = J * (v_end - v_start) + b * sum(v) * dt + Fc * sum(sign(v)) * dt
+ * The normal equations are accumulated per window and solved at the end.
+ *
+ * The window is a quarter of the time that the initial acceleration from
+ * standstill to vel took. Thus the velocity change in a window is about the
+ * same for any inertia and stays large compared to the velocity noise, which
+ * would otherwise bias the inertia low.
+ *
+ * Units follow the controller: torque in Nm, velocity in turn/s, inertia in
+ * Nm/(turn/s^2).
+ */
+class MechanicalIdentifier {
+public:
+    static constexpr uint32_t kMaxWindowSamples = 1024;
+
+    struct Result_t {
+        float inertia;          // [Nm/(turn/s^2)]
+        float viscous_friction; // [Nm/(turn/s)]
+        float coulomb_friction; // [Nm]
+    };
+
+    void start(float torque, float vel, uint32_t n_cycles, float min_duration, float sample_period) {
+        torque_ = torque;
+        vel_ = vel;
+        n_cycles_ = n_cycles;
+        min_samples_ = (uint32_t)(min_duration / sample_period);
+        sample_period_ = sample_period;
+        direction_ = 1.0f;
+        n_reversals_ = 0;
+        has_prev_vel_ = false;
+        n_samples_ = 0;
+        window_samples_ = 1;
+        window_idx_ = 0;
+        std::fill(std::begin(xtx_), std::end(xtx_), 0.0f);
+        std::fill(std::begin(xty_), std::end(xty_), 0.0f);
+        done_ = false;
+        running_ = true;
+    }
+
+    void stop() { running_ = false; }
+    bool running() const { return running_; }
+
+    // True once n_cycles full cycles of the relay and at least min_duration
+    // were recorded
+    bool done() const { return done_; }
+
+    /**
+     * @brief Records a sample and returns the torque to apply next.
+     *
+     * @param torque: Torque that was applied since the previous call, for
+     *        instance Iq_measured * torque_constant.
+     * @param vel: Velocity at the time of this call.
+     */
+    float update(float torque, float vel) {
+        if (!running_) {
+            return 0.0f;
+        }
+
+        // The motion from standstill up to the first reversal is not used
+        // because it includes breakaway from static friction.
+        if (n_reversals_ >= 1 && has_prev_vel_) {
+            accumulate(torque, vel);
+        }
+        prev_vel_ = vel;
+        has_prev_vel_ = true;
+        n_samples_++;
+
+        if (direction_ > 0.0f && vel >= vel_) {
+            if (n_reversals_ == 0) {
+                window_samples_ = std::clamp(n_samples_ / 4, (uint32_t)1, kMaxWindowSamples);
+            }
+            direction_ = -1.0f;
+            n_reversals_++;
+        } else if (direction_ < 0.0f && vel <= -vel_) {
+            direction_ = 1.0f;
+            n_reversals_++;
+        }
+
+        if (n_reversals_ > 2 * n_cycles_ && n_samples_ >= min_samples_) {
+            running_ = false;
+            done_ = true;
+            return 0.0f;
+        }
+        return direction_ * torque_;
+    }
+
+    /**
+     * @brief Solves for the mechanical parameters.
+     *
+     * Returns false if there is not enough data or the data does not
+     * determine the parameters, for example if the mechanism barely moved.
+     */
+    bool solve(Result_t* result) const {
+        // Symmetric 3x3 system solved by Cramer's rule
+        const float* a = xtx_;
+        float a00 = a[0], a01 = a[1], a02 = a[2], a11 = a[3], a12 = a[4], a22 = a[5];
+        float c00 = a11 * a22 - a12 * a12;
+        float c01 = a02 * a12 - a01 * a22;
+        float c02 = a01 * a12 - a02 * a11;
+        float c11 = a00 * a22 - a02 * a02;
+        float c12 = a01 * a02 - a00 * a12;
+        float c22 = a00 * a11 - a01 * a01;
+        float det = a00 * c00 + a01 * c01 + a02 * c02;
+
+        // Reject (nearly) singular systems relative to the scale of the data
+        if (!(std::abs(det) > 1e-6f * a00 * a11 * a22)) {
+            return false;
+        }
+
+        const float* y = xty_;
+        float j = (c00 * y[0] + c01 * y[1] + c02 * y[2]) / det;
+        float b = (c01 * y[0] + c11 * y[1] + c12 * y[2]) / det;
+        float fc = (c02 * y[0] + c12 * y[1] + c22 * y[2]) / det;
+        if (!(j > 0.0f)) {
+            return false;
+        }
+
+        result->inertia = j;
+        result->viscous_friction = std::max(b, 0.0f);
+        result->coulomb_friction = std::max(fc, 0.0f);
+        return true;
+    }
+
+    /**
+     * @brief Computes velocity loop gains for the plant 1 / (J*s + b).
+     *
+     * The crossover of the open loop is placed at bandwidth [rad/s] and the
+     * zero of the PI controller is placed such that the loop has the
+     * requested phase margin [deg] there. If the plant alone already uses up
+     * the phase budget, the integrator gain is 0.
+     */
+    static void compute_gains(const Result_t& plant, float bandwidth, float phase_margin,
+            float* vel_gain, float* vel_integrator_gain) {
+        float plant_phase = atan2f(plant.inertia * bandwidth, plant.viscous_friction);
+        float pi_phase = (float)M_PI - phase_margin * ((float)M_PI / 180.0f) - plant_phase;
+        float zero_ratio = pi_phase > 0.0f ? tanf(std::min(pi_phase, 0.5f * (float)M_PI - 0.01f)) : 0.0f;
+
+        float plant_gain = 1.0f / sqrtf(plant.viscous_friction * plant.viscous_friction
+                + plant.inertia * plant.inertia * bandwidth * bandwidth);
+        *vel_gain = 1.0f / (plant_gain * sqrtf(1.0f + zero_ratio * zero_ratio));
+        *vel_integrator_gain = *vel_gain * zero_ratio * bandwidth;
+    }
+
+private:
+    void accumulate(float torque, float vel) {
+        // The torque was applied while moving from prev_vel_ to vel
+        if (window_idx_ == 0) {
+            window_start_vel_ = prev_vel_;
+            window_torque_ = window_vel_ = window_sign_ = 0.0f;
+        }
+        // Integrals over the sample assuming a linear change of velocity.
+        // The mean of sign(v) is the slope of |v|, which also covers a zero
+        // crossing within the sample.
+        float dv = vel - prev_vel_;
+        window_torque_ += torque;
+        window_vel_ += 0.5f * (prev_vel_ + vel);
+        if (dv != 0.0f) {
+            window_sign_ += (std::abs(vel) - std::abs(prev_vel_)) / dv;
+        } else {
+            window_sign_ += prev_vel_ > 0.0f ? 1.0f : prev_vel_ < 0.0f ? -1.0f : 0.0f;
+        }
+
+        if (++window_idx_ < window_samples_) {
+            return;
+        }
+        window_idx_ = 0;
+
+        // Row scaled to averages over the window so that all columns are in
+        // their natural units (turn/s^2, turn/s and 1).
+        float n = (float)window_samples_;
+        float x[3] = {
+            (vel - window_start_vel_) / (n * sample_period_),
+            window_vel_ / n,
+            window_sign_ / n
+        };
+        float y = window_torque_ / n;
+
+        xtx_[0] += x[0] * x[0];
+        xtx_[1] += x[0] * x[1];
+        xtx_[2] += x[0] * x[2];
+        xtx_[3] += x[1] * x[1];
+        xtx_[4] += x[1] * x[2];
+        xtx_[5] += x[2] * x[2];
+        xty_[0] += x[0] * y;
+        xty_[1] += x[1] * y;
+        xty_[2] += x[2] * y;
+    }
+
+    float torque_ = 0.0f; // [Nm]
+    float vel_ = 0.0f;    // [turn/s]
+    uint32_t n_cycles_ = 0;
+    uint32_t min_samples_ = 0;
+    float sample_period_ = 0.0f; // [s]
+
+    bool running_ = false;
+    bool done_ = false;
+    float direction_ = 1.0f;
+    uint32_t n_reversals_ = 0;
+    float prev_vel_ = 0.0f;
+    bool has_prev_vel_ = false;
+
+    uint32_t n_samples_ = 0;
+    uint32_t window_samples_ = 1;
+    uint32_t window_idx_ = 0;
+    float window_start_vel_ = 0.0f;
+    float window_torque_ = 0.0f;
+    float window_vel_ = 0.0f;
+    float window_sign_ = 0.0f;
+
+    float xtx_[6] = {}; // upper triangle of X^T * X
+    float xty_[3] = {}; // X^T * y
+};
+
+#endif // __MECHANICAL_IDENTIFIER_HPP
@@ -3,6 +3,7 @@
 #include "axis.hpp"
 #include "low_level.h"
 #include "odrive_main.h"
+#include "rl_measurement.hpp"
 
 #include <algorithm>
 
@@ -17,7 +18,7 @@ static constexpr auto CURRENT_ADC_UPPER_BOUND =        (uint32_t)((float)(1 << 1
  */
 struct ResistanceMeasurementControlLaw : AlphaBetaFrameController {
     void reset() final {
-        test_voltage_ = 0.0f;
+        meas_.reset();
         test_mod_ = std::nullopt;
     }
 
@@ -28,21 +29,21 @@ struct ResistanceMeasurementControlLaw : AlphaBetaFrameController {
 
         if (Ialpha_beta.has_value()) {
             actual_current_ = Ialpha_beta->first;
-            test_voltage_ += (kI * current_meas_period) * (target_current_ - actual_current_);
+            meas_.update(actual_current_, target_current_, current_meas_period);
             I_beta_ += (kIBetaFilt * current_meas_period) * (Ialpha_beta->second - I_beta_);
         } else {
             actual_current_ = 0.0f;
-            test_voltage_ = 0.0f;
+            meas_.test_voltage_ = 0.0f;
         }
     
-        if (std::abs(test_voltage_) > max_voltage_) {
-            test_voltage_ = NAN;
+        if (std::abs(meas_.test_voltage_) > max_voltage_) {
+            meas_.test_voltage_ = NAN;
             return Motor::ERROR_PHASE_RESISTANCE_OUT_OF_RANGE;
         } else if (!vbus_voltage.has_value()) {
             return Motor::ERROR_UNKNOWN_VBUS_VOLTAGE;
         } else {
             float vfactor = 1.0f / ((2.0f / 3.0f) * *vbus_voltage);
-            test_mod_ = test_voltage_ * vfactor;
+            test_mod_ = meas_.test_voltage_ * vfactor;
             return Motor::ERROR_NONE;
         }
     }
@@ -61,21 +62,33 @@ struct ResistanceMeasurementControlLaw : AlphaBetaFrameController {
     }
 
     float get_resistance() {
-        return test_voltage_ / target_current_;
+        return meas_.get_resistance(target_current_);
+    }
+
+    float get_resistance_mean() {
+        return meas_.stats_.mean();
+    }
+
+    bool is_converged(float rel_tolerance) {
+        RunningStats stats;
+        CRITICAL_SECTION() {
+            stats = meas_.stats_;
+        }
+        return stats.is_converged(rel_tolerance, kMinSamples);
     }
 
     float get_Ibeta() {
         return I_beta_;
     }
 
-    const float kI = 1.0f; // [(V/s)/A]
     const float kIBetaFilt = 80.0f;
+    const uint32_t kMinSamples = current_meas_hz / 10; // collect for at least 100ms
     float max_voltage_ = 0.0f;
     float actual_current_ = 0.0f;
     float target_current_ = 0.0f;
-    float test_voltage_ = 0.0f;
     float I_beta_ = 0.0f; // [A] low pass filtered Ibeta response
     std::optional<float> test_mod_ = NAN;
+    ResistanceMeasurement meas_;
 };
 
 /**
@@ -88,6 +101,7 @@ struct ResistanceMeasurementControlLaw : AlphaBetaFrameController {
 struct InductanceMeasurementControlLaw : AlphaBetaFrameController {
     void reset() final {
         attached_ = false;
+        meas_.reset();
     }
 
     ODriveIntf::MotorIntf::Error on_measurement(
@@ -101,15 +115,14 @@ struct InductanceMeasurementControlLaw : AlphaBetaFrameController {
 
         float Ialpha = Ialpha_beta->first;
 
-        if (attached_) {
-            float sign = test_voltage_ >= 0.0f ? 1.0f : -1.0f;
-            deltaI_ += -sign * (Ialpha - last_Ialpha_);
-        } else {
+        if (!attached_) {
             start_timestamp_ = input_timestamp;
             attached_ = true;
         }
 
-        last_Ialpha_ = Ialpha;
+        // The current measured now is the response to the voltage before the
+        // one that is currently output
+        meas_.update(Ialpha, -test_voltage_);
         last_input_timestamp_ = input_timestamp;
 
         return Motor::ERROR_NONE;
@@ -127,12 +140,20 @@ struct InductanceMeasurementControlLaw : AlphaBetaFrameController {
     }
 
     float get_inductance() {
-        // Note: A more correct formula would also take into account that there is a finite timestep.
-        // However, the discretisation in the current control loop inverts the same discrepancy
         float dt = (float)(last_input_timestamp_ - start_timestamp_) / (float)TIM_1_8_CLOCK_HZ; // at 216MHz this overflows after 19 seconds
-        return std::abs(test_voltage_) / (deltaI_ / dt);
+        return meas_.get_inductance(test_voltage_, dt);
     }
 
+    bool is_converged(float rel_tolerance) {
+        RunningStats stats;
+        CRITICAL_SECTION() {
+            stats = meas_.stats_;
+        }
+        return stats.is_converged(rel_tolerance, kMinSamples);
+    }
+
+    const uint32_t kMinSamples = current_meas_hz / 20; // collect for at least 50ms
+
     // Config
     float test_voltage_ = 0.0f;
 
@@ -142,9 +163,8 @@ struct InductanceMeasurementControlLaw : AlphaBetaFrameController {
 
     // Outputs
     uint32_t start_timestamp_ = 0;
-    float last_Ialpha_ = NAN;
     uint32_t last_input_timestamp_ = 0;
-    float deltaI_ = 0.0f;
+    InductanceMeasurement meas_;
 };
 
 
@@ -209,7 +229,7 @@ bool Motor::arm(PhaseControlLaw<3>* control_law) {
             armed_state_ = 1;
             is_armed_ = true;
         } else {
-            error_ |= Motor::ERROR_BRAKE_RESISTOR_DISARMED;
+            set_error(Motor::ERROR_BRAKE_RESISTOR_DISARMED);
         }
     }
 
@@ -337,9 +357,16 @@ bool Motor::setup() {
     return true;
 }
 
-void Motor::disarm_with_error(Motor::Error error){
+void Motor::set_error(Motor::Error error) {
+    if (error & ~error_) {
+        odrv.journal_.log(Journal::JOURNAL_ENTRY_TYPE_MOTOR_ERROR, axis_->axis_num_, error, axis_->current_state_);
+    }
     error_ |= error;
     last_error_time_ = odrv.n_evt_control_loop_ * current_meas_period;
+}
+
+void Motor::disarm_with_error(Motor::Error error){
+    set_error(error);
     disarm();
 }
 
@@ -393,10 +420,124 @@ float Motor::max_available_torque() {
     }
 }
 
+/**
+ * @brief Moves x towards zero until a*x^2 + b*x + c <= 0, assuming a >= 0.
+ * If no point between zero and x meets the condition, zero is returned, so
+ * the sign of x is never reversed.
+ */
+static float clamp_to_nonpositive_quadratic(float x, float a, float b, float c) {
+    float lower = std::min(x, 0.0f);
+    float upper = std::max(x, 0.0f);
+    if (a <= 0.0f) {
+        if (b > 0.0f) {
+            upper = std::min(upper, -c / b);
+        } else if (b < 0.0f) {
+            lower = std::max(lower, -c / b);
+        } else if (c > 0.0f) {
+            return 0.0f;
+        }
+    } else {
+        float disc = SQ(b) - 4.0f * a * c;
+        if (disc < 0.0f) {
+            return 0.0f;
+        }
+        float sqrt_disc = std::sqrt(disc);
+        lower = std::max(lower, (-b - sqrt_disc) / (2.0f * a));
+        upper = std::min(upper, (-b + sqrt_disc) / (2.0f * a));
+    }
+    if (lower > upper) {
+        return 0.0f; // the feasible interval does not overlap [0, x]
+    }
+    return std::clamp(x, lower, upper);
+}
+
+/**
+ * @brief Moves x towards zero until a*x^2 + b*x + c >= 0, assuming a >= 0.
+ * If no point between zero and x meets the condition, zero is returned, so
+ * the sign of x is never reversed.
+ */
+static float clamp_to_nonnegative_quadratic(float x, float a, float b, float c) {
+    if ((a * x + b) * x + c >= 0.0f) {
+        return x;
+    }
+    if (a <= 0.0f && b == 0.0f) {
+        return 0.0f;
+    }
+
+    // x is strictly between the roots (or beyond the only root if a == 0),
+    // so the closest feasible point towards zero is the root on that side.
+    float root;
+    if (a <= 0.0f) {
+        root = -c / b;
+    } else {
+        float sqrt_disc = std::sqrt(std::max(SQ(b) - 4.0f * a * c, 0.0f));
+        root = (x > 0.0f) ? (-b - sqrt_disc) / (2.0f * a) : (-b + sqrt_disc) / (2.0f * a);
+    }
+    if ((x > 0.0f) ? (root < 0.0f || root > x) : (root > 0.0f || root < x)) {
+        return 0.0f;
+    }
+    return root;
+}
+
+/**
+ * @brief Limits the Iq setpoint such that the predicted DC bus power of this
+ * motor stays within its share of `dc_max_positive_power` and
+ * `dc_max_negative_power`.
+ *
+ * The bus power is predicted as P = 3/2 * (Vd*Id + Vq*Iq) where Vq is modelled
+ * as the voltage that was applied in the last PWM cycle plus the change in
+ * resistive drop. This is quadratic in Iq and is solved for the Iq bounds.
+ *
+ * Each motor gets the budget that the other armed motors leave over based on
+ * their prediction from the current or previous control loop iteration. A
+ * motor that regenerates therefore frees up budget for a motor that
+ * accelerates. If the prediction of another armed motor is older than that,
+ * all motors fall back to an equal share of the limits.
+ *
+ * Iq is only ever moved towards zero. If even Iq = 0 exceeds the budget,
+ * Iq = 0 is returned.
+ */
+float Motor::apply_power_limit(uint32_t timestamp, float id, float iq) {
+    float R = config_.phase_resistance;
+    float Iq_measured = current_control_.Iq_measured_;
+    float v_q0 = current_control_.final_v_q_ - R * Iq_measured; // back-EMF and cross coupling
+    float p_d = 1.5f * current_control_.final_v_d_ * id;
+    float a = 1.5f * R;
+    float b = 1.5f * v_q0;
+
+    float p_max = odrv.config_.dc_max_positive_power;
+    float p_min = odrv.config_.dc_max_negative_power;
+
+    if (p_max < INFINITY || p_min > -INFINITY) {
+        float p_others = 0.0f;
+        bool stale = false;
+        for (size_t i = 0; i < AXIS_COUNT; ++i) {
+            Motor& other = axes[i].motor_;
+            if (&other != this && other.is_armed_) {
+                p_others += other.predicted_power_;
+                stale = stale || (timestamp - other.predicted_power_timestamp_ > CONTROL_TIMER_PERIOD_TICKS);
+            }
+        }
+
+        if (p_max < INFINITY) {
+            p_max = stale ? p_max / (float)AXIS_COUNT : std::max(p_max - p_others, 0.0f);
+            iq = clamp_to_nonpositive_quadratic(iq, a, b, p_d - p_max);
+        }
+        if (p_min > -INFINITY) {
+            p_min = stale ? p_min / (float)AXIS_COUNT : std::min(p_min - p_others, 0.0f);
+            iq = clamp_to_nonnegative_quadratic(iq, a, b, p_d - p_min);
+        }
+    }
+
+    predicted_power_ = (a * iq + b) * iq + p_d;
+    predicted_power_timestamp_ = timestamp;
+    return iq;
+}
+
 std::optional<float> Motor::phase_current_from_adcval(uint32_t ADCValue) {
     // Make sure the measurements don't come too close to the current sensor's hardware limitations
     if (ADCValue < CURRENT_ADC_LOWER_BOUND || ADCValue > CURRENT_ADC_UPPER_BOUND) {
-        error_ |= ERROR_CURRENT_SENSE_SATURATION;
+        set_error(ERROR_CURRENT_SENSE_SATURATION);
         return std::nullopt;
     }
 
@@ -419,10 +560,17 @@ bool Motor::measure_phase_resistance(float test_current, float max_voltage) {
 
     arm(&control_law);
 
+    // The fixed duration is an upper bound. If calibration_tolerance is set,
+    // the measurement ends as soon as the estimate is accurate enough.
+    bool converged = false;
     for (size_t i = 0; i < 3000; ++i) {
         if (!((axis_->requested_state_ == Axis::AXIS_STATE_UNDEFINED) && axis_->motor_.is_armed_)) {
             break;
         }
+        if (control_law.is_converged(config_.calibration_tolerance)) {
+            converged = true;
+            break;
+        }
         osDelay(1);
     }
 
@@ -434,7 +582,15 @@ bool Motor::measure_phase_resistance(float test_current, float max_voltage) {
 
     disarm();
 
-    config_.phase_resistance = control_law.get_resistance();
+    if (converged) {
+        // The integrator may not have settled yet so its output is not usable.
+        config_.phase_resistance = control_law.get_resistance_mean();
+        if (std::abs(config_.phase_resistance * test_current) > max_voltage) {
+            config_.phase_resistance = NAN;
+        }
+    } else {
+        config_.phase_resistance = control_law.get_resistance();
+    }
     if (is_nan(config_.phase_resistance)) {
         // TODO: the motor is already disarmed at this stage. This is an error
         // that only pretains to the measurement and its result so it should
@@ -463,6 +619,9 @@ bool Motor::measure_phase_inductance(float test_voltage) {
         if (!((axis_->requested_state_ == Axis::AXIS_STATE_UNDEFINED) && axis_->motor_.is_armed_)) {
             break;
         }
+        if (control_law.is_converged(config_.calibration_tolerance)) {
+            break;
+        }
         osDelay(1);
     }
 
@@ -478,7 +637,7 @@ bool Motor::measure_phase_inductance(float test_voltage) {
     
     // TODO arbitrary values set for now
     if (!(config_.phase_inductance >= 2e-6f && config_.phase_inductance <= 4000e-6f)) {
-        error_ |= ERROR_PHASE_INDUCTANCE_OUT_OF_RANGE;
+        set_error(ERROR_PHASE_INDUCTANCE_OUT_OF_RANGE);
         success = false;
     }
 
@@ -513,7 +672,7 @@ void Motor::update(uint32_t timestamp) {
     // Load torque setpoint, convert to motor direction
     std::optional<float> maybe_torque = torque_setpoint_src_.present();
     if (!maybe_torque.has_value()) {
-        error_ |= ERROR_UNKNOWN_TORQUE;
+        set_error(ERROR_UNKNOWN_TORQUE);
         return;
     }
     float torque = direction_ * *maybe_torque;
@@ -547,6 +706,7 @@ void Motor::update(uint32_t timestamp) {
     iq = std::clamp(iq, -Iq_lim, Iq_lim);
 
     if (axis_->motor_.config_.motor_type != Motor::MOTOR_TYPE_GIMBAL) {
+        iq = apply_power_limit(timestamp, id, iq);
         Idq_setpoint_ = {id, iq};
     }
 
@@ -565,7 +725,7 @@ void Motor::update(uint32_t timestamp) {
 
     if (config_.R_wL_FF_enable) {
         if (!phase_vel.has_value()) {
-            error_ |= ERROR_UNKNOWN_PHASE_VEL;
+            set_error(ERROR_UNKNOWN_PHASE_VEL);
             return;
         }
 
@@ -577,7 +737,7 @@ void Motor::update(uint32_t timestamp) {
 
     if (config_.bEMF_FF_enable) {
         if (!phase_vel.has_value()) {
-            error_ |= ERROR_UNKNOWN_PHASE_VEL;
+            set_error(ERROR_UNKNOWN_PHASE_VEL);
             return;
         }
 
@@ -683,6 +843,7 @@ void Motor::dc_calib_cb(uint32_t timestamp, std::optional<Iph_ABC_t> current) {
 
 
 void Motor::pwm_update_cb(uint32_t output_timestamp) {
+    TRACE(PWM_UPDATE_BEGIN, axis_->axis_num_);
     TaskTimerContext tmr{axis_->task_times_.pwm_update};
     n_evt_pwm_update_++;
 
@@ -729,4 +890,5 @@ void Motor::pwm_update_cb(uint32_t output_timestamp) {
     }
 
     update_brake_current();
+    TRACE(PWM_UPDATE_END, axis_->axis_num_);
 }
@@ -21,6 +21,7 @@ public:
         float resistance_calib_max_voltage = 2.0f; // [V] - You may need to increase this if this voltage isn't sufficient to drive calibration_current through the motor.
         float phase_inductance = 0.0f;        // to be set by measure_phase_inductance
         float phase_resistance = 0.0f;        // to be set by measure_phase_resistance
+        float calibration_tolerance = 0.0f;   // Relative accuracy at which the R and L measurements end early. 0 disables early termination.
         float torque_constant = 0.04f;         // [Nm/A] for PM motors, [Nm/A^2] for induction motors. Equal to 8.27/Kv of the motor
         MotorType motor_type = MOTOR_TYPE_HIGH_CURRENT;
         // Read out max_allowed_current to see max supported value for current_lim.
@@ -75,10 +76,12 @@ public:
     bool setup();
 
     void update_current_controller_gains();
+    void set_error(Error error);
     void disarm_with_error(Error error);
     bool do_checks(uint32_t timestamp);
     float effective_current_lim();
     float max_available_torque();
+    float apply_power_limit(uint32_t timestamp, float id, float iq);
     std::optional<float> phase_current_from_adcval(uint32_t ADCValue);
     bool measure_phase_resistance(float test_current, float max_voltage);
     bool measure_phase_inductance(float test_voltage);
@@ -119,6 +122,8 @@ public:
     Iph_ABC_t DC_calib_ = {0.0f, 0.0f, 0.0f};
     float dc_calib_running_since_ = 0.0f; // current sensor calibration needs some time to settle
     float I_bus_ = 0.0f; // this motors contribution to the bus current
+    float predicted_power_ = 0.0f; // [W] predicted DC bus power of the current Idq setpoint
+    uint32_t predicted_power_timestamp_ = 0; // control loop timestamp of predicted_power_
     float phase_current_rev_gain_ = 0.0f; // Reverse gain for ADC to Amps (to be set by DRV8301_setup)
     FieldOrientedController current_control_;
     float effective_current_lim_ = 10.0f; // [A]
@@ -9,6 +9,7 @@
 #include <communication/interface_i2c.h>
 #include <communication/interface_uart.h>
 #include <task_timer.hpp>
+#include <load_meter.hpp>
 extern "C" {
 #endif
 
@@ -24,6 +25,30 @@ extern char serial_number_str[13];
 #ifdef __cplusplus
 }
 
+// Timestamps [us] at which the respective boot phases were completed
+typedef struct {
+    uint32_t system_init;
+    uint32_t config_load;
+    uint32_t board_init;
+    uint32_t rtos_start;
+    uint32_t interfaces;
+    uint32_t axis_setup; // gate driver config and encoder setup
+    uint32_t adc_calib; // current sensor offset calibration
+    uint32_t fully_booted;
+} BootTimes_t;
+
+// Maximum number of threads that are reported in system_stats
+#define MAX_THREAD_STATS 16
+
+typedef struct {
+    uint32_t number;          // FreeRTOS task number, unique for the lifetime of the thread
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t min_stack_space; // [Bytes] since the thread was started
+    int32_t prio;
+    float cpu_load;           // fraction of the last CPU load window
+    uint32_t run_time;        // run time counter at the end of the last window
+} ThreadStats_t;
+
 typedef struct {
     bool fully_booted;
     uint32_t uptime; // [ms]
@@ -40,12 +65,42 @@ typedef struct {
     uint32_t stack_size_startup;
     uint32_t stack_size_can;
 
+    // The main stack is used by interrupts once the scheduler is running
+    uint32_t max_stack_usage_isr; // [Bytes]
+    uint32_t stack_size_isr;
+
+    // High-water marks of the event queues, CAN mailboxes and pending SPI transfers
+    uint32_t max_queue_usage_usb;
+    uint32_t max_queue_usage_uart;
+    uint32_t queue_size_usb;
+    uint32_t queue_size_uart;
+    uint32_t max_can_tx_mailbox_usage; // out of 3
+    uint32_t max_can_rx_fifo_usage;    // out of 3
+    uint32_t max_spi_queue_length;     // including the active transfer
+
     int32_t prio_axis;
     int32_t prio_usb;
     int32_t prio_uart;
     int32_t prio_startup;
     int32_t prio_can;
 
+    // Fraction of the last CPU load window spent in the respective thread,
+    // not counting the control loop interrupts (see control_isr)
+    float cpu_load_axis; // both axis threads together
+    float cpu_load_usb;
+    float cpu_load_uart;
+    float cpu_load_startup;
+    float cpu_load_can;
+    float cpu_load_idle;
+
+    // All threads as of the last CPU load window, see ODrive::get_thread_stats()
+    ThreadStats_t threads[MAX_THREAD_STATS];
+    uint32_t n_threads;
+
+    LoadMeter control_isr; // TIM8 update interrupt through the end of the control loop interrupt
+
+    BootTimes_t boot_times;
+
     USBStats_t& usb = usb_stats_;
     I2CStats_t& i2c = i2c_stats_;
 } SystemStats_t;
@@ -106,13 +161,17 @@ struct BoardConfig_t {
 
     float dc_max_positive_current = INFINITY; // Max current [A] the power supply can source
     float dc_max_negative_current = -0.01f; // Max current [A] the power supply can sink. You most likely want a non-positive value here. Set to -INFINITY to disable.
+    float dc_max_positive_power = INFINITY; // Max power [W] drawn from the DC bus by all motors together. The torque command is limited to stay below this. Set to INFINITY to disable.
+    float dc_max_negative_power = -INFINITY; // Max power [W] fed back into the DC bus by all motors together (non-positive). The torque command is limited to stay above this. Set to -INFINITY to disable.
     uint32_t error_gpio_pin = DEFAULT_ERROR_PIN;
+    uint32_t cpu_load_window = 1000; // [ms] window over which system_stats.control_isr and cpu_load_* are computed (max 25000)
     PWMMapping_t pwm_mappings[4];
     PWMMapping_t analog_mappings[GPIO_COUNT];
 };
 
 struct TaskTimes {
     TaskTimer sampling;
+    TaskTimer control_loop;
     TaskTimer control_loop_misc;
     TaskTimer control_loop_checks;
     TaskTimer dc_calib_wait;
@@ -139,8 +198,12 @@ inline ENUMTYPE operator ~ (ENUMTYPE a) { return static_cast<ENUMTYPE>(~static_c
 // ODrive specific includes
 #include <utils.hpp>
 #include <low_level.h>
+#include <kalman_gains.hpp>
 #include <encoder.hpp>
 #include <sensorless_estimator.hpp>
+#include <freq_response.hpp>
+#include <inertia_estimator.hpp>
+#include <disturbance_observer.hpp>
 #include <controller.hpp>
 #include <current_limiter.hpp>
 #include <thermistor.hpp>
@@ -149,6 +212,10 @@ inline ENUMTYPE operator ~ (ENUMTYPE a) { return static_cast<ENUMTYPE>(~static_c
 #include <mechanical_brake.hpp>
 #include <axis.hpp>
 #include <oscilloscope.hpp>
+#include <snapshot.hpp>
+#include <trace.hpp>
+#include <black_box.hpp>
+#include <journal.hpp>
 #include <communication/communication.h>
 #include <communication/can/odrive_can.hpp>
 
@@ -173,6 +240,7 @@ public:
     void enter_dfu_mode() override;
     bool any_error();
     void clear_errors() override;
+    void reset_task_times() override;
 
     float get_adc_voltage(uint32_t gpio) override {
         return ::get_adc_voltage(get_gpio(gpio));
@@ -192,6 +260,7 @@ public:
     uint32_t get_interrupt_status(int32_t irqn);
     uint32_t get_dma_status(uint8_t stream_num);
     uint32_t get_gpio_states();
+    std::tuple<uint64_t, uint64_t, uint32_t, int32_t, float> get_thread_stats(uint32_t index);
     uint64_t get_drv_fault();
     void disarm_with_error(Error error);
 
@@ -219,12 +288,11 @@ public:
 
     SystemStats_t system_stats_;
 
-    // Edit these to suit your capture needs
-    Oscilloscope oscilloscope_{
-        nullptr, // trigger_src
-        0.5f, // trigger_threshold
-        nullptr // data_src TODO: change data type
-    };
+    Oscilloscope oscilloscope_;
+    Snapshot snapshot_;
+    Trace& trace_ = ::trace;
+    BlackBox black_box_;
+    Journal journal_;
 
     ODriveCAN can_;
 
@@ -1,27 +1,216 @@
 
 #include "oscilloscope.hpp"
+#include "raw_cursor.hpp"
 
-// if you use the oscilloscope feature you can bump up this value
-#define OSCILLOSCOPE_SIZE 4096
+#include <board.h>
+#include <string.h>
+#include <algorithm>
+
+bool Oscilloscope::resolve(endpoint_ref_t endpoint, ActiveChannel_t* channel) {
+    if (!fibre::resolve_endpoint_ref(endpoint, &channel->property)) {
+        return false;
+    }
+    channel->type_info = dynamic_cast<const FloatGettableTypeInfo*>(channel->property.get_type_info());
+    return channel->type_info != nullptr;
+}
+
+/**
+ * @brief Starts a new capture with the current channel and trigger settings.
+ *
+ * The endpoints are resolved here so that the control loop only needs to
+ * follow the resolved pointers. The new layout is swapped in within a
+ * critical section, which is by construction between two control loop
+ * iterations, so all channels of the first frame are sampled in the same
+ * iteration.
+ *
+ * Channels with an invalid endpoint are skipped. Returns false if no channel
+ * is valid.
+ */
+bool Oscilloscope::arm() {
+    ActiveChannel_t channels[kMaxChannels];
+    uint8_t n_channels = 0;
+    uint16_t frame_stride = 0;
+
+    for (size_t i = 0; i < kMaxChannels; ++i) {
+        ActiveChannel_t& channel = channels[n_channels];
+        if (!resolve(channels_[i].endpoint, &channel)) {
+            continue;
+        }
+        channel.scale = channels_[i].scale;
+        channel.inv_scale = channel.scale != 0.0f ? 1.0f / channel.scale : 0.0f;
+        channel.offset = frame_stride;
+        frame_stride += channel.scale != 0.0f ? 1 : 2;
+        n_channels++;
+    }
+
+    if (!n_channels) {
+        return false;
+    }
+
+    ActiveChannel_t trigger_channel;
+    bool has_trigger_channel = resolve(trigger_endpoint_, &trigger_channel);
+
+    uint32_t size = (sizeof(data_) / sizeof(data_[0])) / frame_stride;
+    float pretrigger = std::clamp(pretrigger_, 0.0f, 1.0f);
+    uint32_t pretrigger_frames = std::min((uint32_t)(pretrigger * (float)size), size - 1);
+
+    CRITICAL_SECTION() {
+        std::copy(channels, channels + n_channels, active_channels_);
+        n_channels_ = n_channels;
+        frame_stride_ = frame_stride;
+        size_ = size;
+        pretrigger_frames_ = pretrigger_frames;
+        trigger_channel_ = trigger_channel;
+        has_trigger_channel_ = has_trigger_channel;
+        active_trigger_edge_ = trigger_edge_;
+        active_trigger_level_ = trigger_level_;
+        active_decimation_ = std::max(decimation_, (uint32_t)1);
+
+        decimation_counter_ = active_decimation_ - 1; // sample on the next iteration
+        write_idx_ = 0;
+        n_written_ = 0;
+        start_idx_ = 0;
+        remaining_ = 0;
+        last_trigger_val_ = NAN;
+        trigger_requested_ = false;
+        raw_offset_ = 0;
+        state_ = CAPTURE_STATE_ARMED;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Forces the trigger of an armed capture. If the pretrigger part of
+ * the buffer is not full yet, the trigger happens as soon as it is.
+ */
+void Oscilloscope::trigger() {
+    trigger_requested_ = true;
+}
+
+bool Oscilloscope::check_trigger(float val) {
+    float last_val = last_trigger_val_;
+    last_trigger_val_ = val;
+
+    bool rising = (last_val < active_trigger_level_) && (val >= active_trigger_level_);
+    bool falling = (last_val > active_trigger_level_) && (val <= active_trigger_level_);
+
+    switch (active_trigger_edge_) {
+        case TRIGGER_EDGE_RISING: return rising;
+        case TRIGGER_EDGE_FALLING: return falling;
+        case TRIGGER_EDGE_ANY: return rising || falling;
+        default: return false;
+    }
+}
+
+/**
+ * @brief Returns a sample of the finished capture.
+ *
+ * The samples are interleaved and in chronological order, i.e. index
+ * `frame * n_channels + channel`. Frame 0 is the oldest pretrigger frame.
+ */
+float Oscilloscope::get_val(uint32_t index) {
+    if (state_ != CAPTURE_STATE_DONE || !n_channels_) {
+        return NAN;
+    }
+
+    uint32_t frame = index / n_channels_;
+    if (frame >= size_) {
+        return NAN;
+    }
+
+    const ActiveChannel_t& channel = active_channels_[index % n_channels_];
+    const uint16_t* src = &data_[((start_idx_ + frame) % size_) * frame_stride_ + channel.offset];
+
+    if (channel.scale != 0.0f) {
+        return (float)(int16_t)*src * channel.scale;
+    } else {
+        float val;
+        memcpy(&val, src, sizeof(val));
+        return val;
+    }
+}
+
+/**
+ * @brief Returns the storage scale of the specified channel of the current
+ * capture. 0 means the channel is stored as float32, otherwise as int16.
+ */
+float Oscilloscope::get_scale(uint8_t channel) {
+    return channel < n_channels_ ? active_channels_[channel].scale : NAN;
+}
+
+/**
+ * @brief Returns the next 8 bytes of the finished capture in its storage
+ * format and advances raw_offset_.
+ *
+ * This allows reading out the capture with one request per 8 bytes instead of
+ * three requests per sample with get_val(). The frames are in chronological
+ * order, same as for get_val(). Within a frame, the channels are packed in
+ * order, taking 2 bytes if they are stored as int16 (see get_scale()) and 4
+ * bytes otherwise. Reading past the end returns 0.
+ */
+uint64_t Oscilloscope::read_raw() {
+    size_t n_halfwords = (state_ == CAPTURE_STATE_DONE) ? size_ * frame_stride_ : 0;
+    return raw_read_elements<uint16_t>(n_halfwords, &raw_offset_, [this](size_t halfword) {
+        size_t frame = halfword / frame_stride_;
+        return data_[((start_idx_ + frame) % size_) * frame_stride_ + halfword % frame_stride_];
+    });
+}
+
+static inline uint16_t quantize(float val) {
+    // The negated comparisons also catch NaN
+    if (!(val > -32768.0f)) {
+        return (uint16_t)(int16_t)-32768;
+    } else if (!(val < 32767.0f)) {
+        return (uint16_t)(int16_t)32767;
+    }
+    return (uint16_t)(int16_t)(val + (val >= 0.0f ? 0.5f : -0.5f));
+}
 
 void Oscilloscope::update() {
-    float trigger_data = trigger_src_ ? *trigger_src_ : 0.0f;
-    float trigger_threshold = trigger_threshold_;
-    float sample_data = data_src_ ? **data_src_ : 0.0f;
+    if (state_ != CAPTURE_STATE_ARMED && state_ != CAPTURE_STATE_TRIGGERED) {
+        return;
+    }
 
-    if (trigger_data < trigger_threshold) {
-        ready_ = true;
+    if (++decimation_counter_ < active_decimation_) {
+        return;
     }
-    if (ready_ && trigger_data >= trigger_threshold) {
-        capturing_ = true;
-        ready_ = false;
+    decimation_counter_ = 0;
+
+    if (state_ == CAPTURE_STATE_ARMED) {
+        bool triggered = trigger_requested_ || !has_trigger_channel_;
+        float val;
+        if (has_trigger_channel_ && trigger_channel_.type_info->get_float(trigger_channel_.property, &val)) {
+            triggered = check_trigger(val) || triggered;
+        }
+
+        // Only accept the trigger once the pretrigger part is complete
+        if (triggered && n_written_ >= pretrigger_frames_) {
+            trigger_requested_ = false;
+            start_idx_ = (write_idx_ + size_ - pretrigger_frames_) % size_;
+            remaining_ = size_ - pretrigger_frames_;
+            state_ = CAPTURE_STATE_TRIGGERED;
+        }
     }
-    if (capturing_) {
-        if (pos_ < OSCILLOSCOPE_SIZE) {
-            data_[pos_++] = sample_data;
+
+    uint16_t* frame = &data_[write_idx_ * frame_stride_];
+    for (size_t i = 0; i < n_channels_; ++i) {
+        const ActiveChannel_t& channel = active_channels_[i];
+        float val = NAN;
+        channel.type_info->get_float(channel.property, &val);
+        if (channel.scale != 0.0f) {
+            frame[channel.offset] = quantize(val * channel.inv_scale);
         } else {
-            pos_ = 0;
-            capturing_ = false;
+            memcpy(&frame[channel.offset], &val, sizeof(val));
         }
     }
+
+    write_idx_ = (write_idx_ + 1 < size_) ? (write_idx_ + 1) : 0;
+    if (n_written_ < size_) {
+        n_written_++;
+    }
+
+    if (state_ == CAPTURE_STATE_TRIGGERED && --remaining_ == 0) {
+        state_ = CAPTURE_STATE_DONE;
+    }
 }
@@ -2,30 +2,74 @@
 #define __OSCILLOSCOPE_HPP
 
 #include <autogen/interfaces.hpp>
+#include <fibre/introspection.hpp>
 
+// Capture buffer size in 32-bit words. A float32 channel takes one word per
+// sample, an int16 channel half a word, so int16 storage doubles the depth.
+// 8-bit samples would be too coarse for currents and positions, and the CCM
+// RAM is taken by the heap, so the buffer keeps its original size.
 // if you use the oscilloscope feature you can bump up this value
 #define OSCILLOSCOPE_SIZE 4096
 
 class Oscilloscope : public ODriveIntf::OscilloscopeIntf {
 public:
-    Oscilloscope(float* trigger_src, float trigger_threshold, float** data_src)
-        : trigger_src_(trigger_src), trigger_threshold_(trigger_threshold), data_src_(data_src) {}
+    static constexpr size_t kMaxChannels = 8;
 
-    float get_val(uint32_t index) override {
-        return index < OSCILLOSCOPE_SIZE ? data_[index] : NAN;
-    }
+    struct Channel_t {
+        endpoint_ref_t endpoint = {0, 0};
+        float scale = 0.0f; // [unit/LSB] 0 means the channel is stored as float32, otherwise as int16
+    };
+
+    bool arm() override;
+    void trigger() override;
+    float get_val(uint32_t index) override;
+    float get_scale(uint8_t channel) override;
+    uint64_t read_raw();
 
     void update();
 
-    const uint32_t size_ = OSCILLOSCOPE_SIZE;
-    const float* trigger_src_;
-    const float trigger_threshold_;
-    float* const * data_src_;
+    Channel_t channels_[kMaxChannels];
+    endpoint_ref_t trigger_endpoint_ = {0, 0};
+    float trigger_level_ = 0.0f;
+    TriggerEdge trigger_edge_ = TRIGGER_EDGE_RISING;
+    uint32_t decimation_ = 1;
+    float pretrigger_ = 0.0f; // fraction of the capture that lies before the trigger
+
+    CaptureState state_ = CAPTURE_STATE_IDLE;
+    uint32_t size_ = 0;      // [frames] capacity with the channel layout of the last arm() call
+    uint8_t n_channels_ = 0; // number of channels in the current capture
+    uint32_t raw_offset_ = 0; // [bytes] position of the next read_raw() within the capture
+
+private:
+    struct ActiveChannel_t {
+        Introspectable property;
+        const FloatGettableTypeInfo* type_info = nullptr;
+        float scale = 0.0f;
+        float inv_scale = 0.0f;
+        uint16_t offset = 0; // [halfwords] position within the frame
+    };
+
+    static bool resolve(endpoint_ref_t endpoint, ActiveChannel_t* channel);
+    bool check_trigger(float val);
+
+    ActiveChannel_t active_channels_[kMaxChannels];
+    ActiveChannel_t trigger_channel_;
+    bool has_trigger_channel_ = false;
+    TriggerEdge active_trigger_edge_ = TRIGGER_EDGE_RISING;
+    float active_trigger_level_ = 0.0f;
+    uint32_t active_decimation_ = 1;
+    uint32_t pretrigger_frames_ = 0;
+    uint16_t frame_stride_ = 0; // [halfwords]
+
+    uint32_t decimation_counter_ = 0;
+    uint32_t write_idx_ = 0;    // [frames] next frame to be written
+    uint32_t n_written_ = 0;    // [frames] written since arming, saturates at size_
+    uint32_t start_idx_ = 0;    // [frames] oldest frame of the finished capture
+    uint32_t remaining_ = 0;    // [frames] left to capture after the trigger
+    float last_trigger_val_ = NAN;
+    volatile bool trigger_requested_ = false;
 
-    float data_[OSCILLOSCOPE_SIZE] = {0};
-    size_t pos_ = 0;
-    bool ready_ = false;
-    bool capturing_ = false;
+    uint16_t data_[2 * OSCILLOSCOPE_SIZE] = {0};
 };
 
-#endif // __OSCILLOSCOPE_HPP
\ No newline at end of file
+#endif // __OSCILLOSCOPE_HPP
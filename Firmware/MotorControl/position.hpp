@@ -0,0 +1,95 @@
+#ifndef __POSITION_HPP
+#define __POSITION_HPP
+
+#include <stdint.h>
+#include <math.h>
+
+/**
+ * @brief A position as a whole number and a fraction in [0, 1).
+ *
+ * A float position loses resolution far from zero: beyond 2^24 counts it
+ * cannot even resolve single counts. Here the fraction always stays in
+ * [0, 1), so the resolution is the same over the whole range. The difference
+ * of two positions is exact in the whole part and only converted to float at
+ * the end, which is where it's used (errors, outputs).
+ *
+ * The unit is counts in the encoder and turns in the controller.
+ */
+class Position {
+public:
+    Position() = default;
+
+    // Implicit, so that float setpoints and estimates can be assigned
+    Position(float value) {
+        if (fabsf(value) < 9e18f) {
+            whole_ = (int64_t)floorf(value);
+            frac_ = value - (float)whole_;
+            normalize();
+        } else {
+            frac_ = value; // keeps infinity and NaN
+        }
+    }
+
+    static Position from_count(int64_t whole, float frac = 0.0f) {
+        Position pos;
+        pos.whole_ = whole;
+        pos.frac_ = frac;
+        pos.normalize();
+        return pos;
+    }
+
+    int64_t whole() const { return whole_; }
+    float frac() const { return frac_; }
+
+    // Rounds to float precision, only for outputs
+    float to_float() const {
+        return (float)whole_ + frac_;
+    }
+
+    Position& operator+=(float delta) {
+        frac_ += delta;
+        normalize();
+        return *this;
+    }
+
+    Position operator+(float delta) const {
+        Position result = *this;
+        result += delta;
+        return result;
+    }
+
+    friend float operator-(const Position& a, const Position& b) {
+        return (float)(a.whole_ - b.whole_) + (a.frac_ - b.frac_);
+    }
+
+    // Converts to a unit that is divisor times larger, e.g. counts to turns
+    Position divide(int32_t divisor) const {
+        int64_t quotient = whole_ / divisor;
+        int64_t remainder = whole_ % divisor;
+        if (remainder < 0) {
+            quotient--;
+            remainder += divisor;
+        }
+        return from_count(quotient, ((float)remainder + frac_) / (float)divisor);
+    }
+
+private:
+    void normalize() {
+        float carry = floorf(frac_);
+        if (!(fabsf(carry) < 9e18f)) {
+            return;
+        }
+        whole_ += (int64_t)carry;
+        frac_ -= carry;
+        // A tiny negative fraction rounds up to 1
+        if (frac_ >= 1.0f) {
+            whole_++;
+            frac_ = 0.0f;
+        }
+    }
+
+    int64_t whole_ = 0;
+    float frac_ = 0.0f; // in [0, 1)
+};
+
+#endif // __POSITION_HPP
@@ -0,0 +1,104 @@
+#ifndef __RAW_CURSOR_HPP
+#define __RAW_CURSOR_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+
+/**
+ * Helpers for the `raw_data` properties through which larger blocks (captures,
+ * tables, logs) are read out.
+ *
+ * A property is one uint64 per request, so every read returns the next 8
+ * bytes and advances a cursor. The host issues all reads of a block
+ * back-to-back and the ODrive processes them in order, so the USB round trip
+ * is only paid once per batch of requests in flight instead of once per 8
+ * bytes. The cursor is exposed too so that the host can start a block and
+ * check that no request got lost.
+ */
+
+// Returns the 8 bytes at *offset of a block of size bytes and advances
+// *offset by 8. Bytes past the end read as 0.
+inline uint64_t raw_read(const void* data, size_t size, uint32_t* offset) {
+    size_t pos = *offset;
+    *offset += 8;
+
+    uint64_t result = 0;
+    if (pos < size) {
+        memcpy(&result, reinterpret_cast<const uint8_t*>(data) + pos,
+               std::min(sizeof(result), size - pos));
+    }
+    return result;
+}
+
+// Overwrites the 8 bytes at *offset of a block of size bytes and advances
+// *offset by 8. Bytes past the end are dropped.
+inline void raw_write(void* data, size_t size, uint32_t* offset, uint64_t value) {
+    size_t pos = *offset;
+    *offset += 8;
+
+    if (pos < size) {
+        memcpy(reinterpret_cast<uint8_t*>(data) + pos, &value,
+               std::min(sizeof(value), size - pos));
+    }
+}
+
+// Like raw_read() for blocks that are not contiguous in memory. get(i)
+// returns the i-th of n_elements elements of type T.
+template<typename T, typename TFunc>
+uint64_t raw_read_elements(size_t n_elements, uint32_t* offset, TFunc get) {
+    static_assert(8 % sizeof(T) == 0, "elements must not straddle two reads");
+    size_t idx = *offset / sizeof(T);
+    *offset += 8;
+
+    uint64_t result = 0;
+    for (size_t i = 0; i < 8 / sizeof(T) && idx + i < n_elements; ++i) {
+        T element = get(idx + i);
+        memcpy(reinterpret_cast<uint8_t*>(&result) + i * sizeof(T), &element, sizeof(T));
+    }
+    return result;
+}
+
+/**
+ * @brief Reads the records of a TraceRing 8 bytes at a time.
+ *
+ * The record is copied out of the ring when its first part is read so that
+ * all parts are consistent even if the record is overwritten in between.
+ * The index is incremented after the last part. Records that are not
+ * available (not written yet or already overwritten) read as all-zero.
+ */
+template<typename TRing>
+class RawRingReader {
+public:
+    using Record = typename TRing::Record;
+    static_assert(sizeof(Record) % 8 == 0, "records are read in units of 8 bytes");
+
+    uint64_t read(const TRing& ring, uint32_t* idx) {
+        if (part_ == 0 || buf_idx_ != *idx) {
+            if (!ring.read(*idx, &buf_)) {
+                buf_ = {};
+            }
+            buf_idx_ = *idx;
+            part_ = 0;
+        }
+
+        uint64_t result;
+        memcpy(&result, reinterpret_cast<const uint8_t*>(&buf_) + part_ * sizeof(result), sizeof(result));
+
+        if (++part_ == kParts) {
+            part_ = 0;
+            (*idx)++;
+        }
+        return result;
+    }
+
+private:
+    static constexpr size_t kParts = sizeof(Record) / sizeof(uint64_t);
+
+    Record buf_ = {};
+    uint32_t buf_idx_ = 0;
+    size_t part_ = 0; // next 8-byte part of buf_ to be returned
+};
+
+#endif // __RAW_CURSOR_HPP
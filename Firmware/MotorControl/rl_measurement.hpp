@@ -0,0 +1,81 @@
+#ifndef __RL_MEASUREMENT_HPP
+#define __RL_MEASUREMENT_HPP
+
+#include <stdint.h>
+#include <math.h>
+#include "running_stats.hpp"
+
+/**
+ * @brief Measurement law of the phase resistance.
+ *
+ * An integrator adjusts the test voltage until the target current flows. Once
+ * the current is reasonably close to the target, every sample yields an
+ * independent estimate of the resistance, regardless of how far the
+ * integrator has converged. These estimates are collected in stats_.
+ */
+struct ResistanceMeasurement {
+    void reset() {
+        test_voltage_ = 0.0f;
+        stats_.reset();
+    }
+
+    // Updates the test voltage with a current measurement that was taken one
+    // period after the previous one.
+    void update(float actual_current, float target_current, float period) {
+        if (actual_current * target_current > 0.25f * target_current * target_current) {
+            stats_.push(test_voltage_ / actual_current);
+        }
+        test_voltage_ += (kI * period) * (target_current - actual_current);
+    }
+
+    // Result of the integrator, only valid once it has settled
+    float get_resistance(float target_current) const {
+        return test_voltage_ / target_current;
+    }
+
+    static constexpr float kI = 1.0f; // [(V/s)/A]
+    float test_voltage_ = 0.0f; // [V]
+    RunningStats stats_; // resistance estimates [Ohm]
+};
+
+/**
+ * @brief Measurement law of the phase inductance.
+ *
+ * The test voltage toggles between positive and negative every period. The
+ * current ripple it causes is proportional to the voltage over the inductance.
+ * The ripple of every period is collected in stats_.
+ */
+struct InductanceMeasurement {
+    void reset() {
+        has_last_current_ = false;
+        deltaI_ = 0.0f;
+        stats_.reset();
+    }
+
+    // Records a current measurement. test_voltage is the voltage that was
+    // applied since the previous measurement.
+    void update(float current, float test_voltage) {
+        if (has_last_current_) {
+            float sign = test_voltage >= 0.0f ? 1.0f : -1.0f;
+            float ripple = sign * (current - last_current_);
+            deltaI_ += ripple;
+            stats_.push(ripple);
+        }
+        last_current_ = current;
+        has_last_current_ = true;
+    }
+
+    // dt is the time between the first and the last measurement
+    float get_inductance(float test_voltage, float dt) const {
+        // Note: A more correct formula would also take into account that there is a finite timestep.
+        // However, the discretisation in the current control loop inverts the same discrepancy
+        return fabsf(test_voltage) / (deltaI_ / dt);
+    }
+
+    bool has_last_current_ = false;
+    float last_current_ = 0.0f; // [A]
+    float deltaI_ = 0.0f; // [A] sum of the ripple
+    RunningStats stats_; // current ripple per sample [A]
+};
+
+#endif // __RL_MEASUREMENT_HPP
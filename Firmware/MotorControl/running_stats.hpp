@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * @brief Online mean and variance estimator (Welford's algorithm).
+ *
+ * Used by the calibration routines to decide when a measurement has converged
+ * well enough so that it can be terminated early.
+ */
+class RunningStats {
+   public:
+    void reset() {
+        n_ = 0;
+        mean_ = 0.0f;
+        m2_ = 0.0f;
+    }
+
+    void push(float x) {
+        n_++;
+        float delta = x - mean_;
+        mean_ += delta / (float)n_;
+        m2_ += delta * (x - mean_);
+    }
+
+    uint32_t count() const {
+        return n_;
+    }
+
+    float mean() const {
+        return mean_;
+    }
+
+    // Unbiased sample variance
+    float variance() const {
+        return (n_ > 1) ? m2_ / (float)(n_ - 1) : INFINITY;
+    }
+
+    // Half width of the 95% confidence interval of the mean
+    float confidence_interval() const {
+        return 1.96f * std::sqrt(variance() / (float)n_);
+    }
+
+    // Returns true if at least min_count samples were collected and the
+    // confidence interval of the mean is narrower than rel_tolerance * |mean|.
+    bool is_converged(float rel_tolerance, uint32_t min_count) const {
+        return (n_ >= min_count) && (n_ > 1)
+            && (confidence_interval() < rel_tolerance * std::abs(mean_));
+    }
+
+   private:
+    uint32_t n_ = 0;
+    float mean_ = 0.0f;
+    float m2_ = 0.0f;  // Sum of squared deviations from the mean
+};
+
+/**
+ * @brief Online least squares fit of a straight line y = slope * x + intercept.
+ *
+ * Only the means and the sums of squared deviations from them are stored, so
+ * this can be fed at the control loop rate without a sample buffer. They are
+ * updated like in RunningStats, which stays accurate in single precision even
+ * over long calibration runs.
+ */
+class RunningLinearFit {
+   public:
+    void reset() {
+        n_ = 0;
+        mean_x_ = mean_y_ = 0.0f;
+        cxx_ = cxy_ = cyy_ = 0.0f;
+    }
+
+    void push(float x, float y) {
+        n_++;
+        float dx = x - mean_x_;
+        float dy = y - mean_y_;
+        mean_x_ += dx / (float)n_;
+        mean_y_ += dy / (float)n_;
+        cxx_ += dx * (x - mean_x_);
+        cxy_ += dx * (y - mean_y_);
+        cyy_ += dy * (y - mean_y_);
+    }
+
+    uint32_t count() const {
+        return n_;
+    }
+
+    float slope() const {
+        return (cxx_ > 0.0f) ? cxy_ / cxx_ : 0.0f;
+    }
+
+    float intercept() const {
+        return mean_y_ - slope() * mean_x_;
+    }
+
+    // Root mean square of the residuals
+    float residual_rms() const {
+        return (n_ > 0) ? std::sqrt(sse() / (float)n_) : INFINITY;
+    }
+
+    // Standard error of the slope estimate
+    float slope_stderr() const {
+        if (n_ < 3 || !(cxx_ > 0.0f)) {
+            return INFINITY;
+        }
+        return std::sqrt(sse() / (float)(n_ - 2) / cxx_);
+    }
+
+    // Returns true if at least min_count samples were collected and their
+    // residuals from the line have an RMS of at most max_residual_rms.
+    bool fits_within(float max_residual_rms, uint32_t min_count) const {
+        return (n_ >= min_count) && (n_ > 2) && (residual_rms() <= max_residual_rms);
+    }
+
+   private:
+    // Sum of squared residuals
+    float sse() const {
+        return std::max(cyy_ - slope() * cxy_, 0.0f);
+    }
+
+    uint32_t n_ = 0;
+    float mean_x_ = 0.0f;
+    float mean_y_ = 0.0f;
+    float cxx_ = 0.0f; // Sum of squared deviations of x from its mean
+    float cxy_ = 0.0f; // Sum of products of the deviations of x and y
+    float cyy_ = 0.0f; // Sum of squared deviations of y from its mean
+};
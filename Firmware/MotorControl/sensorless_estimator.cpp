@@ -10,6 +10,13 @@ void SensorlessEstimator::reset() {
     flux_state_[1] = 0.0f;
 }
 
+void SensorlessEstimator::set_error(Error error) {
+    if (error & ~error_) {
+        odrv.journal_.log(Journal::JOURNAL_ENTRY_TYPE_SENSORLESS_ESTIMATOR_ERROR, axis_->axis_num_, error, axis_->current_state_);
+    }
+    error_ |= error;
+}
+
 bool SensorlessEstimator::update() {
     // Algorithm based on paper: Sensorless Control of Surface-Mount Permanent-Magnet Synchronous Motors Based on a Nonlinear Observer
     // http://cas.ensmp.fr/~praly/Telechargement/Journaux/2010-IEEE_TPEL-Lee-Hong-Nam-Ortega-Praly-Astolfi.pdf
@@ -28,7 +35,7 @@ bool SensorlessEstimator::update() {
 
     // Check that we don't get problems with discrete time approximation
     if (!(current_meas_period * pll_kp < 1.0f)) {
-        error_ |= ERROR_UNSTABLE_GAIN;
+        set_error(ERROR_UNSTABLE_GAIN);
         reset(); // Reset state for when the next valid current measurement comes in.
         return false;
     }
@@ -42,7 +49,7 @@ bool SensorlessEstimator::update() {
         current_meas = {0.0f, 0.0f};
     }
     if (!current_meas.has_value()) {
-        error_ |= ERROR_UNKNOWN_CURRENT_MEASUREMENT;
+        set_error(ERROR_UNKNOWN_CURRENT_MEASUREMENT);
         reset(); // Reset state for when the next valid current measurement comes in.
         return false;
     }
@@ -12,6 +12,7 @@ public:
     };
 
     void reset();
+    void set_error(Error error);
     bool update();
 
     Axis* axis_ = nullptr; // set by Axis constructor
@@ -0,0 +1,96 @@
+#ifndef __SINCOS_CALIBRATOR_HPP
+#define __SINCOS_CALIBRATOR_HPP
+
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief Online correction of the offsets, amplitudes and quadrature error of
+ * a sin/cos encoder.
+ *
+ * The signals are modeled as
+ *   sin = offset_s + amplitude_s * sin(phase)
+ *   cos = offset_c + amplitude_c * cos(phase + quadrature)
+ * Each sample is corrected with the current parameters before the atan2, and
+ * the parameters are then moved along the gradient of the squared model error
+ * at the corrected phase (LMS). The step size is proportional to the phase
+ * advanced since the last sample, so the parameters converge over a number of
+ * signal periods regardless of the speed, and don't drift at standstill.
+ *
+ * The uncorrected signals have a cyclic phase error of up to about
+ * offset/amplitude rad at the fundamental, (amplitude ratio - 1)/2 and
+ * quadrature/2 rad at the second harmonic.
+ *
+ * TTrig provides atan2(), sin() and cos(). The firmware substitutes its fast
+ * approximations for the libm functions, see Encoder.
+ */
+template<typename TTrig>
+class BasicSinCosCalibrator {
+public:
+    // Starts over from the raw signals, with the amplitude of the given sample
+    void reset(float s, float c) {
+        offset_s_ = 0.0f;
+        offset_c_ = 0.0f;
+        amplitude_s_ = amplitude_c_ = std::max(sqrtf(s * s + c * c), 1e-3f);
+        quadrature_ = 0.0f;
+        last_phase_ = TTrig::atan2(s, c);
+    }
+
+    /**
+     * @brief Returns the corrected phase [rad] in [-pi, pi] of a sample.
+     *
+     * @param rate: Fraction of the model error that is corrected per signal
+     *        period. 0 applies the correction without adapting it.
+     */
+    float update(float s, float c, float rate) {
+        // Correct and compute the phase
+        float sn = (s - offset_s_) / amplitude_s_;
+        float cn = (c - offset_c_) / amplitude_c_;
+        float sin_q = TTrig::sin(quadrature_), cos_q = TTrig::cos(quadrature_);
+        float phase = TTrig::atan2(sn, (cn + sn * sin_q) / cos_q);
+
+        // LMS step weighted by the phase advance
+        float advance = fabsf(phase - last_phase_);
+        advance = std::min(advance, 2.0f * (float)M_PI - advance);
+        last_phase_ = phase;
+        float mu = rate * std::min(advance, (float)M_PI / 4.0f) / (2.0f * (float)M_PI);
+        if (mu > 0.0f) {
+            float sin_p = TTrig::sin(phase);
+            float cos_pq = TTrig::cos(phase + quadrature_), sin_pq = TTrig::sin(phase + quadrature_);
+            float err_s = s - (offset_s_ + amplitude_s_ * sin_p);
+            float err_c = c - (offset_c_ + amplitude_c_ * cos_pq);
+            // The factor 2 makes rate the fraction per period for the
+            // amplitudes, whose regressors have a mean square of 1/2
+            offset_s_ += mu * err_s;
+            offset_c_ += mu * err_c;
+            amplitude_s_ = std::max(amplitude_s_ + 2.0f * mu * err_s * sin_p, 1e-3f);
+            amplitude_c_ = std::max(amplitude_c_ + 2.0f * mu * err_c * cos_pq, 1e-3f);
+            quadrature_ = std::clamp(quadrature_ - 2.0f * mu * err_c * sin_pq / amplitude_c_, -0.5f, 0.5f);
+        }
+        return phase;
+    }
+
+    float offset_s() const { return offset_s_; }
+    float offset_c() const { return offset_c_; }
+    float amplitude_s() const { return amplitude_s_; }
+    float amplitude_c() const { return amplitude_c_; }
+    float quadrature() const { return quadrature_; }
+
+private:
+    float offset_s_ = 0.0f;
+    float offset_c_ = 0.0f;
+    float amplitude_s_ = 1.0f;
+    float amplitude_c_ = 1.0f;
+    float quadrature_ = 0.0f; // [rad] phase error of the cos channel
+    float last_phase_ = 0.0f; // [rad]
+};
+
+struct LibmTrig {
+    static float atan2(float y, float x) { return atan2f(y, x); }
+    static float sin(float x) { return sinf(x); }
+    static float cos(float x) { return cosf(x); }
+};
+
+using SinCosCalibrator = BasicSinCosCalibrator<LibmTrig>;
+
+#endif // __SINCOS_CALIBRATOR_HPP
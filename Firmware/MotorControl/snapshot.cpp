@@ -0,0 +1,93 @@
+#include "snapshot.hpp"
+#include "raw_cursor.hpp"
+
+#include <board.h>
+#include <algorithm>
+#include <atomic>
+
+/**
+ * @brief Applies the current signal and decimation settings.
+ *
+ * Like Oscilloscope::arm(), the endpoints are resolved here and the new
+ * layout is swapped in within a critical section, so the control loop only
+ * follows resolved pointers. Signals with an invalid endpoint are skipped.
+ * Returns the number of valid signals.
+ */
+uint8_t Snapshot::apply() {
+    ActiveSignal_t signals[kMaxSignals];
+    uint8_t n_signals = 0;
+
+    for (size_t i = 0; i < kMaxSignals; ++i) {
+        ActiveSignal_t& signal = signals[n_signals];
+        if (!fibre::resolve_endpoint_ref(signals_[i], &signal.property)) {
+            continue;
+        }
+        signal.type_info = dynamic_cast<const FloatGettableTypeInfo*>(signal.property.get_type_info());
+        if (signal.type_info) {
+            n_signals++;
+        }
+    }
+
+    CRITICAL_SECTION() {
+        std::copy(signals, signals + n_signals, active_signals_);
+        n_active_signals_ = n_signals;
+        active_decimation_ = std::max(decimation_, (uint32_t)1);
+        decimation_counter_ = active_decimation_ - 1; // update on the next iteration
+        n_signals_ = n_signals;
+        size_ = n_signals ? (offsetof(Frame_t, values) + n_signals * sizeof(float) + 7) & ~7 : 0;
+        read_offset_ = 0;
+    }
+
+    return n_signals;
+}
+
+void Snapshot::update(uint32_t timestamp) {
+    if (!n_active_signals_ || ++decimation_counter_ < active_decimation_) {
+        return;
+    }
+    decimation_counter_ = 0;
+
+    uint32_t seq = seq_ + 1;
+    Frame_t& frame = buffers_[seq & 1];
+    frame.seq = seq;
+    frame.timestamp = timestamp;
+    for (size_t i = 0; i < n_active_signals_; ++i) {
+        const ActiveSignal_t& signal = active_signals_[i];
+        frame.values[i] = NAN;
+        signal.type_info->get_float(signal.property, &frame.values[i]);
+    }
+
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    seq_ = seq;
+}
+
+// Copies the latest frame to read_buf_. This runs in a thread which the
+// control loop can interrupt but not the other way around.
+void Snapshot::latch() {
+    uint32_t seq;
+    do {
+        seq = seq_;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        read_buf_ = buffers_[seq & 1];
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    } while (seq_ - seq >= 2);
+}
+
+/**
+ * @brief Returns the next 8 bytes of the latched frame and advances
+ * read_offset_.
+ *
+ * A new frame is latched when reading at offset 0. read_offset_ wraps around
+ * to 0 after the last 8 bytes of a frame, so reading size_ / 8 times in a row
+ * (which the host can pipeline) yields one coherent frame.
+ */
+uint64_t Snapshot::read_raw() {
+    if (read_offset_ == 0) {
+        latch();
+    }
+    uint64_t result = raw_read(&read_buf_, sizeof(read_buf_), &read_offset_);
+    if (read_offset_ >= size_) {
+        read_offset_ = 0;
+    }
+    return result;
+}
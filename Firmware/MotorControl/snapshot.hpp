@@ -0,0 +1,56 @@
+#ifndef __SNAPSHOT_HPP
+#define __SNAPSHOT_HPP
+
+#include <autogen/interfaces.hpp>
+#include <fibre/introspection.hpp>
+
+/**
+ * @brief Latches a set of signals in one control loop iteration so that the
+ * host can read them as a coherent set.
+ *
+ * The control loop writes every decimation-th iteration into the back one of
+ * two buffers and then publishes it by incrementing seq_. The reader copies
+ * the front buffer and retries if the control loop published twice during the
+ * copy, in which case it might have overwritten the buffer being copied.
+ */
+class Snapshot : public ODriveIntf::SnapshotIntf {
+public:
+    static constexpr size_t kMaxSignals = 12;
+
+    struct Frame_t {
+        uint32_t seq;
+        uint32_t timestamp; // [clocks] control loop timestamp
+        float values[kMaxSignals];
+    };
+
+    uint8_t apply() override;
+    void update(uint32_t timestamp);
+    uint32_t get_seq() { return seq_; }
+    uint64_t read_raw();
+
+    endpoint_ref_t signals_[kMaxSignals] = {};
+    uint32_t decimation_ = 1;
+
+    uint8_t n_signals_ = 0; // number of signals in the current layout
+    uint32_t size_ = 0;     // [bytes] size of a frame with the current layout, multiple of 8
+    uint32_t read_offset_ = 0; // [bytes] position of the next read_raw() within the latched frame
+
+private:
+    struct ActiveSignal_t {
+        Introspectable property;
+        const FloatGettableTypeInfo* type_info = nullptr;
+    };
+
+    void latch();
+
+    ActiveSignal_t active_signals_[kMaxSignals];
+    uint8_t n_active_signals_ = 0;
+    uint32_t active_decimation_ = 1;
+    uint32_t decimation_counter_ = 0;
+
+    Frame_t buffers_[2] = {};
+    volatile uint32_t seq_ = 0; // buffers_[seq_ & 1] holds the latest frame
+    Frame_t read_buf_ = {};
+};
+
+#endif // __SNAPSHOT_HPP
@@ -0,0 +1,26 @@
+
+#include "task_timer.hpp"
+
+bool TaskTimer::enabled = false;
+
+#ifdef MEASURE_HISTOGRAM
+static TaskTimerHistogram histogram_pool[TASK_TIMER_HISTOGRAM_POOL_SIZE];
+static TaskTimer* histogram_owners[TASK_TIMER_HISTOGRAM_POOL_SIZE] = {nullptr};
+#endif
+
+void TaskTimer::set_histogram_enabled(bool value) {
+#ifdef MEASURE_HISTOGRAM
+    CRITICAL_SECTION() {
+        for (size_t i = 0; i < TASK_TIMER_HISTOGRAM_POOL_SIZE; ++i) {
+            if (value && !histogram_ && !histogram_owners[i]) {
+                histogram_pool[i].reset();
+                histogram_owners[i] = this;
+                histogram_ = &histogram_pool[i];
+            } else if (!value && histogram_owners[i] == this) {
+                histogram_owners[i] = nullptr;
+                histogram_ = nullptr;
+            }
+        }
+    }
+#endif
+}
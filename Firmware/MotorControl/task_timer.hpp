@@ -3,33 +3,95 @@
 
 #include <stdint.h>
 #include <board.h>
+#include "log_histogram.hpp"
 
 #define MEASURE_START_TIME
 #define MEASURE_END_TIME
 #define MEASURE_LENGTH
 #define MEASURE_MAX_LENGTH
+#define MEASURE_HISTOGRAM
 
 inline uint16_t sample_TIM13() {
     constexpr uint16_t clocks_per_cnt = (uint16_t)((float)TIM_1_8_CLOCK_HZ / (float)TIM_APB1_CLOCK_HZ);
     return clocks_per_cnt * TIM13->CNT;  // TODO: Use a hw_config
 }
 
+#ifdef MEASURE_HISTOGRAM
+// 4 buckets per octave from 32 to 65536 clocks (0.2us to 390us)
+using TaskTimerHistogram = LogHistogram<5, 16>;
+
+// Histograms take 184 bytes each, so instead of embedding one in every timer
+// they are handed out from a small pool to the timers that enable them.
+#define TASK_TIMER_HISTOGRAM_POOL_SIZE 4
+#endif
+
 struct TaskTimer {
     uint32_t start_time_ = 0;
     uint32_t end_time_ = 0;
     uint32_t length_ = 0;
     uint32_t max_length_ = 0;
+    uint32_t count_ = 0;
+    uint32_t overruns_ = 0; // only tracked by tasks that have a deadline
+
+#ifdef MEASURE_HISTOGRAM
+    TaskTimerHistogram* histogram_ = nullptr; // taken from the pool while enabled
+#endif
 
     static bool enabled;
 
+    bool get_histogram_enabled() {
+#ifdef MEASURE_HISTOGRAM
+        return histogram_;
+#else
+        return false;
+#endif
+    }
+
+    // Does nothing if all histograms of the pool are in use
+    void set_histogram_enabled(bool value);
+
+    uint32_t percentile(float q) {
+#ifdef MEASURE_HISTOGRAM
+        TaskTimerHistogram* histogram = histogram_;
+        return histogram ? histogram->quantile(q, max_length_) : 0;
+#else
+        return 0;
+#endif
+    }
+
+    void reset() {
+        CRITICAL_SECTION() {
+            max_length_ = 0;
+            count_ = 0;
+            overruns_ = 0;
+#ifdef MEASURE_HISTOGRAM
+            if (histogram_) {
+                histogram_->reset();
+            }
+#endif
+        }
+    }
+
     uint32_t start() {
         return sample_TIM13();
     }
 
     void stop(uint32_t start_time) {
         uint32_t end_time = sample_TIM13();
-        uint32_t length = end_time - start_time;
+        record(start_time, end_time, end_time - start_time);
+    }
 
+    // Like stop() for spans that may end in the control period after the one
+    // in which they started, such as the latency from a sample to its use.
+    void stop_across_period(uint32_t start_time) {
+        uint32_t end_time = sample_TIM13();
+        uint32_t length = end_time >= start_time
+                ? end_time - start_time
+                : end_time + CONTROL_TIMER_PERIOD_TICKS - start_time;
+        record(start_time, end_time, length);
+    }
+
+    void record(uint32_t start_time, uint32_t end_time, uint32_t length) {
         if (enabled) {
 #ifdef MEASURE_START_TIME
             start_time_ = start_time;
@@ -44,6 +106,12 @@ struct TaskTimer {
 #ifdef MEASURE_MAX_LENGTH
         max_length_ = std::max(max_length_, length);
 #endif
+#ifdef MEASURE_HISTOGRAM
+        if (histogram_) {
+            histogram_->push(length);
+        }
+#endif
+        count_++;
     }
 };
 
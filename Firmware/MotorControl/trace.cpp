@@ -0,0 +1,13 @@
+
+#include "trace.hpp"
+
+Trace trace;
+
+/**
+ * @brief Returns the next half (8 bytes) of the record read_idx_ and
+ * increments read_idx_ after the second half. Records that are not available
+ * read as TRACE_EVENT_NONE, see RawRingReader.
+ */
+uint64_t Trace::read_raw() {
+    return reader_.read(ring_, &read_idx_);
+}
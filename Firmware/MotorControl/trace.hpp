@@ -0,0 +1,80 @@
+#ifndef __TRACE_HPP
+#define __TRACE_HPP
+
+#include <autogen/interfaces.hpp>
+#include <board.h>
+#include "trace_ring.hpp"
+#include "raw_cursor.hpp"
+
+// Number of trace records (16 bytes each). Must be a power of two.
+#define TRACE_SIZE 512
+
+#define TRACE_CATEGORY_CONTROL  (1 << 0) // sampling, control loop and PWM update
+#define TRACE_CATEGORY_COMMS    (1 << 1) // USB, UART and CAN traffic
+
+// Trace points of categories that are not in this mask are removed at compile
+// time. Can be overridden with CONFIG_TRACE in tup.config.
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES (TRACE_CATEGORY_CONTROL | TRACE_CATEGORY_COMMS)
+#endif
+
+class Trace : public ODriveIntf::TraceIntf {
+public:
+    void emit(TraceEvent event, uint32_t arg0, uint32_t arg1) {
+        if (enabled_) {
+            TraceRecord record;
+            record.timestamp = DWT->CYCCNT;
+            record.event = event;
+            record.arg0 = arg0;
+            record.arg1 = arg1;
+            ring_.push(record);
+        }
+    }
+
+    uint32_t get_write_idx() { return ring_.write_idx(); }
+    uint64_t read_raw();
+
+    bool enabled_ = true;
+    uint32_t read_idx_ = 0; // sequence number of the record returned by the next read_raw()
+    const uint32_t size_ = TRACE_SIZE;
+
+private:
+    using Ring = TraceRing<TRACE_SIZE>;
+    Ring ring_;
+    RawRingReader<Ring> reader_;
+};
+
+extern Trace trace;
+
+static constexpr uint32_t trace_category(ODriveIntf::TraceIntf::TraceEvent event) {
+    switch (event) {
+        case ODriveIntf::TraceIntf::TRACE_EVENT_SAMPLING_BEGIN:
+        case ODriveIntf::TraceIntf::TRACE_EVENT_SAMPLING_END:
+        case ODriveIntf::TraceIntf::TRACE_EVENT_CONTROL_LOOP_BEGIN:
+        case ODriveIntf::TraceIntf::TRACE_EVENT_CONTROL_LOOP_END:
+        case ODriveIntf::TraceIntf::TRACE_EVENT_PWM_UPDATE_BEGIN:
+        case ODriveIntf::TraceIntf::TRACE_EVENT_PWM_UPDATE_END:
+            return TRACE_CATEGORY_CONTROL;
+        case ODriveIntf::TraceIntf::TRACE_EVENT_USB_RX:
+        case ODriveIntf::TraceIntf::TRACE_EVENT_USB_TX:
+        case ODriveIntf::TraceIntf::TRACE_EVENT_UART_RX:
+        case ODriveIntf::TraceIntf::TRACE_EVENT_UART_TX:
+        case ODriveIntf::TraceIntf::TRACE_EVENT_CAN_RX:
+        case ODriveIntf::TraceIntf::TRACE_EVENT_CAN_TX:
+            return TRACE_CATEGORY_COMMS;
+        default:
+            return 0;
+    }
+}
+
+template<ODriveIntf::TraceIntf::TraceEvent kEvent>
+inline void trace_event(uint32_t arg0 = 0, uint32_t arg1 = 0) {
+    if constexpr ((TRACE_CATEGORIES & trace_category(kEvent)) != 0) {
+        trace.emit(kEvent, arg0, arg1);
+    }
+}
+
+// Usage: TRACE(CONTROL_LOOP_BEGIN, arg0, arg1). The arguments are optional.
+#define TRACE(event, ...) trace_event<ODriveIntf::TraceIntf::TRACE_EVENT_##event>(__VA_ARGS__)
+
+#endif // __TRACE_HPP
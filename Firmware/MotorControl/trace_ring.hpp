@@ -0,0 +1,86 @@
+#ifndef __TRACE_RING_HPP
+#define __TRACE_RING_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Record of the trace, see Trace::emit()
+struct TraceRecord {
+    uint32_t timestamp; // [clocks]
+    uint16_t event;     // 0 means invalid
+    uint16_t seq;       // lower 16 bits of the sequence number
+    uint32_t arg0;
+    uint32_t arg1;
+};
+static_assert(sizeof(TraceRecord) == 16, "unexpected padding");
+
+/**
+ * @brief Lock-free ring buffer of fixed-size binary records.
+ *
+ * TRecord must be trivially copyable and have a `uint16_t seq` member.
+ *
+ * push() can be called from any thread or interrupt at the same time. A slot
+ * is claimed with a single atomic increment of the write index so that
+ * writers never block each other. A record carries the lower 16 bits of its
+ * sequence number, which is invalidated while the record is being written.
+ * This allows the reader to detect records which are still incomplete or
+ * which were overwritten while it copied them.
+ *
+ * This relies on a single core, on which a writer that interrupts another
+ * writer (or the reader) runs to completion before the interrupted code
+ * continues. Therefore only compiler barriers are needed.
+ */
+template<size_t kSize, typename TRecord = TraceRecord>
+class TraceRing {
+public:
+    static_assert((kSize & (kSize - 1)) == 0, "size must be a power of two");
+    static_assert(kSize <= 0x8000, "size must fit into the 16-bit sequence number");
+
+    using Record = TRecord;
+
+    static constexpr size_t size() { return kSize; }
+
+    // The seq member of the record is ignored.
+    void push(Record record) {
+        uint32_t idx = write_idx_.fetch_add(1, std::memory_order_relaxed);
+        Record& slot = records_[idx & (kSize - 1)];
+
+        record.seq = (uint16_t)~idx; // never matches any idx of this slot
+        slot.seq = record.seq;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        slot = record;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        slot.seq = (uint16_t)idx;
+    }
+
+    // Total number of records that were pushed (wraps around)
+    uint32_t write_idx() const {
+        return write_idx_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Copies the record with the specified sequence number.
+     * Returns false if it was not written yet, is being written or was
+     * already overwritten.
+     */
+    bool read(uint32_t idx, Record* record) const {
+        const Record& src = records_[idx & (kSize - 1)];
+
+        uint16_t seq = src.seq;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        *record = src;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+
+        // The write index is read last. If a writer claimed this slot for a
+        // newer record during the copy, this will show it.
+        uint32_t age = write_idx() - idx;
+        return (seq == (uint16_t)idx) && (src.seq == seq) && (age >= 1) && (age <= kSize);
+    }
+
+private:
+    std::atomic<uint32_t> write_idx_ = {0};
+    Record records_[kSize] = {};
+};
+
+#endif // __TRACE_RING_HPP
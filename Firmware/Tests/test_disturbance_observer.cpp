@@ -0,0 +1,119 @@
+#include <doctest.h>
+#include <cmath>
+#include <random>
+
+#include "MotorControl/disturbance_observer.hpp"
+#include "MotorControl/mechanical_identifier.hpp"
+
+TEST_SUITE("disturbance_observer") {
+
+static constexpr float current_meas_hz = 8000.0f;
+static constexpr float current_meas_period = 1.0f / current_meas_hz;
+
+/**
+ * @brief Velocity loop of Controller::update() holding 1 turn/s against a
+ * load torque step at t_load, with the gains of the autotune state for a
+ * bandwidth of 100 rad/s.
+ */
+struct LoadStep {
+    static constexpr double kInertia = 1e-3;          // [Nm/(turn/s^2)]
+    static constexpr double kViscousFriction = 2e-3;  // [Nm/(turn/s)]
+    static constexpr double kLoadTorque = 0.1;        // [Nm]
+    static constexpr float t_load = 0.2f;             // [s]
+    static constexpr float vel_setpoint = 1.0f;       // [turn/s]
+
+    LoadStep() {
+        MechanicalIdentifier::Result_t plant = {(float)kInertia, (float)kViscousFriction, 0.0f};
+        MechanicalIdentifier::compute_gains(plant, 100.0f, 60.0f, &vel_gain_, &vel_integrator_gain_);
+        observer_.reset();
+    }
+
+    // dob_inertia = 0 disables the observer
+    void run(float t_end, float dob_inertia, float dob_bandwidth) {
+        std::mt19937 rng(1);
+        std::normal_distribution<float> noise(0.0f, 0.005f);
+        double v = vel_setpoint;
+        float integrator = kViscousFriction * vel_setpoint;
+        float torque = integrator;
+        max_error_ = 0.0f;
+        double sum_sq = 0.0;
+        size_t n = 0;
+
+        for (size_t i = 0; i < t_end * current_meas_hz; ++i) {
+            float t = i * current_meas_period;
+            double load = t >= t_load ? kLoadTorque : 0.0;
+
+            // Substeps resolve the friction, the torque of the previous
+            // iteration was applied until now
+            for (size_t j = 0; j < 8; ++j) {
+                v += current_meas_period / 8 / kInertia * (torque - load - kViscousFriction * v);
+            }
+            float vel_estimate = (float)v + noise(rng);
+
+            float disturbance = 0.0f;
+            if (dob_inertia > 0.0f) {
+                disturbance = observer_.update(torque, vel_estimate, dob_inertia,
+                        (float)kViscousFriction, dob_bandwidth, current_meas_period);
+            }
+
+            float v_err = vel_setpoint - vel_estimate;
+            torque = vel_gain_ * v_err + integrator + disturbance;
+            integrator += vel_integrator_gain_ * current_meas_period * v_err;
+
+            if (t >= t_load) {
+                float error = vel_setpoint - (float)v;
+                max_error_ = std::max(max_error_, std::abs(error));
+                sum_sq += error * error;
+                n++;
+            }
+        }
+        rms_error_ = (float)sqrt(sum_sq / n);
+    }
+
+    float vel_gain_;
+    float vel_integrator_gain_;
+    DisturbanceObserver observer_;
+    float max_error_ = 0.0f; // [turn/s] after the load step
+    float rms_error_ = 0.0f; // [turn/s] after the load step
+};
+
+TEST_CASE("estimate") {
+    LoadStep sim;
+    sim.run(0.5f, (float)LoadStep::kInertia, 200.0f);
+    CHECK(sim.observer_.torque() == doctest::Approx(LoadStep::kLoadTorque).epsilon(0.05));
+}
+
+TEST_CASE("load_step") {
+    LoadStep plain;
+    plain.run(0.5f, 0.0f, 0.0f);
+
+    for (float bandwidth : {100.0f, 200.0f, 400.0f}) {
+        LoadStep dob;
+        dob.run(0.5f, (float)LoadStep::kInertia, bandwidth);
+        MESSAGE("bandwidth " << bandwidth << ": max velocity error " << dob.max_error_
+                << " turn/s, without observer " << plain.max_error_ << " turn/s");
+        CHECK(dob.max_error_ < 0.6f * plain.max_error_);
+        CHECK(dob.rms_error_ < 0.6f * plain.rms_error_);
+    }
+
+    // Faster Q-filters are stiffer
+    LoadStep slow, fast;
+    slow.run(0.5f, (float)LoadStep::kInertia, 100.0f);
+    fast.run(0.5f, (float)LoadStep::kInertia, 400.0f);
+    CHECK(fast.max_error_ < slow.max_error_);
+}
+
+TEST_CASE("inertia_mismatch") {
+    // A nominal inertia that is off by 2x in either direction must not
+    // destabilize the loop
+    LoadStep plain;
+    plain.run(0.5f, 0.0f, 0.0f);
+    for (float ratio : {0.5f, 2.0f}) {
+        LoadStep dob;
+        dob.run(0.5f, ratio * (float)LoadStep::kInertia, 200.0f);
+        CHECK(dob.rms_error_ < plain.rms_error_);
+        CHECK(dob.observer_.torque() == doctest::Approx(LoadStep::kLoadTorque).epsilon(0.1));
+    }
+}
+
+}
@@ -0,0 +1,95 @@
+#include <doctest.h>
+#include <cmath>
+#include <random>
+
+#include "MotorControl/eccentricity_lut.hpp"
+
+TEST_SUITE("eccentricity_lut") {
+
+static constexpr float current_meas_hz = 8000.0f;
+static constexpr float current_meas_period = 1.0f / current_meas_hz;
+static constexpr int32_t cpr = 16384; // 14 bit absolute encoder
+
+// Once and twice per turn error of a mounted encoder [count]
+static double encoder_error(double pos) {
+    double theta = 2.0 * M_PI * pos / cpr;
+    return 6.0 * sin(theta + 0.3) + 1.5 * sin(2.0 * theta - 1.0);
+}
+
+static int32_t raw_at(double pos) {
+    double measured = pos + encoder_error(pos);
+    int32_t count = (int32_t)std::floor(measured);
+    return ((count % cpr) + cpr) % cpr;
+}
+
+// Spins at vel [turn/s] with a small speed ripple and 1% lost reads
+static bool calibrate(double vel, float duration, EccentricityLut* lut, float* residual_rms = nullptr) {
+    std::mt19937 rng(1);
+    std::bernoulli_distribution lost(0.01);
+    EccentricityCalibrator calibrator;
+    calibrator.start(cpr, current_meas_period);
+    for (size_t i = 0; i < duration * current_meas_hz; ++i) {
+        double t = i * (double)current_meas_period;
+        double pos = 1000.0 + vel * cpr * t + 2.0 * sin(2.0 * M_PI * 13.0 * t);
+        calibrator.push(lost(rng) ? std::nullopt : std::make_optional(raw_at(pos)));
+    }
+    if (residual_rms) {
+        *residual_rms = calibrator.residual_rms();
+    }
+    return calibrator.finish(2.0f, lut);
+}
+
+// RMS error [count] over one turn of the compensated position, relative to
+// its mean
+static float compensated_rms(const EccentricityLut& lut) {
+    double sum = 0.0, sum_sq = 0.0;
+    const size_t n = 10000;
+    for (size_t i = 0; i < n; ++i) {
+        double pos = (double)cpr * i / n;
+        int32_t raw = raw_at(pos);
+        double err = raw + 0.5 - eccentricity_error(lut, cpr, (float)raw + 0.5f) - pos;
+        err -= cpr * std::round(err / cpr);
+        sum += err;
+        sum_sq += err * err;
+    }
+    double mean = sum / n;
+    return (float)sqrt(sum_sq / n - mean * mean);
+}
+
+TEST_CASE("calibration") {
+    EccentricityLut none = {};
+    float raw_rms = compensated_rms(none);
+
+    for (double vel : {0.9, -0.9, 5.0}) {
+        EccentricityLut lut;
+        float residual_rms;
+        REQUIRE(calibrate(vel, 12.0f / std::abs(vel), &lut, &residual_rms));
+        float rms = compensated_rms(lut);
+        MESSAGE(vel << " turn/s: error " << raw_rms << " counts RMS, compensated " << rms
+                << ", residual during calibration " << residual_rms);
+        CHECK(residual_rms == doctest::Approx(raw_rms).epsilon(0.2));
+        CHECK(rms < 0.1f * raw_rms);
+    }
+}
+
+TEST_CASE("table") {
+    EccentricityLut lut = {};
+    lut[0] = 16;
+    lut[1] = -32;
+    lut[kEccentricityLutSize - 1] = 8;
+    float bin = (float)cpr / kEccentricityLutSize;
+    CHECK(eccentricity_error(lut, cpr, 0.0f) == doctest::Approx(1.0f));
+    CHECK(eccentricity_error(lut, cpr, 0.5f * bin) == doctest::Approx(-0.5f));
+    CHECK(eccentricity_error(lut, cpr, 1.25f * bin) == doctest::Approx(-1.5f));
+    CHECK(eccentricity_error(lut, cpr, cpr - 0.5f * bin) == doctest::Approx(0.75f));
+    CHECK(eccentricity_error(lut, cpr, (float)cpr) == doctest::Approx(1.0f));
+}
+
+TEST_CASE("too_short") {
+    EccentricityLut lut = {};
+    lut[3] = 7;
+    CHECK_FALSE(calibrate(0.9, 2.0f, &lut));
+    CHECK(lut[3] == 7);
+}
+
+}
@@ -0,0 +1,158 @@
+#include <doctest.h>
+#include <cmath>
+#include <random>
+
+#include "MotorControl/edge_timing.hpp"
+
+TEST_SUITE("edge_timing") {
+
+static constexpr float current_meas_hz = 8000.0f;
+static constexpr float current_meas_period = 1.0f / current_meas_hz;
+static constexpr float clock_hz = 168e6f;
+static constexpr int32_t cpr = 8192; // 2048 line encoder
+
+/**
+ * @brief Incremental encoder with the PLL of Encoder::update() and optionally
+ * the edge timing, moving at a constant velocity.
+ *
+ * Channel A is high in the counts 0 and 1 of each quadrature cycle. Its
+ * rising edges are timestamped with up to 100 clocks of interrupt latency.
+ */
+struct Sim {
+    struct Stats_t {
+        float vel_rms;  // [turn/s] RMS velocity error
+        float pos_rms;  // [count] RMS error of count + interpolation
+    };
+
+    explicit Sim(bool edge_timing) : edge_timing_(edge_timing) {}
+
+    Stats_t run(double vel, float duration) {
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<uint32_t> latency(0, 100);
+        const double vel_counts = vel * cpr;
+        const double pos0 = 0.3;
+
+        float kp = 2000.0f, ki = 0.25f * kp * kp;
+        float pll_pos = pos0, pll_vel = 0.0f;
+        int32_t count = (int32_t)std::floor(pos0);
+        float interpolation = 0.5f;
+        double sum_sq_vel = 0.0, sum_sq_pos = 0.0;
+        size_t n = 0;
+
+        for (size_t i = 1; i < duration * current_meas_hz; ++i) {
+            double t = i * (double)current_meas_period;
+
+            // Rising edges of A since the previous sample
+            int32_t new_count = (int32_t)std::floor(pos0 + vel_counts * t);
+            for (int32_t c = count + 1; c <= new_count; ++c) {
+                if (mod4(c) == 0) {
+                    edge(c, (c - pos0) / vel_counts, latency(rng));
+                }
+            }
+            for (int32_t c = count - 1; c >= new_count; --c) {
+                if (mod4(c) == 1) {
+                    edge(c, (c + 1 - pos0) / vel_counts, latency(rng));
+                }
+            }
+            count = new_count;
+            edges_.sample(timestamp(t, 0));
+
+            // PLL as in Encoder::update()
+            pll_pos += current_meas_period * pll_vel;
+            float delta_pos = (float)(count - (int32_t)std::floor(pll_pos));
+            pll_pos += current_meas_period * kp * delta_pos;
+            pll_vel += current_meas_period * ki * delta_pos;
+
+            float edge_vel, edge_interpolation;
+            bool edge_valid = edge_timing_ && edges_.update((int16_t)count, pll_vel, clock_hz,
+                    current_meas_period, &edge_vel, &edge_interpolation);
+            if (edge_valid) {
+                pll_vel = edge_vel;
+                interpolation = edge_interpolation;
+            } else {
+                if (std::abs(pll_vel) < 0.5f * current_meas_period * ki) {
+                    pll_vel = 0.0f;
+                }
+                interpolation = 0.5f;
+            }
+
+            if (t >= 0.5 * duration) {
+                double vel_err = pll_vel / cpr - vel;
+                double pos_err = count + interpolation - (pos0 + vel_counts * t);
+                sum_sq_vel += vel_err * vel_err;
+                sum_sq_pos += pos_err * pos_err;
+                n++;
+            }
+        }
+        return {(float)sqrt(sum_sq_vel / n), (float)sqrt(sum_sq_pos / n)};
+    }
+
+    static int32_t mod4(int32_t c) { return ((c % 4) + 4) % 4; }
+
+    static uint32_t timestamp(double t, uint32_t latency) {
+        return (uint32_t)(uint64_t)llround(t * clock_hz) + latency;
+    }
+
+    void edge(int32_t count, double t, uint32_t latency) {
+        edges_.on_edge((int16_t)count, timestamp(t, latency));
+    }
+
+    bool edge_timing_;
+    EdgeTiming edges_;
+};
+
+TEST_CASE("low_speed") {
+    for (double vel : {0.01, 0.05, 0.2, -0.05}) {
+        Sim::Stats_t pll = Sim(false).run(vel, 4.0f);
+        Sim::Stats_t edge = Sim(true).run(vel, 4.0f);
+        MESSAGE(vel << " turn/s: velocity error PLL " << pll.vel_rms << ", edge timing " << edge.vel_rms
+                << " turn/s, position error PLL " << pll.pos_rms << ", edge timing " << edge.pos_rms << " count");
+        CHECK(edge.vel_rms < 0.01f * pll.vel_rms);
+        CHECK(edge.pos_rms < 0.1f * pll.pos_rms);
+    }
+}
+
+TEST_CASE("high_speed") {
+    // Edges closer than a control period leave the PLL alone
+    Sim::Stats_t pll = Sim(false).run(5.0, 1.0f);
+    Sim::Stats_t edge = Sim(true).run(5.0, 1.0f);
+    CHECK(edge.vel_rms == doctest::Approx(pll.vel_rms));
+
+    // In between, the blend is no worse than the PLL
+    for (double vel : {0.4, 1.0, 2.0}) {
+        Sim::Stats_t pll = Sim(false).run(vel, 1.0f);
+        Sim::Stats_t edge = Sim(true).run(vel, 1.0f);
+        CHECK(edge.vel_rms <= pll.vel_rms);
+    }
+}
+
+TEST_CASE("stop") {
+    EdgeTiming edges;
+    float vel = 123.0f, interpolation = 0.0f;
+    edges.sample(0);
+    CHECK_FALSE(edges.update(0, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+
+    // Two edges 10ms apart, i.e. 400 count/s
+    edges.on_edge(4, 0);
+    edges.on_edge(8, (uint32_t)(0.01f * clock_hz));
+    edges.sample((uint32_t)(0.012f * clock_hz));
+    REQUIRE(edges.update(8, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+    CHECK(vel == doctest::Approx(400.0f));
+    CHECK(interpolation == doctest::Approx(0.8f));
+
+    // No further edge: the velocity decays
+    edges.sample((uint32_t)(1.01f * clock_hz));
+    REQUIRE(edges.update(9, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+    CHECK(vel == doctest::Approx(4.0f));
+    CHECK(interpolation == 1.0f);
+
+    // Moving down: the axis was at the upper end of the count at the edge
+    edges.on_edge(5, (uint32_t)(1.02f * clock_hz));
+    edges.on_edge(1, (uint32_t)(1.04f * clock_hz));
+    edges.sample((uint32_t)(1.045f * clock_hz));
+    REQUIRE(edges.update(1, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+    CHECK(vel == doctest::Approx(-200.0f));
+    CHECK(interpolation == doctest::Approx(0.0f));
+}
+
+}
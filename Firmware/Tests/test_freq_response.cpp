@@ -0,0 +1,125 @@
+
+#include <doctest.h>
+
+#include <complex>
+#include "MotorControl/freq_response_analyzer.hpp"
+
+TEST_SUITE("freq_response") {
+
+using cplx = std::complex<double>;
+
+static constexpr float kSampleRate = 8000.0f;
+
+// Inertia with viscous friction J * dv/dt = T - b * v, discretized exactly
+// for a torque that is held constant over each sample. The response in
+// sample k is the velocity at the start of the sample, so it depends on the
+// torque of sample k-1 only.
+struct Plant {
+    double J = 0.002;  // [Nm/(turn/s^2)]
+    double b = 0.05;   // [Nm/(turn/s)]
+    double a = exp(-b / J / kSampleRate);
+    double v = 0.0;
+
+    void step(double torque) { v = a * v + (1.0 - a) / b * torque; }
+
+    cplx response(double f) const {
+        cplx z_inv = std::polar(1.0, -2.0 * M_PI * f / kSampleRate);
+        return (1.0 - a) / b * z_inv / (1.0 - a * z_inv);
+    }
+};
+
+static void check_point(const FreqResponseAnalyzer::Point_t& point, cplx expected) {
+    CAPTURE(point.frequency);
+    CHECK(point.magnitude == doctest::Approx(std::abs(expected)).epsilon(0.01));
+    CHECK(point.phase == doctest::Approx(std::arg(expected)).epsilon(0.01));
+}
+
+TEST_CASE("open_loop") {
+    Plant plant;
+    FreqResponseAnalyzer fra;
+    REQUIRE(fra.start(1.0f, 1000.0f, 8, 0.1f, 5, 10, kSampleRate));
+
+    while (fra.running()) {
+        float torque = fra.excitation();
+        fra.update(torque, (float)plant.v);
+        plant.step(torque);
+    }
+
+    REQUIRE(fra.n_done() == 8);
+    for (uint32_t i = 0; i < 8; ++i) {
+        const FreqResponseAnalyzer::Point_t& point = fra.points()[i];
+        check_point(point, plant.response(point.frequency));
+        CHECK(point.command_magnitude == doctest::Approx(1.0f).epsilon(0.001));
+        CHECK(point.command_phase == doctest::Approx(0.0f).epsilon(0.001));
+    }
+}
+
+TEST_CASE("closed_loop") {
+    // PI velocity loop with the excitation added to the velocity setpoint
+    // like in Controller::update(). The plant is recovered from inside the
+    // loop and the sensitivity from the excitation to the torque command is
+    // C / (1 + C * P).
+    Plant plant;
+    const float vel_gain = 0.2f;
+    const float vel_integrator_gain = 4.0f;
+    const float vel_offset = 3.0f; // DC component must not leak into the result
+    float integrator = 0.0f;
+
+    FreqResponseAnalyzer fra;
+    REQUIRE(fra.start(2.0f, 2000.0f, 12, 0.5f, 5, 10, kSampleRate));
+
+    while (fra.running()) {
+        float v_err = vel_offset + fra.excitation() - (float)plant.v;
+        float torque = vel_gain * v_err + integrator;
+        integrator += vel_integrator_gain / kSampleRate * v_err;
+        fra.update(torque, (float)plant.v);
+        plant.step(torque);
+    }
+
+    REQUIRE(fra.n_done() == 12);
+    for (uint32_t i = 0; i < 12; ++i) {
+        const FreqResponseAnalyzer::Point_t& point = fra.points()[i];
+        cplx z_inv = std::polar(1.0, -2.0 * M_PI * point.frequency / kSampleRate);
+        cplx C = (double)vel_gain + (double)vel_integrator_gain / kSampleRate * z_inv / (1.0 - z_inv);
+        cplx P = plant.response(point.frequency);
+        cplx S = C / (1.0 + C * P);
+
+        check_point(point, P);
+        CHECK(point.command_magnitude == doctest::Approx(std::abs(S)).epsilon(0.01));
+        CHECK(point.command_phase == doctest::Approx(std::arg(S)).epsilon(0.01));
+    }
+}
+
+TEST_CASE("frequencies") {
+    FreqResponseAnalyzer fra;
+    REQUIRE(fra.start(10.0f, 3000.0f, 5, 1.0f, 0, 4, kSampleRate));
+    while (fra.running()) {
+        fra.update(fra.excitation(), 0.0f);
+    }
+
+    // Log-spaced and snapped to a whole number of samples per window
+    float f_prev = 0.0f;
+    for (uint32_t i = 0; i < 5; ++i) {
+        float f = fra.points()[i].frequency;
+        CAPTURE(i);
+        CHECK(f == doctest::Approx(10.0f * powf(300.0f, i / 4.0f)).epsilon(0.05));
+        float samples = 4.0f * kSampleRate / f;
+        CHECK(samples == doctest::Approx(roundf(samples)).epsilon(1e-4));
+        CHECK(f > f_prev);
+        f_prev = f;
+    }
+}
+
+TEST_CASE("invalid_settings") {
+    FreqResponseAnalyzer fra;
+    CHECK(!fra.start(1.0f, 4000.0f, 8, 0.1f, 5, 10, kSampleRate)); // Nyquist
+    CHECK(!fra.start(0.0f, 100.0f, 8, 0.1f, 5, 10, kSampleRate));
+    CHECK(!fra.start(1.0f, 100.0f, 0, 0.1f, 5, 10, kSampleRate));
+    CHECK(!fra.start(1.0f, 100.0f, 33, 0.1f, 5, 10, kSampleRate));
+    CHECK(!fra.start(1.0f, 100.0f, 8, 0.0f, 5, 10, kSampleRate));
+    CHECK(!fra.start(1.0f, 100.0f, 8, 0.1f, 5, 0, kSampleRate));
+    CHECK(!fra.running());
+    CHECK(fra.excitation() == 0.0f);
+}
+
+}
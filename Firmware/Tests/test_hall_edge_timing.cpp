@@ -0,0 +1,200 @@
+#include <doctest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "MotorControl/hall_edge_timing.hpp"
+
+TEST_SUITE("hall_edge_timing") {
+
+static constexpr float current_meas_hz = 8000.0f;
+static constexpr float current_meas_period = 1.0f / current_meas_hz;
+static constexpr float clock_hz = 168e6f;
+
+// Unevenly spaced sensors, as found by the hall phase calibration
+static constexpr std::array<float, 6> edges = {0.0f, 1.1f, 1.9f, 3.05f, 4.0f, 4.95f};
+
+static uint8_t encode(int32_t hall_cnt) {
+    static constexpr uint8_t states[6] = {0b001, 0b011, 0b010, 0b110, 0b100, 0b101};
+    return states[hall_cnt];
+}
+
+static int32_t hall_cnt_at(double pos) {
+    double pos_in_range = pos - 6.0 * std::floor(pos / 6.0);
+    int32_t cnt = 5;
+    for (int32_t i = 0; i < 6; ++i) {
+        if (pos_in_range >= edges[i]) {
+            cnt = i;
+        }
+    }
+    return cnt;
+}
+
+static float wrap6(double x) {
+    return (float)(x - 6.0 * std::floor((x + 3.0) / 6.0));
+}
+
+/**
+ * @brief Hall sensors moving at a constant velocity, tracked by the PLL of
+ * Encoder::update() with its count interpolation, and optionally corrected by
+ * the edge timing.
+ */
+struct Sim {
+    struct Stats_t {
+        float vel_rms;  // [count/s] RMS velocity error
+        float pos_rms;  // [count] RMS error of the interpolated position
+    };
+
+    explicit Sim(bool edge_timing) : edge_timing_(edge_timing) {}
+
+    // The hall model of Encoder::update()
+    static int32_t hall_model(float pos) {
+        int32_t base_cnt = (int32_t)std::floor(pos);
+        float pos_in_range = pos - 6.0f * std::floor(pos / 6.0f);
+        int pos_idx = std::min((int)pos_in_range, 5);
+        if (wrap6(pos_in_range - edges[pos_idx]) < 0.0f)
+            return base_cnt - 1;
+        else if (wrap6(pos_in_range - edges[(pos_idx + 1) % 6]) > 0.0f)
+            return base_cnt + 1;
+        return base_cnt;
+    }
+
+    Stats_t run(double vel, float duration) {
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<uint32_t> latency(0, 100);
+        const double pos0 = 0.5;
+
+        float kp = 2.0f * 100.0f, ki = 0.25f * kp * kp; // bandwidth 100 rad/s
+        float pll_pos = pos0, pll_vel = 0.0f;
+        int32_t count = (int32_t)std::floor(pos0);
+        float interpolation = 0.5f;
+        double sum_sq_vel = 0.0, sum_sq_pos = 0.0;
+        size_t n = 0;
+
+        for (size_t i = 1; i < duration * current_meas_hz; ++i) {
+            double t = i * (double)current_meas_period;
+            double t_prev = t - current_meas_period;
+            double pos = pos0 + vel * t, pos_prev = pos0 + vel * t_prev;
+
+            // Edges crossed since the previous sample, in order. An interrupt
+            // that is still pending at the sample runs after it.
+            uint32_t sample_timestamp = (uint32_t)(uint64_t)llround(t * clock_hz);
+            std::vector<std::pair<uint8_t, uint32_t>> pending;
+            double lo = std::min(pos, pos_prev), hi = std::max(pos, pos_prev);
+            for (int32_t k = 0; k < 12; ++k) {
+                int32_t m = (int32_t)std::floor(lo / 6.0) + k / 6;
+                int32_t j = vel > 0 ? k % 6 : 5 - k % 6;
+                if (vel < 0) m = (int32_t)std::floor(hi / 6.0) - k / 6;
+                double edge = 6.0 * m + edges[j];
+                if (edge > lo && edge <= hi) {
+                    double t_edge = (edge - pos0) / vel;
+                    int32_t cnt_after = vel > 0 ? j : (j + 5) % 6;
+                    uint32_t timestamp = (uint32_t)(uint64_t)llround(t_edge * clock_hz) + latency(rng);
+                    if (timestamp <= sample_timestamp) {
+                        edges_.on_edge(encode(cnt_after), timestamp);
+                    } else {
+                        pending.push_back({encode(cnt_after), timestamp});
+                    }
+                }
+            }
+            edges_.sample(sample_timestamp);
+            for (auto& edge : pending) {
+                edges_.on_edge(edge.first, edge.second);
+            }
+
+            int32_t hall_cnt = hall_cnt_at(pos);
+            int32_t delta_enc = ((hall_cnt - count) % 6 + 6) % 6;
+            if (delta_enc > 3) delta_enc -= 6;
+            count += delta_enc;
+
+            // PLL as in Encoder::update()
+            pll_pos += current_meas_period * pll_vel;
+            float delta_pos = (float)(count - hall_model(pll_pos));
+            pll_pos += current_meas_period * kp * delta_pos;
+            pll_vel += current_meas_period * ki * delta_pos;
+
+            float edge_vel, edge_interpolation;
+            bool edge_valid = edge_timing_ && edges_.update(0, edges, hall_cnt, pll_vel, clock_hz,
+                    current_meas_period, &edge_vel, &edge_interpolation);
+            if (edge_valid) {
+                pll_vel = edge_vel;
+                interpolation = edge_interpolation;
+            } else if (std::abs(pll_vel) < 0.5f * current_meas_period * ki) {
+                pll_vel = 0.0f;
+                interpolation = 0.5f;
+            } else if (delta_enc > 0) {
+                interpolation = 0.0f;
+            } else if (delta_enc < 0) {
+                interpolation = 1.0f;
+            } else {
+                interpolation = std::clamp(interpolation + current_meas_period * pll_vel, 0.0f, 1.0f);
+            }
+
+            if (t >= 0.5 * duration) {
+                double vel_err = pll_vel - vel;
+                double pos_err = wrap6(count + interpolation - pos);
+                sum_sq_vel += vel_err * vel_err;
+                sum_sq_pos += pos_err * pos_err;
+                n++;
+            }
+        }
+        return {(float)sqrt(sum_sq_vel / n), (float)sqrt(sum_sq_pos / n)};
+    }
+
+    bool edge_timing_;
+    HallEdgeTiming edges_;
+};
+
+TEST_CASE("low_speed") {
+    // 7 pole pairs: 42 counts per turn, so 0.1 to 5 turn/s
+    for (double vel : {4.2, 42.0, 210.0, -42.0}) {
+        Sim::Stats_t pll = Sim(false).run(vel, 4.0f);
+        Sim::Stats_t edge = Sim(true).run(vel, 4.0f);
+        MESSAGE(vel << " count/s: velocity error PLL " << pll.vel_rms << ", edge timing " << edge.vel_rms
+                << " count/s, position error PLL " << pll.pos_rms << ", edge timing " << edge.pos_rms << " count");
+        CHECK(edge.vel_rms < 0.2f * pll.vel_rms);
+        CHECK(edge.pos_rms < 0.1f * pll.pos_rms);
+    }
+}
+
+TEST_CASE("edges") {
+    HallEdgeTiming timing;
+    float vel = 0.0f, interpolation = 0.0f;
+
+    // Up from 0 to 2: the edges at 1.1 and 1.9 are 10ms apart
+    timing.on_edge(encode(0), 0);
+    timing.on_edge(encode(1), (uint32_t)(0.01f * clock_hz));
+    timing.sample((uint32_t)(0.015f * clock_hz));
+    CHECK_FALSE(timing.update(0, edges, 1, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+    timing.on_edge(encode(2), (uint32_t)(0.02f * clock_hz));
+    timing.sample((uint32_t)(0.025f * clock_hz));
+    REQUIRE(timing.update(0, edges, 2, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+    CHECK(vel == doctest::Approx(80.0f));
+    CHECK(interpolation == doctest::Approx(-0.1f + 0.4f));
+
+    // Much later: the position waits at the next edge and the velocity decays
+    timing.sample((uint32_t)(1.02f * clock_hz));
+    REQUIRE(timing.update(0, edges, 2, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+    CHECK(vel == doctest::Approx(1.15f));
+    CHECK(interpolation == doctest::Approx(1.05f));
+
+    // The hall count already moved on but the edge was not recorded
+    CHECK_FALSE(timing.update(0, edges, 3, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+
+    // Reversal at the edge at 1.9: zero velocity, anchored at the top of state 1
+    timing.on_edge(encode(1), (uint32_t)(1.03f * clock_hz));
+    timing.sample((uint32_t)(1.031f * clock_hz));
+    REQUIRE(timing.update(0, edges, 1, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+    CHECK(vel == 0.0f);
+    CHECK(interpolation == doctest::Approx(0.9f));
+
+    // Glitches and illegal states
+    timing.on_edge(encode(1), (uint32_t)(1.032f * clock_hz));
+    timing.sample((uint32_t)(1.033f * clock_hz));
+    CHECK(timing.update(0, edges, 1, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+    timing.on_edge(0b111, (uint32_t)(1.034f * clock_hz));
+    timing.sample((uint32_t)(1.035f * clock_hz));
+    CHECK_FALSE(timing.update(0, edges, 1, 0.0f, clock_hz, current_meas_period, &vel, &interpolation));
+}
+
+}
@@ -0,0 +1,135 @@
+#include <doctest.h>
+#include <cmath>
+#include <random>
+
+#include "MotorControl/inertia_estimator.hpp"
+#include "MotorControl/mechanical_identifier.hpp"
+
+TEST_SUITE("inertia_estimator") {
+
+static constexpr float current_meas_hz = 8000.0f;
+static constexpr float current_meas_period = 1.0f / current_meas_hz;
+
+/**
+ * @brief Pick and place cycle: the velocity loop of Controller::update() with
+ * a ramped velocity setpoint and inertia feedforward (INPUT_MODE_VEL_RAMP),
+ * driving an inertia that increases 10x together with a load torque at
+ * t_pick.
+ */
+struct PickAndPlace {
+    static constexpr double kInertia = 1e-3;  // [Nm/(turn/s^2)] nominal
+    static constexpr double kPayloadRatio = 10.0;
+    static constexpr double kLoadTorque = 0.05; // [Nm]
+    static constexpr float t_pick = 1.0f;       // [s]
+
+    explicit PickAndPlace(bool adapt) : adapt_(adapt) {
+        MechanicalIdentifier::Result_t plant = {(float)kInertia, 0.0f, 0.0f};
+        MechanicalIdentifier::compute_gains(plant, 100.0f, 60.0f, &vel_gain_, &vel_integrator_gain_);
+        estimator_.reset((float)kInertia);
+    }
+
+    // Returns the RMS velocity error over [t_begin, t_end]
+    float run(float t_begin, float t_end) {
+        std::mt19937 rng(1);
+        std::normal_distribution<float> noise(0.0f, 0.005f);
+        double v = 0.0;
+        float vel_setpoint = 0.0f;
+        float integrator = 0.0f;
+        float torque = 0.0f;
+        double sum_sq = 0.0;
+        size_t n = 0;
+
+        for (size_t i = 0; i < t_end * current_meas_hz; ++i) {
+            float t = i * current_meas_period;
+            bool picked = t >= t_pick;
+            double J = picked ? kPayloadRatio * kInertia : kInertia;
+            double load = picked ? kLoadTorque : 0.0;
+
+            // The torque of the previous iteration was applied until now
+            v += current_meas_period / J * (torque - load);
+            float vel_estimate = (float)v + noise(rng);
+
+            estimator_.update(torque, vel_estimate, current_meas_period, 0.1f, 10.0f);
+            if (adapt_) {
+                estimator_.update_scale((float)kInertia, 20.0f, 8.0f, current_meas_period);
+            }
+            float scale = adapt_ ? estimator_.scale() : 1.0f;
+
+            // Move back and forth between -2 and 2 turn/s every 0.25s
+            float input_vel = fmodf(t, 0.5f) < 0.25f ? 2.0f : -2.0f;
+            float max_step = 40.0f * current_meas_period;
+            float step = std::clamp(input_vel - vel_setpoint, -max_step, max_step);
+            vel_setpoint += step;
+            float torque_ff = (step / current_meas_period) * (float)kInertia * scale;
+
+            float v_err = vel_setpoint - vel_estimate;
+            torque = torque_ff + vel_gain_ * scale * v_err + integrator;
+            integrator += vel_integrator_gain_ * scale * current_meas_period * v_err;
+
+            if (t >= t_begin) {
+                sum_sq += (vel_setpoint - v) * (vel_setpoint - v);
+                n++;
+            }
+        }
+        return (float)sqrt(sum_sq / n);
+    }
+
+    bool adapt_;
+    float vel_gain_;
+    float vel_integrator_gain_;
+    InertiaEstimator estimator_;
+};
+
+TEST_CASE("estimate") {
+    PickAndPlace sim(false);
+    sim.run(0.0f, 0.9f);
+    CHECK(sim.estimator_.inertia() == doctest::Approx(PickAndPlace::kInertia).epsilon(0.1));
+    CHECK(sim.estimator_.load_torque() == doctest::Approx(0.0).scale(0.01).epsilon(0.1));
+
+    PickAndPlace picked(false);
+    picked.run(0.0f, 2.0f);
+    CHECK(picked.estimator_.inertia() == doctest::Approx(PickAndPlace::kPayloadRatio * PickAndPlace::kInertia).epsilon(0.1));
+    CHECK(picked.estimator_.load_torque() == doctest::Approx(PickAndPlace::kLoadTorque).epsilon(0.1));
+}
+
+TEST_CASE("adaptation") {
+    // Before the pick both variants track alike
+    PickAndPlace fixed_before(false), adaptive_before(true);
+    float rms_fixed_before = fixed_before.run(0.2f, 0.9f);
+    float rms_adaptive_before = adaptive_before.run(0.2f, 0.9f);
+    CHECK(rms_adaptive_before < 2.0f * rms_fixed_before);
+
+    // After the pick the fixed gains are 10x too low and the loop rings,
+    // while the adapted gains recover the tracking within about a second
+    PickAndPlace fixed(false), adaptive(true);
+    float rms_fixed = fixed.run(2.0f, 3.0f);
+    float rms_adaptive = adaptive.run(2.0f, 3.0f);
+    MESSAGE("RMS velocity error before pick: " << rms_fixed_before
+            << ", after pick with fixed gains: " << rms_fixed
+            << ", with adapted gains: " << rms_adaptive);
+    CHECK(adaptive.estimator_.scale() == doctest::Approx(PickAndPlace::kPayloadRatio).epsilon(0.1));
+    CHECK(rms_adaptive < 0.05f * rms_fixed);
+    CHECK(rms_adaptive < 10.0f * rms_fixed_before);
+}
+
+TEST_CASE("rate_limit") {
+    InertiaEstimator estimator;
+    estimator.reset(1e-3f);
+
+    // Constant acceleration of 100 turn/s^2 at 10x the nominal inertia
+    float vel = 0.0f;
+    for (size_t i = 0; i < 1000; ++i) {
+        vel += 100.0f * current_meas_period;
+        estimator.update(1.0f, vel, current_meas_period, 0.1f, 10.0f);
+        estimator.update_scale(1e-3f, 5.0f, 2.0f, current_meas_period);
+    }
+    CHECK(estimator.inertia() == doctest::Approx(1e-2f).epsilon(0.01));
+    // The scale grows by at most 2/s, so exp(2/s * 0.125s) = 1.28x, and up to 5x
+    CHECK(estimator.scale() == doctest::Approx(expf(2.0f * 1000 * current_meas_period)).epsilon(0.01));
+    for (size_t i = 0; i < 20000; ++i) {
+        estimator.update_scale(1e-3f, 5.0f, 2.0f, current_meas_period);
+    }
+    CHECK(estimator.scale() == doctest::Approx(5.0f));
+}
+
+}
@@ -0,0 +1,136 @@
+#include <doctest.h>
+#include <chrono>
+#include <cmath>
+#include <initializer_list>
+
+#include "MotorControl/kalman_gains.hpp"
+
+TEST_SUITE("kalman_gains") {
+
+static constexpr float current_meas_hz = 8000.0f;
+static constexpr float current_meas_period = 1.0f / current_meas_hz;
+static constexpr int32_t cpr = 8192;
+
+/**
+ * @brief The estimator loop of Encoder::update() for an incremental encoder.
+ * PLL and Kalman filter only differ in the gains and in the phase detector:
+ * the PLL compares against the count of the estimate, the Kalman filter
+ * against the estimate itself, with the count taken as the middle of the
+ * count interval.
+ */
+struct Tracker {
+    Tracker(float kp, float ki, float ka) : kp_(kp), ki_(ki), ka_(ka) {}
+
+    void update(int32_t count) {
+        pos_ += current_meas_period * (vel_ + 0.5f * current_meas_period * acc_);
+        vel_ += current_meas_period * acc_;
+        float delta_pos = ka_ > 0.0f
+                ? (float)count + 0.5f - pos_
+                : (float)(count - (int32_t)std::floor(pos_));
+        pos_ += current_meas_period * kp_ * delta_pos;
+        vel_ += current_meas_period * ki_ * delta_pos;
+        acc_ += current_meas_period * ka_ * delta_pos;
+    }
+
+    float kp_, ki_, ka_;
+    float pos_ = 0.0f; // [count]
+    float vel_ = 0.0f; // [count/s]
+    float acc_ = 0.0f; // [count/s^2]
+};
+
+Tracker pll(float bandwidth) {
+    float kp = 2.0f * bandwidth;
+    return Tracker(kp, 0.25f * kp * kp, 0.0f);
+}
+
+Tracker kalman(float process_noise) {
+    float kp = 0.0f, ki = 0.0f, ka = 0.0f;
+    REQUIRE(compute_kalman_gains(process_noise * cpr * cpr, 1.0f / sqrtf(12.0f), current_meas_period, &kp, &ki, &ka));
+    return Tracker(kp, ki, ka);
+}
+
+struct Stats_t {
+    float lag;   // [turn/s] mean velocity error
+    float noise; // [turn/s] standard deviation of the velocity error
+};
+
+// Moves with vel + acc * t for 2s and evaluates the velocity error in the
+// second half
+Stats_t run(Tracker tracker, float vel, float acc) {
+    double true_vel = vel, true_pos = 0.3 / cpr;
+    double sum = 0.0, sum_sq = 0.0;
+    size_t n = 0;
+    for (size_t i = 0; i < 2 * current_meas_hz; ++i) {
+        true_vel += acc * current_meas_period;
+        true_pos += true_vel * current_meas_period;
+        tracker.update((int32_t)std::floor(true_pos * cpr));
+        if (i >= current_meas_hz) {
+            double err = tracker.vel_ / cpr - true_vel;
+            sum += err;
+            sum_sq += err * err;
+            n++;
+        }
+    }
+    float mean = (float)(sum / n);
+    return {mean, (float)sqrt(sum_sq / n - (double)mean * mean)};
+}
+
+TEST_CASE("gains") {
+    // Gains are per second, the dimensionless gains must be within (0, 1)
+    float kp = 0.0f, ki = 0.0f, ka = 0.0f;
+    REQUIRE(compute_kalman_gains(3e4f * cpr * cpr, 0.2887f, current_meas_period, &kp, &ki, &ka));
+    CHECK(kp * current_meas_period > 0.0f);
+    CHECK(kp * current_meas_period < 1.0f);
+    CHECK(ki > 0.0f);
+    CHECK(ka > 0.0f);
+
+    // More process noise trusts the measurements more
+    float kp2, ki2, ka2;
+    REQUIRE(compute_kalman_gains(3e6f * cpr * cpr, 0.2887f, current_meas_period, &kp2, &ki2, &ka2));
+    CHECK(kp2 > kp);
+    CHECK(ki2 > ki);
+    CHECK(ka2 > ka);
+
+    CHECK_FALSE(compute_kalman_gains(0.0f, 0.2887f, current_meas_period, &kp, &ki, &ka));
+    CHECK_FALSE(compute_kalman_gains(1.0f, 0.0f, current_meas_period, &kp, &ki, &ka));
+    CHECK_FALSE(compute_kalman_gains(NAN, 0.2887f, current_meas_period, &kp, &ki, &ka));
+}
+
+TEST_CASE("benchmark") {
+    // The defaults: PLL bandwidth 1000 rad/s, Kalman process noise 1e3 turn^2/s^5
+    Tracker p = pll(1000.0f);
+    Tracker k = kalman(1e3f);
+
+    for (float vel : {0.005f, 0.02f, 0.1f, 0.37f}) {
+        MESSAGE("velocity noise at " << vel << " turn/s: PLL " << run(p, vel, 0.0f).noise
+                << ", Kalman " << run(k, vel, 0.0f).noise << " turn/s");
+    }
+    Stats_t pll_acc = run(p, 0.0f, 50.0f);
+    Stats_t kalman_acc = run(k, 0.0f, 50.0f);
+    MESSAGE("velocity lag at 50 turn/s^2: PLL " << pll_acc.lag << ", Kalman " << kalman_acc.lag << " turn/s");
+
+    // Less noise once there are a few edges per millisecond. Below that the
+    // quantization is a sawtooth within the bandwidth of both estimators.
+    CHECK(run(k, 0.1f, 0.0f).noise < 0.5f * run(p, 0.1f, 0.0f).noise);
+    CHECK(run(k, 0.37f, 0.0f).noise < 0.5f * run(p, 0.37f, 0.0f).noise);
+    CHECK(run(k, 0.02f, 0.0f).noise < 1.5f * run(p, 0.02f, 0.0f).noise);
+
+    // The PLL lags by 4 * acc / bandwidth = 0.1 turn/s, the Kalman filter
+    // only by the half sample of the discretization
+    CHECK(pll_acc.lag == doctest::Approx(-0.1f).epsilon(0.05));
+    CHECK(std::abs(kalman_acc.lag) < 0.01f);
+
+    // Both run the same loop, so they cost about the same
+    auto time_it = [](Tracker tracker) {
+        auto start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < 1000000; ++i) {
+            tracker.update(i / 16);
+        }
+        auto end = std::chrono::steady_clock::now();
+        volatile float sink = tracker.vel_;
+        (void)sink;
+        return std::chrono::duration<float, std::nano>(end - start).count() / 1e6f;
+    };
+    MESSAGE("update: PLL " << time_it(p) << " ns, Kalman " << time_it(k) << " ns");
+}
+}
@@ -0,0 +1,42 @@
+
+#include <doctest.h>
+
+#include "MotorControl/load_meter.hpp"
+
+TEST_SUITE("load_meter") {
+
+TEST_CASE("window") {
+    LoadMeter meter;
+    meter.reset();
+
+    // 10 periods of 1000 clocks per window, busy for 250 clocks except once
+    for (int i = 0; i < 9; ++i) {
+        meter.push(250, 1000, 10000);
+    }
+    CHECK(meter.window_count_ == 0);
+    meter.push(850, 1000, 10000);
+    CHECK(meter.window_count_ == 1);
+    CHECK(meter.load_ == doctest::Approx(0.31f));
+    CHECK(meter.last_window_min_headroom_ == 150);
+    CHECK(meter.min_headroom_ == 150);
+
+    // The peak of the previous window is not carried over into the next one
+    for (int i = 0; i < 10; ++i) {
+        meter.push(500, 1000, 10000);
+    }
+    CHECK(meter.window_count_ == 2);
+    CHECK(meter.load_ == doctest::Approx(0.5f));
+    CHECK(meter.last_window_min_headroom_ == 500);
+    CHECK(meter.min_headroom_ == 150);
+
+    // Overruns show up as negative headroom
+    meter.push(1200, 1000, 1000);
+    CHECK(meter.last_window_min_headroom_ == -200);
+    CHECK(meter.min_headroom_ == -200);
+
+    meter.reset();
+    meter.push(100, 1000, 1000);
+    CHECK(meter.min_headroom_ == 900);
+}
+
+}
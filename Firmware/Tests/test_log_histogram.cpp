@@ -0,0 +1,55 @@
+
+#include <doctest.h>
+#include <random>
+
+#include "MotorControl/log_histogram.hpp"
+
+TEST_SUITE("log_histogram") {
+
+TEST_CASE("bucket_bounds") {
+    using H = LogHistogram<5, 16>;
+    CHECK(H::bucket_of(0) == 0);
+    CHECK(H::bucket_of(31) == 0);
+    CHECK(H::bucket_of(32) == 1);
+    CHECK(H::bucket_of(65535) == H::kNumBuckets - 2);
+    CHECK(H::bucket_of(65536) == H::kNumBuckets - 1);
+    CHECK(H::bucket_of(0xffffffff) == H::kNumBuckets - 1);
+
+    // Every bucket must start where the previous one ended
+    for (size_t i = 1; i < H::kNumBuckets; ++i) {
+        CAPTURE(i);
+        CHECK(H::lower_bound(i) > H::lower_bound(i - 1));
+        CHECK(H::bucket_of(H::lower_bound(i)) == i);
+        CHECK(H::bucket_of(H::lower_bound(i) - 1) == i - 1);
+    }
+}
+
+TEST_CASE("quantiles") {
+    LogHistogram<5, 16> h;
+    CHECK(h.quantile(0.5f, 100) == 0);
+
+    // Mostly ~3000 clocks with rare outliers at ~12000 clocks
+    std::mt19937 rng(1);
+    std::normal_distribution<float> dist(3000.0f, 50.0f);
+    uint32_t max_val = 0;
+    for (int i = 0; i < 100000; ++i) {
+        uint32_t val = (i % 500 == 0) ? 12000 : (uint32_t)dist(rng);
+        max_val = std::max(max_val, val);
+        h.push(val);
+    }
+
+    CHECK(h.count() == 100000);
+    uint32_t p50 = h.quantile(0.5f, max_val);
+    uint32_t p99 = h.quantile(0.99f, max_val);
+    uint32_t p999 = h.quantile(0.999f, max_val);
+    CHECK(p50 >= 3000);
+    CHECK(p50 <= 3000 * 5 / 4);
+    CHECK(p99 >= 3100);
+    CHECK(p99 <= 3100 * 5 / 4);
+    CHECK(p999 == 12000); // bounded by the maximum
+
+    h.reset();
+    CHECK(h.count() == 0);
+}
+
+}
@@ -0,0 +1,137 @@
+#include <doctest.h>
+#include <cmath>
+#include <complex>
+#include <random>
+
+#include "MotorControl/mechanical_identifier.hpp"
+
+TEST_SUITE("mechanical_identifier") {
+
+static constexpr float current_meas_hz = 8000.0f;
+static constexpr float current_meas_period = 1.0f / current_meas_hz;
+
+/**
+ * @brief Inertia with viscous and Coulomb friction, simulated with a finer
+ * time step than the control loop. The friction holds the mechanism at
+ * standstill while the torque is below the Coulomb friction.
+ */
+struct MechanicalPlant {
+    MechanicalPlant(double J, double b, double Fc, float noise_std, unsigned seed)
+        : J_(J), b_(b), Fc_(Fc), rng_(seed), noise_(0.0f, noise_std) {}
+
+    float measure_vel() {
+        return (float)v_ + noise_(rng_);
+    }
+
+    // Applies torque T for one control period
+    void apply(double T) {
+        const int kSubsteps = 64;
+        double h = current_meas_period / kSubsteps;
+        for (int i = 0; i < kSubsteps; ++i) {
+            if (v_ == 0.0 && std::abs(T) <= Fc_) {
+                continue;
+            }
+            double dir = v_ != 0.0 ? (v_ > 0.0 ? 1.0 : -1.0) : (T > 0.0 ? 1.0 : -1.0);
+            double v_next = v_ + h / J_ * (T - b_ * v_ - Fc_ * dir);
+            if (v_next * dir < 0.0) {
+                v_next = 0.0; // friction stops the motion but doesn't reverse it
+            }
+            v_ = v_next;
+        }
+    }
+
+    double J_, b_, Fc_;
+    double v_ = 0.0;
+    std::mt19937 rng_;
+    std::normal_distribution<float> noise_;
+};
+
+static MechanicalIdentifier::Result_t identify(MechanicalPlant& plant) {
+    MechanicalIdentifier identifier;
+    identifier.start(0.2f, 2.0f, 10, 1.0f, current_meas_period);
+
+    float torque = 0.0f;
+    for (size_t i = 0; i < 30 * (size_t)current_meas_hz && identifier.running(); ++i) {
+        plant.apply(torque);
+        torque = identifier.update(torque, plant.measure_vel());
+    }
+    REQUIRE(identifier.done());
+
+    MechanicalIdentifier::Result_t result;
+    REQUIRE(identifier.solve(&result));
+    return result;
+}
+
+TEST_CASE("identify") {
+    // 100x range of inertia at the same friction
+    for (double J : {1e-4, 1e-3, 1e-2}) {
+        CAPTURE(J);
+        MechanicalPlant plant(J, 2e-3, 0.02, 0.01f, 1);
+        MechanicalIdentifier::Result_t result = identify(plant);
+        CHECK(result.inertia == doctest::Approx(J).epsilon(0.03));
+        CHECK(result.viscous_friction == doctest::Approx(2e-3).epsilon(0.1));
+        CHECK(result.coulomb_friction == doctest::Approx(0.02).epsilon(0.05));
+    }
+}
+
+TEST_CASE("no_motion") {
+    // Torque below the Coulomb friction: the relay never reverses
+    MechanicalPlant plant(1e-3, 2e-3, 0.5, 0.0f, 1);
+    MechanicalIdentifier identifier;
+    identifier.start(0.2f, 2.0f, 10, 1.0f, current_meas_period);
+    float torque = 0.0f;
+    for (size_t i = 0; i < current_meas_hz; ++i) {
+        plant.apply(torque);
+        torque = identifier.update(torque, plant.measure_vel());
+    }
+    CHECK(!identifier.done());
+    MechanicalIdentifier::Result_t result;
+    CHECK(!identifier.solve(&result));
+}
+
+TEST_CASE("gains") {
+    // The gains computed from the identified plant must give the requested
+    // crossover and phase margin on the true plant, and similar closed loop
+    // behavior regardless of the inertia.
+    const float bandwidth = 100.0f;   // [rad/s]
+    const float phase_margin = 60.0f; // [deg]
+
+    for (double J : {1e-4, 1e-3, 1e-2}) {
+        CAPTURE(J);
+        MechanicalPlant plant(J, 2e-3, 0.02, 0.01f, 2);
+        MechanicalIdentifier::Result_t result = identify(plant);
+
+        float vel_gain, vel_integrator_gain;
+        MechanicalIdentifier::compute_gains(result, bandwidth, phase_margin, &vel_gain, &vel_integrator_gain);
+        CHECK(vel_gain > 0.0f);
+        CHECK(vel_integrator_gain >= 0.0f);
+
+        std::complex<double> s(0.0, bandwidth);
+        std::complex<double> loop = ((double)vel_gain + (double)vel_integrator_gain / s) / (J * s + 2e-3);
+        CHECK(std::abs(loop) == doctest::Approx(1.0).epsilon(0.05));
+        CHECK(180.0 + std::arg(loop) * 180.0 / M_PI == doctest::Approx(phase_margin).epsilon(0.05));
+
+        // Velocity step with the PI loop of Controller::update() on the
+        // plant without friction
+        MechanicalPlant loop_plant(J, 2e-3, 0.0, 0.0f, 3);
+        float integrator = 0.0f;
+        float rise_time = 0.0f;
+        float peak = 0.0f;
+        for (size_t i = 0; i < current_meas_hz / 2; ++i) {
+            float vel = loop_plant.measure_vel();
+            float v_err = 1.0f - vel;
+            float torque = vel_gain * v_err + integrator;
+            integrator += vel_integrator_gain * current_meas_period * v_err;
+            loop_plant.apply(torque);
+            if (rise_time == 0.0f && vel >= 0.9f) {
+                rise_time = i * current_meas_period;
+            }
+            peak = std::max(peak, vel);
+        }
+        CHECK(rise_time == doctest::Approx(0.017f).epsilon(0.3));
+        CHECK(peak < 1.3f);
+        CHECK(loop_plant.v_ == doctest::Approx(1.0).epsilon(0.01));
+    }
+}
+
+}
@@ -0,0 +1,197 @@
+
+#include <doctest.h>
+#include <cmath>
+#include <random>
+
+#include "MotorControl/rl_measurement.hpp"
+
+static constexpr float current_meas_hz = 8000.0f;
+static constexpr float current_meas_period = 1.0f / current_meas_hz;
+
+/**
+ * @brief Discrete time model of a single motor phase (series RL) with
+ * noisy current measurements.
+ */
+struct RLPlant {
+    RLPlant(float R, float L, float noise_std, unsigned seed)
+        : R_(R), alpha_(std::exp(-R / L * current_meas_period)), rng_(seed), noise_(0.0f, noise_std) {}
+
+    float measure() {
+        return I_ + noise_(rng_);
+    }
+
+    // Applies voltage V for one control period
+    void apply(float V) {
+        I_ = alpha_ * I_ + (1.0f - alpha_) * V / R_;
+    }
+
+    float R_;
+    float alpha_;
+    float I_ = 0.0f;
+    std::mt19937 rng_;
+    std::normal_distribution<float> noise_;
+};
+
+// Runs the resistance measurement until it converges or for at most 3s as
+// the firmware does. Returns the measurement duration in seconds.
+static float measure_resistance(RLPlant& plant, float target_current, float rel_tolerance, float* resistance) {
+    const uint32_t kMinSamples = current_meas_hz / 10;
+    ResistanceMeasurement meas;
+    bool converged = false;
+    size_t i = 0;
+    for (; i < 3 * (size_t)current_meas_hz; ++i) {
+        if ((i % 8 == 0) && meas.stats_.is_converged(rel_tolerance, kMinSamples)) {
+            converged = true;
+            break;
+        }
+        meas.update(plant.measure(), target_current, current_meas_period);
+        plant.apply(meas.test_voltage_);
+    }
+    *resistance = converged ? meas.stats_.mean() : meas.get_resistance(target_current);
+    return (float)i * current_meas_period;
+}
+
+// Runs the inductance measurement until it converges or for at most 1.25s as
+// the firmware does. Returns the measurement duration in seconds.
+static float measure_inductance(RLPlant& plant, float test_voltage, float rel_tolerance, float* inductance) {
+    const uint32_t kMinSamples = current_meas_hz / 20;
+    InductanceMeasurement meas;
+    meas.update(plant.measure(), test_voltage);
+    size_t i = 0;
+    for (; i < 1.25f * current_meas_hz; ++i) {
+        if ((i % 8 == 0) && meas.stats_.is_converged(rel_tolerance, kMinSamples)) {
+            break;
+        }
+        test_voltage *= -1.0f;
+        plant.apply(test_voltage);
+        meas.update(plant.measure(), test_voltage);
+    }
+    float dt = (float)i * current_meas_period;
+    *inductance = meas.get_inductance(test_voltage, dt);
+    return dt;
+}
+
+TEST_SUITE("motor_calibration") {
+
+TEST_CASE("running_stats") {
+    RunningStats stats;
+    CHECK(!stats.is_converged(1.0f, 0));
+    for (float x : {2.0f, 4.0f, 4.0f, 4.0f, 5.0f, 5.0f, 7.0f, 9.0f}) {
+        stats.push(x);
+    }
+    CHECK(stats.count() == 8);
+    CHECK(stats.mean() == doctest::Approx(5.0f));
+    CHECK(stats.variance() == doctest::Approx(32.0f / 7.0f));
+    CHECK(stats.is_converged(0.5f, 8));
+    CHECK(!stats.is_converged(0.5f, 9));
+    CHECK(!stats.is_converged(0.1f, 8));
+}
+
+TEST_CASE("running_linear_fit") {
+    // Bidirectional open loop scan of an encoder with 8192 CPR on a 7 pole
+    // pair motor. The rotor lags the open loop phase by 0.05rad in both
+    // directions, which must cancel out in the offset.
+    const float counts_per_rad = 8192.0f / 7.0f / (2.0f * 3.14159265f);
+    const float offset = 1234.3f;
+    const float lag = 0.05f;
+    for (float direction : {1.0f, -1.0f}) {
+        RunningLinearFit fit;
+        const int n = 2000;
+        for (int i = 0; i < 2 * n; ++i) {
+            bool forward = i < n;
+            float phase = 2.0f * 3.14159265f * (forward ? i : (2 * n - i)) / n;
+            float rotor = phase + (forward ? -lag : lag);
+            fit.push(phase, std::floor(offset + direction * counts_per_rad * rotor));
+        }
+        CHECK(fit.slope() == doctest::Approx(direction * counts_per_rad).epsilon(0.01));
+        CHECK(fit.intercept() + 0.5f == doctest::Approx(offset).epsilon(0.0005));
+        CHECK(fit.residual_rms() < counts_per_rad * lag * 1.1f);
+        CHECK(fit.slope_stderr() < 0.001f * counts_per_rad);
+    }
+}
+
+TEST_CASE("offset_fit_stop_criterion") {
+    // Forward part of the open loop scan at 4*pi rad/s electrical, sampled at
+    // the control loop rate. The scan may stop after 2*pi (4000 samples) if
+    // the encoder follows the fit within 0.1rad.
+    const float counts_per_rad = 8192.0f / 7.0f / (2.0f * 3.14159265f);
+    const float omega = 4.0f * 3.14159265f;
+    const uint32_t min_samples = 4000;
+    const float max_residual = 0.1f * counts_per_rad;
+
+    auto first_stop = [&](float ripple) {
+        RunningLinearFit fit;
+        for (uint32_t i = 0; i < 4 * min_samples; ++i) {
+            float phase = omega * (float)i * current_meas_period;
+            float rotor = phase - 0.05f + ripple * std::sin(6.0f * phase);
+            fit.push(phase, std::floor(1234.3f + counts_per_rad * rotor));
+            if (i >= min_samples && fit.fits_within(max_residual, 3)) {
+                return i;
+            }
+        }
+        return 4 * min_samples;
+    };
+
+    // A clean scan stops at the minimum distance
+    CHECK(first_stop(0.0f) == min_samples);
+    CHECK(first_stop(0.1f) == min_samples);
+
+    // Heavy cogging or a slipping coupling runs the full scan
+    CHECK(first_stop(0.3f) == 4 * min_samples);
+}
+
+TEST_CASE("early_terminating_rl_measurement") {
+    struct MotorParams { float R; float L; };
+    const float calibration_current = 10.0f;
+    const float test_voltage = 2.0f;
+    const float tolerance = 0.01f;
+    float total_fixed = 0.0f;
+    float total_adaptive = 0.0f;
+
+    unsigned seed = 0;
+    for (MotorParams p : {MotorParams{0.03f, 10e-6f}, MotorParams{0.05f, 20e-6f},
+                          MotorParams{0.2f, 100e-6f}, MotorParams{0.5f, 500e-6f}}) {
+        CAPTURE(p.R);
+        CAPTURE(p.L);
+
+        // Reference: fixed-duration measurement as it used to be done
+        RLPlant ref_plant{p.R, p.L, 0.05f, seed};
+        float ref_r;
+        total_fixed += measure_resistance(ref_plant, calibration_current, 0.0f, &ref_r);
+
+        RLPlant plant{p.R, p.L, 0.05f, seed++};
+        float r;
+        float t_r = measure_resistance(plant, calibration_current, tolerance, &r);
+        CHECK(t_r < 3.0f);
+        CHECK(r == doctest::Approx(p.R).epsilon(0.02));
+        CHECK(std::abs(r - p.R) <= std::abs(ref_r - p.R) + 0.01f * p.R);
+
+        RLPlant ref_lplant{p.R, p.L, 0.05f, seed};
+        float ref_l;
+        total_fixed += measure_inductance(ref_lplant, test_voltage, 0.0f, &ref_l);
+
+        RLPlant lplant{p.R, p.L, 0.05f, seed++};
+        float l;
+        float t_l = measure_inductance(lplant, test_voltage, tolerance, &l);
+        CHECK(t_l < 1.25f);
+        CHECK(l == doctest::Approx(ref_l).epsilon(0.02));
+
+        total_adaptive += t_r + t_l;
+    }
+
+    MESSAGE("R+L calibration time: " << total_fixed << "s fixed vs " << total_adaptive << "s adaptive");
+    CHECK(total_adaptive < 0.25f * total_fixed);
+}
+
+TEST_CASE("high_resistance_motor") {
+    // With a large resistance the integrator of the fixed-duration measurement
+    // doesn't settle within 3s. The per-sample estimate does not depend on
+    // the integrator being settled.
+    RLPlant plant{2.0f, 1e-3f, 0.01f, 42};
+    float r;
+    float t = measure_resistance(plant, 1.0f, 0.005f, &r);
+    CHECK(t < 3.0f);
+    CHECK(r == doctest::Approx(2.0f).epsilon(0.01));
+}
+
+}
@@ -0,0 +1,61 @@
+#include <doctest.h>
+#include <cmath>
+
+#include "MotorControl/position.hpp"
+
+TEST_SUITE("position") {
+
+TEST_CASE("conversion") {
+    Position pos = -2.25f;
+    CHECK(pos.whole() == -3);
+    CHECK(pos.frac() == 0.75f);
+    CHECK(pos.to_float() == -2.25f);
+
+    pos = Position::from_count(10, -0.5f);
+    CHECK(pos.whole() == 9);
+    CHECK(pos.frac() == 0.5f);
+
+    // A tiny negative fraction must not end up as 1
+    pos = Position::from_count(5, -1e-9f);
+    CHECK(pos.whole() == 5);
+    CHECK(pos.frac() == 0.0f);
+
+    CHECK(std::isnan(Position(NAN).to_float()));
+    CHECK(std::isinf(Position(INFINITY).to_float()));
+}
+
+TEST_CASE("arithmetic") {
+    Position a = Position::from_count(1000000000000LL, 0.25f);
+    Position b = a + 2.5f;
+    CHECK(b.whole() == 1000000000002LL);
+    CHECK(b.frac() == 0.75f);
+    CHECK(b - a == 2.5f);
+    CHECK(a - b == -2.5f);
+
+    b += -3.0f;
+    CHECK(b.whole() == 999999999999LL);
+    CHECK(b.frac() == 0.75f);
+}
+
+TEST_CASE("divide") {
+    // Counts to turns at 8192 CPR
+    Position turns = Position::from_count(-8192 * 3 - 2048, 0.5f).divide(8192);
+    CHECK(turns.whole() == -4);
+    CHECK(turns.frac() == doctest::Approx(0.75f + 0.5f / 8192.0f));
+}
+
+TEST_CASE("uniform_resolution") {
+    // A PLL-style integration of small steps far from zero: a float position
+    // would not move at all, the split position loses nothing
+    const float step = 1e-4f;
+    Position pos = Position::from_count(1LL << 32);
+    float pos_f = (float)(1LL << 32);
+    for (int i = 0; i < 10000; ++i) {
+        pos += step;
+        pos_f += step;
+    }
+    CHECK(pos - Position::from_count(1LL << 32) == doctest::Approx(1.0f).epsilon(1e-3));
+    CHECK(pos_f == (float)(1LL << 32));
+}
+
+}
@@ -0,0 +1,92 @@
+#include <doctest.h>
+
+#include "MotorControl/trace_ring.hpp"
+#include "MotorControl/raw_cursor.hpp"
+
+TEST_SUITE("raw_cursor") {
+
+TEST_CASE("read_write") {
+    uint8_t block[20];
+    for (size_t i = 0; i < sizeof(block); ++i) {
+        block[i] = (uint8_t)(i + 1);
+    }
+
+    uint32_t offset = 0;
+    CHECK(raw_read(block, sizeof(block), &offset) == 0x0807060504030201ull);
+    CHECK(raw_read(block, sizeof(block), &offset) == 0x100f0e0d0c0b0a09ull);
+    CHECK(raw_read(block, sizeof(block), &offset) == 0x14131211ull); // past the end reads as 0
+    CHECK(raw_read(block, sizeof(block), &offset) == 0);
+    CHECK(offset == 32);
+
+    offset = 8;
+    raw_write(block, sizeof(block), &offset, 0x1122334455667788ull);
+    raw_write(block, sizeof(block), &offset, 0xaabbccddeeff0011ull); // only 4 bytes fit
+    CHECK(offset == 24);
+    CHECK(block[7] == 8);
+    CHECK(block[8] == 0x88);
+    CHECK(block[15] == 0x11);
+    CHECK(block[16] == 0x11);
+    CHECK(block[19] == 0xee);
+
+    offset = 0;
+    CHECK(raw_read(nullptr, 0, &offset) == 0);
+    CHECK(offset == 8);
+}
+
+TEST_CASE("read_elements") {
+    // 7 halfwords counting down from 106
+    auto get = [](size_t i) { return (uint16_t)(106 - i); };
+
+    uint32_t offset = 0;
+    CHECK(raw_read_elements<uint16_t>(7, &offset, get) == 0x006700680069006aull);
+    CHECK(raw_read_elements<uint16_t>(7, &offset, get) == 0x0000006400650066ull);
+    CHECK(raw_read_elements<uint16_t>(7, &offset, get) == 0);
+}
+
+TEST_CASE("ring_reader") {
+    TraceRing<4> ring;
+    RawRingReader<TraceRing<4>> reader;
+
+    for (uint32_t i = 0; i < 6; ++i) {
+        TraceRecord record = {};
+        record.timestamp = 1000 + i;
+        record.event = 1;
+        record.arg0 = i;
+        record.arg1 = 2 * i;
+        ring.push(record);
+    }
+
+    // Overwritten records read as zero
+    uint32_t idx = 1;
+    CHECK(reader.read(ring, &idx) == 0);
+    CHECK(idx == 1);
+    CHECK(reader.read(ring, &idx) == 0);
+    CHECK(idx == 2);
+
+    uint64_t first = reader.read(ring, &idx);
+    CHECK((uint32_t)first == 1002);
+    CHECK(idx == 2);
+
+    // The second half comes from the copy taken with the first half, even if
+    // the record is overwritten in between
+    TraceRecord record = {};
+    record.arg1 = 0xdead;
+    ring.push(record);
+    ring.push(record);
+    ring.push(record);
+    uint64_t second = reader.read(ring, &idx);
+    CHECK((uint32_t)second == 2);
+    CHECK((uint32_t)(second >> 32) == 4);
+    CHECK(idx == 3);
+
+    // Changing the index starts over with the first half
+    CHECK(reader.read(ring, &idx) == 0); // overwritten by now
+    idx = 5;
+    CHECK((uint32_t)reader.read(ring, &idx) == 1005);
+    idx = 8;
+    CHECK((uint32_t)reader.read(ring, &idx) == 0);
+    CHECK((uint32_t)(reader.read(ring, &idx) >> 32) == 0xdead);
+    CHECK(idx == 9);
+}
+
+}
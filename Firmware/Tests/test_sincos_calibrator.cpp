@@ -0,0 +1,86 @@
+#include <doctest.h>
+#include <cmath>
+#include <random>
+
+#include "MotorControl/sincos_calibrator.hpp"
+
+TEST_SUITE("sincos_calibrator") {
+
+static constexpr float current_meas_hz = 8000.0f;
+static constexpr float current_meas_period = 1.0f / current_meas_hz;
+
+/**
+ * @brief Distorted sin/cos signals in the ADC range of Encoder::sample_now()
+ * (relative voltage - 0.5) at a constant speed.
+ */
+struct Signals {
+    float offset_s = 0.04f;
+    float offset_c = -0.03f;
+    float amplitude_s = 0.35f;
+    float amplitude_c = 0.3f;
+    float quadrature = 0.08f; // [rad]
+    float noise = 0.001f;
+
+    // Runs for the duration and returns the RMS phase error [rad] over the
+    // second half
+    float run(SinCosCalibrator& calibrator, float periods_per_s, float duration, float rate) {
+        std::mt19937 rng(1);
+        std::normal_distribution<float> noise_dist(0.0f, noise);
+        double sum_sq = 0.0;
+        size_t n = 0;
+        for (size_t i = 0; i < duration * current_meas_hz; ++i) {
+            double phase = 0.3 + 2.0 * M_PI * periods_per_s * i * current_meas_period;
+            float s = offset_s + amplitude_s * (float)sin(phase) + noise_dist(rng);
+            float c = offset_c + amplitude_c * (float)cos(phase + quadrature) + noise_dist(rng);
+            if (i == 0) {
+                calibrator.reset(s, c);
+            }
+            float estimate = calibrator.update(s, c, rate);
+            if (i >= duration * current_meas_hz / 2) {
+                double err = remainder(estimate - phase, 2.0 * M_PI);
+                sum_sq += err * err;
+                n++;
+            }
+        }
+        return (float)sqrt(sum_sq / n);
+    }
+};
+
+TEST_CASE("convergence") {
+    Signals signals;
+    SinCosCalibrator raw, calibrated;
+    float raw_error = signals.run(raw, 5.0f, 40.0f, 0.0f);
+    float calibrated_error = signals.run(calibrated, 5.0f, 40.0f, 0.1f);
+    MESSAGE("cyclic error: raw " << raw_error << " rad, calibrated " << calibrated_error << " rad");
+
+    CHECK(calibrated.offset_s() == doctest::Approx(signals.offset_s).epsilon(0.05));
+    CHECK(calibrated.offset_c() == doctest::Approx(signals.offset_c).epsilon(0.05));
+    CHECK(calibrated.amplitude_s() == doctest::Approx(signals.amplitude_s).epsilon(0.01));
+    CHECK(calibrated.amplitude_c() == doctest::Approx(signals.amplitude_c).epsilon(0.01));
+    CHECK(calibrated.quadrature() == doctest::Approx(signals.quadrature).epsilon(0.05));
+    CHECK(calibrated_error < 0.05f * raw_error);
+}
+
+TEST_CASE("speed_independent") {
+    // The adaptation goes by signal periods, not by time
+    Signals signals;
+    for (float periods_per_s : {-2.0f, 50.0f, 200.0f}) {
+        SinCosCalibrator calibrator;
+        float duration = 200.0f / std::abs(periods_per_s);
+        float error = signals.run(calibrator, periods_per_s, duration, 0.1f);
+        MESSAGE(periods_per_s << " periods/s: cyclic error " << error << " rad");
+        CHECK(error < 0.006f);
+    }
+}
+
+TEST_CASE("standstill") {
+    // Without motion only the noise moves the parameters, which averages out
+    Signals signals;
+    signals.noise = 0.01f;
+    SinCosCalibrator calibrator;
+    signals.run(calibrator, 0.0f, 5.0f, 0.1f);
+    CHECK(std::abs(calibrator.offset_s()) < 0.01f);
+    CHECK(std::abs(calibrator.offset_c()) < 0.01f);
+}
+
+}
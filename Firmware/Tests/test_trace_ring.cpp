@@ -0,0 +1,97 @@
+
+#include <doctest.h>
+
+#include "MotorControl/trace_ring.hpp"
+
+TEST_SUITE("trace_ring") {
+
+template<size_t kSize>
+static void push(TraceRing<kSize>& ring, uint32_t timestamp, uint16_t event, uint32_t arg0, uint32_t arg1) {
+    TraceRecord record = {};
+    record.timestamp = timestamp;
+    record.event = event;
+    record.arg0 = arg0;
+    record.arg1 = arg1;
+    ring.push(record);
+}
+
+TEST_CASE("read_back") {
+    TraceRing<8> ring;
+    TraceRing<8>::Record record;
+
+    CHECK(ring.write_idx() == 0);
+    CHECK(!ring.read(0, &record)); // not written yet
+
+    for (uint32_t i = 0; i < 5; ++i) {
+        push(ring, 1000 + i, 1 + i, i, 2 * i);
+    }
+    CHECK(ring.write_idx() == 5);
+
+    for (uint32_t i = 0; i < 5; ++i) {
+        CAPTURE(i);
+        REQUIRE(ring.read(i, &record));
+        CHECK(record.timestamp == 1000 + i);
+        CHECK(record.event == 1 + i);
+        CHECK(record.arg0 == i);
+        CHECK(record.arg1 == 2 * i);
+    }
+    CHECK(!ring.read(5, &record));
+}
+
+TEST_CASE("overwrite") {
+    TraceRing<8> ring;
+    TraceRing<8>::Record record;
+
+    for (uint32_t i = 0; i < 20; ++i) {
+        push(ring, i, 1, i, 0);
+    }
+
+    // Only the last 8 records are still in the ring
+    for (uint32_t i = 0; i < 20; ++i) {
+        CAPTURE(i);
+        CHECK(ring.read(i, &record) == (i >= 12));
+        if (i >= 12) {
+            CHECK(record.arg0 == i);
+        }
+    }
+}
+
+TEST_CASE("wrap_around") {
+    // The sequence number only carries the lower 16 bits so make sure that
+    // records are still found after many laps.
+    TraceRing<4> ring;
+    TraceRing<4>::Record record;
+
+    for (uint32_t i = 0; i < 70000; ++i) {
+        push(ring, i, 1, i, 0);
+    }
+    CHECK(ring.read(69999, &record));
+    CHECK(record.arg0 == 69999);
+    CHECK(!ring.read(69999 - 4, &record));
+    CHECK(!ring.read(69999 - 65536, &record));
+}
+
+TEST_CASE("custom_record") {
+    struct Entry {
+        uint32_t timestamp;
+        uint16_t type;
+        uint16_t seq;
+        uint64_t error;
+    };
+    TraceRing<4, Entry> ring;
+    Entry entry = {};
+
+    for (uint32_t i = 0; i < 6; ++i) {
+        entry.type = 1;
+        entry.seq = 0x1234; // ignored
+        entry.error = (uint64_t)i << 40;
+        ring.push(entry);
+    }
+
+    CHECK(!ring.read(1, &entry));
+    REQUIRE(ring.read(5, &entry));
+    CHECK(entry.error == (uint64_t)5 << 40);
+    CHECK(entry.seq == 5);
+}
+
+}
@@ -84,6 +84,12 @@ odrive_firmware_pkg = {
         'MotorControl/foc.cpp',
         'MotorControl/open_loop_controller.cpp',
         'MotorControl/oscilloscope.cpp',
+        'MotorControl/snapshot.cpp',
+        'MotorControl/freq_response.cpp',
+        'MotorControl/trace.cpp',
+        'MotorControl/black_box.cpp',
+        'MotorControl/journal.cpp',
+        'MotorControl/task_timer.cpp',
         'MotorControl/sensorless_estimator.cpp',
         'MotorControl/trapTraj.cpp',
         'MotorControl/pwm_input.cpp',
@@ -393,6 +399,11 @@ if tup.getconfig("USE_LTO") == "true" then
     CFLAGS += '-flto'
 end
 
+-- Trace categories to compile in (see MotorControl/trace.hpp)
+if tup.getconfig("TRACE") ~= "" then
+    CFLAGS += '-DTRACE_CATEGORIES='..tup.getconfig("TRACE")
+end
+
 
 -- Generate Tup Rules ----------------------------------------------------------
 
@@ -140,12 +140,11 @@ void AsciiProtocol::cmd_set_position(char * pStr, bool use_checksum) {
     } else {
         Axis& axis = axes[motor_number];
         axis.controller_.config_.control_mode = Controller::CONTROL_MODE_POSITION_CONTROL;
-        axis.controller_.input_pos_ = pos_setpoint;
         if (numscan >= 3)
             axis.controller_.input_vel_ = vel_feed_forward;
         if (numscan >= 4)
             axis.controller_.input_torque_ = torque_feed_forward;
-        axis.controller_.input_pos_updated();
+        axis.controller_.set_input_pos(pos_setpoint);
         axis.watchdog_feed();
     }
 }
@@ -166,12 +165,11 @@ void AsciiProtocol::cmd_set_position_wl(char * pStr, bool use_checksum) {
     } else {
         Axis& axis = axes[motor_number];
         axis.controller_.config_.control_mode = Controller::CONTROL_MODE_POSITION_CONTROL;
-        axis.controller_.input_pos_ = pos_setpoint;
         if (numscan >= 3)
             axis.controller_.config_.vel_limit = vel_limit;
         if (numscan >= 4)
             axis.motor_.config_.torque_lim = torque_lim;
-        axis.controller_.input_pos_updated();
+        axis.controller_.set_input_pos(pos_setpoint);
         axis.watchdog_feed();
     }
 }
@@ -260,8 +258,7 @@ void AsciiProtocol::cmd_set_trapezoid_trajectory(char* pStr, bool use_checksum)
         Axis& axis = axes[motor_number];
         axis.controller_.config_.input_mode = Controller::INPUT_MODE_TRAP_TRAJ;
         axis.controller_.config_.control_mode = Controller::CONTROL_MODE_POSITION_CONTROL;
-        axis.controller_.input_pos_ = goal_point;
-        axis.controller_.input_pos_updated();
+        axis.controller_.set_input_pos(goal_point);
         axis.watchdog_feed();
     }
 }
@@ -151,7 +151,7 @@ void CANSimple::nmt_callback(const Axis& axis, const can_Message_t& msg) {
 }
 
 void CANSimple::estop_callback(Axis& axis, const can_Message_t& msg) {
-    axis.error_ |= Axis::ERROR_ESTOP_REQUESTED;
+    axis.set_error(Axis::ERROR_ESTOP_REQUESTED);
 }
 
 bool CANSimple::get_motor_error_callback(const Axis& axis) {
@@ -237,16 +237,15 @@ bool CANSimple::get_encoder_count_callback(const Axis& axis) {
     txmsg.isExt = axis.config_.can.is_extended;
     txmsg.len = 8;
 
-    can_setSignal<int32_t>(txmsg, axis.encoder_.shadow_count_, 0, 32, true);
+    can_setSignal<int32_t>(txmsg, (int32_t)axis.encoder_.shadow_count_, 0, 32, true);
     can_setSignal<int32_t>(txmsg, axis.encoder_.count_in_cpr_, 32, 32, true);
     return canbus_->send_message(txmsg);
 }
 
 void CANSimple::set_input_pos_callback(Axis& axis, const can_Message_t& msg) {
-    axis.controller_.input_pos_ = can_getSignal<float>(msg, 0, 32, true);
     axis.controller_.input_vel_ = can_getSignal<int16_t>(msg, 32, 16, true, 0.001f, 0);
     axis.controller_.input_torque_ = can_getSignal<int16_t>(msg, 48, 16, true, 0.001f, 0);
-    axis.controller_.input_pos_updated();
+    axis.controller_.set_input_pos(can_getSignal<float>(msg, 0, 32, true));
 }
 
 void CANSimple::set_input_vel_callback(Axis& axis, const can_Message_t& msg) {
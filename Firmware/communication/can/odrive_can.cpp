@@ -5,6 +5,7 @@
 
 #include "freertos_vars.h"
 #include "utils.hpp"
+#include "trace.hpp"
 
 // Safer context handling via maps instead of arrays
 // #include <unordered_map>
@@ -93,6 +94,8 @@ bool ODriveCAN::set_baud_rate(uint32_t baud_rate) {
 }
 
 void ODriveCAN::process_rx_fifo(uint32_t fifo) {
+    max_rx_fifo_usage_ = std::max(max_rx_fifo_usage_, HAL_CAN_GetRxFifoFillLevel(handle_, fifo));
+
     while (HAL_CAN_GetRxFifoFillLevel(handle_, fifo)) {
         CAN_RxHeaderTypeDef header;
         can_Message_t rxmsg;
@@ -102,6 +105,7 @@ void ODriveCAN::process_rx_fifo(uint32_t fifo) {
         rxmsg.id = rxmsg.isExt ? header.ExtId : header.StdId;  // If it's an extended message, pass the extended ID
         rxmsg.len = header.DLC;
         rxmsg.rtr = header.RTR;
+        TRACE(CAN_RX, rxmsg.id, rxmsg.len);
 
         // TODO: this could be optimized with an ahead-of-time computed
         // index-to-filter map
@@ -142,7 +146,10 @@ bool ODriveCAN::send_message(const can_Message_t &txmsg) {
         return false;
     }
     
-    return HAL_CAN_AddTxMessage(handle_, &header, (uint8_t*)txmsg.buf, &retTxMailbox) == HAL_OK;
+    TRACE(CAN_TX, txmsg.id, txmsg.len);
+    bool success = HAL_CAN_AddTxMessage(handle_, &header, (uint8_t*)txmsg.buf, &retTxMailbox) == HAL_OK;
+    max_tx_mailbox_usage_ = std::max(max_tx_mailbox_usage_, 3 - HAL_CAN_GetTxMailboxesFreeLevel(handle_));
+    return success;
 }
 
 //void ODriveCAN::set_error(Error error) {
@@ -42,6 +42,9 @@ public:
     osThreadId thread_id_;
     const uint32_t stack_size_ = 1024;  // Bytes
 
+    uint32_t max_tx_mailbox_usage_ = 0; // high-water mark of occupied TX mailboxes
+    uint32_t max_rx_fifo_usage_ = 0;    // high-water mark of either RX FIFO
+
 private:
     static const uint8_t kCanFifoNone = 0xff;
 
@@ -58,6 +58,7 @@ void Stm32UartTxStream::start_write(cbufptr_t buffer, TransferHandle* handle, Ca
 
     completer_ = completer;
     tx_end_ = buffer.begin() + chunk;
+    TRACE(UART_TX, 0, chunk);
 
     if (handle) {
         *handle = reinterpret_cast<TransferHandle>(this);
@@ -94,6 +95,7 @@ void Stm32UartRxStream::cancel_read(TransferHandle transfer_handle) {
 
 void Stm32UartRxStream::did_receive(uint8_t* buffer, size_t length) {
     // This can be called even if there was no RX operation in progress
+    TRACE(UART_RX, 0, length);
 
     bufptr_t rx_buf = rx_buf_;
 
@@ -133,6 +135,10 @@ static void uart_server_thread(void * ctx) {
             continue;
         }
 
+        // See usb_server_thread()
+        odrv.system_stats_.max_queue_usage_uart = std::max(odrv.system_stats_.max_queue_usage_uart,
+                (uint32_t)uxQueueMessagesWaiting(uart_event_queue) + 1);
+
         switch (event.value.v) {
             case 1: {
                 // This event is triggered by the control loop at 8kHz. This should be
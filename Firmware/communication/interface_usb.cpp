@@ -80,6 +80,7 @@ void Stm32UsbTxStream::start_write(cbufptr_t buffer, TransferHandle* handle, Cal
 
     completer_ = completer;
     tx_end_ = buffer.end();
+    TRACE(USB_TX, endpoint_num_, buffer.size());
 
     if (
 #if HW_VERSION_MAJOR == 3 // TODO: remove preprocessor switch
@@ -164,6 +165,11 @@ static void usb_server_thread(void * ctx) {
             continue;
         }
 
+        // Events pile up while this thread is busy so the occupancy is
+        // highest right when it takes the next one
+        odrv.system_stats_.max_queue_usage_usb = std::max(odrv.system_stats_.max_queue_usage_usb,
+                (uint32_t)uxQueueMessagesWaiting(usb_event_queue) + 1);
+
         usb_stats_.rx_cnt++;
 
         switch (event.value.v) {
@@ -221,6 +227,7 @@ static void usb_server_thread(void * ctx) {
 // Called from CDC_Receive_FS callback function, this allows the communication
 // thread to handle the incoming data
 void usb_rx_process_packet(uint8_t *buf, uint32_t len, uint8_t endpoint_pair) {
+    TRACE(USB_RX, endpoint_pair, len);
     if (endpoint_pair == CDC_OUT_EP && usb_cdc_rx_stream.rx_end_) {
         usb_cdc_rx_stream.rx_end_ += len;
         osMessagePut(usb_event_queue, 5, 0);
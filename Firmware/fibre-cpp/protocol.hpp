@@ -23,6 +23,7 @@ typedef struct {
     uint16_t endpoint_id;
 } endpoint_ref_t;
 
+class Introspectable;
 
 namespace fibre {
 // These symbols are defined in the autogenerated endpoints.hpp
@@ -34,6 +35,7 @@ bool endpoint_handler(int idx, cbufptr_t* input_buffer, bufptr_t* output_buffer)
 bool endpoint0_handler(cbufptr_t* input_buffer, bufptr_t* output_buffer);
 bool is_endpoint_ref_valid(endpoint_ref_t endpoint_ref);
 bool set_endpoint_from_float(endpoint_ref_t endpoint_ref, float value);
+bool resolve_endpoint_ref(endpoint_ref_t endpoint_ref, Introspectable* result);
 }
 
 
@@ -251,6 +253,18 @@ template<typename T>
 bool set_from_float(float value, T* property) {
     return set_from_float_ex<T>(value, property, 0);
 }
+template<typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+bool get_as_float_ex(T value, float* result, int) {
+    return *result = static_cast<float>(value), true;
+}
+template<typename T>
+bool get_as_float_ex(T value, float* result, ...) {
+    return false;
+}
+template<typename T>
+bool get_as_float(T value, float* result) {
+    return get_as_float_ex<T>(value, result, 0);
+}
 }
 
 
@@ -8,6 +8,8 @@
 extern osSemaphoreId sem_usb_irq;
 extern osMessageQId uart_event_queue;
 extern osMessageQId usb_event_queue;
+extern const uint32_t uart_event_queue_length;
+extern const uint32_t usb_event_queue_length;
 extern osSemaphoreId sem_can;
 
 extern osThreadId defaultTaskHandle;
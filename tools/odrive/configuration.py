@@ -4,7 +4,7 @@ import os
 import tempfile
 import fibre.libfibre
 import odrive
-from odrive.utils import OperationAbortedException, yes_no_prompt
+from odrive.utils import OperationAbortedException, yes_no_prompt, eccentricity_lut_read, eccentricity_lut_write
 
 def obj_to_path(root, obj):
     for k in dir(root):
@@ -52,6 +52,17 @@ def set_dict(obj, path, config_dict):
                 errors.append("Could not restore {}: {}".format(name, str(ex)))
     return errors
 
+def get_encoders(device):
+    """
+    Returns (name, encoder) of the axes whose encoder has an eccentricity
+    table. The table is saved with the configuration but is not part of a
+    config object, so it is handled separately.
+    """
+    for k in sorted(dir(device)):
+        encoder = getattr(getattr(device, k), 'encoder', None) if k.startswith('axis') else None
+        if not encoder is None and hasattr(encoder, '_eccentricity_lut_raw_property'):
+            yield k, encoder
+
 def get_temp_config_filename(device):
     serial_number = odrive.get_serial_number_str_sync(device)
     safe_serial_number = ''.join(filter(str.isalnum, serial_number))
@@ -74,6 +85,8 @@ def backup_config(device, filename, logger):
             raise OperationAbortedException()
 
     data = get_dict(device, device, False)
+    for name, encoder in get_encoders(device):
+        data.setdefault(name, {}).setdefault('encoder', {})['eccentricity_lut'] = eccentricity_lut_read(encoder)
     with open(filename, 'w') as file:
         json.dump(data, file)
     logger.info("Configuration saved.")
@@ -90,7 +103,17 @@ def restore_config(device, filename, logger):
         data = json.load(file)
 
     logger.info("Restoring configuration from {}...".format(filename))
+    luts = {name: data[name]['encoder'].pop('eccentricity_lut')
+            for name in data if 'eccentricity_lut' in data[name].get('encoder', {})}
     errors = set_dict(device, "", data)
+    for name, encoder in get_encoders(device):
+        if name in luts:
+            try:
+                eccentricity_lut_write(encoder, luts.pop(name))
+            except Exception as ex:
+                errors.append("Could not restore {}.encoder.eccentricity_lut: {}".format(name, str(ex)))
+    for name in luts:
+        errors.append("Could not restore {}.encoder.eccentricity_lut: property not found on device".format(name))
 
     for error in errors:
         logger.info(error)
@@ -30,6 +30,53 @@ STREAM_PROTOCOL_TYPE_ASCII_AND_STDOUT    = 3
 # ODrive.Can.Protocol
 PROTOCOL_SIMPLE                          = 0x00000001
 
+# ODrive.Oscilloscope.CaptureState
+CAPTURE_STATE_IDLE                       = 0
+CAPTURE_STATE_ARMED                      = 1
+CAPTURE_STATE_TRIGGERED                  = 2
+CAPTURE_STATE_DONE                       = 3
+
+# ODrive.Trace.TraceEvent
+TRACE_EVENT_NONE                         = 0
+TRACE_EVENT_SAMPLING_BEGIN               = 1
+TRACE_EVENT_SAMPLING_END                 = 2
+TRACE_EVENT_CONTROL_LOOP_BEGIN           = 3
+TRACE_EVENT_CONTROL_LOOP_END             = 4
+TRACE_EVENT_PWM_UPDATE_BEGIN             = 5
+TRACE_EVENT_PWM_UPDATE_END               = 6
+TRACE_EVENT_USB_RX                       = 7
+TRACE_EVENT_USB_TX                       = 8
+TRACE_EVENT_UART_RX                      = 9
+TRACE_EVENT_UART_TX                      = 10
+TRACE_EVENT_CAN_RX                       = 11
+TRACE_EVENT_CAN_TX                       = 12
+
+# ODrive.Journal.JournalEntryType
+JOURNAL_ENTRY_TYPE_NONE                  = 0
+JOURNAL_ENTRY_TYPE_STATE_CHANGE          = 1
+JOURNAL_ENTRY_TYPE_ERRORS_CLEARED        = 2
+JOURNAL_ENTRY_TYPE_SYSTEM_ERROR          = 3
+JOURNAL_ENTRY_TYPE_AXIS_ERROR            = 4
+JOURNAL_ENTRY_TYPE_MOTOR_ERROR           = 5
+JOURNAL_ENTRY_TYPE_ENCODER_ERROR         = 6
+JOURNAL_ENTRY_TYPE_CONTROLLER_ERROR      = 7
+JOURNAL_ENTRY_TYPE_SENSORLESS_ESTIMATOR_ERROR = 8
+
+# ODrive.FreqResponse.FreqResponseState
+FREQ_RESPONSE_STATE_IDLE                 = 0
+FREQ_RESPONSE_STATE_RUNNING              = 1
+FREQ_RESPONSE_STATE_DONE                 = 2
+
+# ODrive.FreqResponse.ExcitationPoint
+EXCITATION_POINT_POSITION                = 0
+EXCITATION_POINT_VELOCITY                = 1
+EXCITATION_POINT_TORQUE                  = 2
+
+# ODrive.Oscilloscope.TriggerEdge
+TRIGGER_EDGE_RISING                      = 0
+TRIGGER_EDGE_FALLING                     = 1
+TRIGGER_EDGE_ANY                         = 2
+
 # ODrive.Axis.AxisState
 AXIS_STATE_UNDEFINED                     = 0
 AXIS_STATE_IDLE                          = 1
@@ -44,6 +91,12 @@ AXIS_STATE_ENCODER_DIR_FIND              = 10
 AXIS_STATE_HOMING                        = 11
 AXIS_STATE_ENCODER_HALL_POLARITY_CALIBRATION = 12
 AXIS_STATE_ENCODER_HALL_PHASE_CALIBRATION = 13
+AXIS_STATE_AUTOTUNE                      = 14
+AXIS_STATE_ENCODER_ECCENTRICITY_CALIBRATION = 15
+
+# ODrive.Encoder.Estimator
+ESTIMATOR_PLL                            = 0
+ESTIMATOR_KALMAN                         = 1
 
 # ODrive.Encoder.Mode
 ENCODER_MODE_INCREMENTAL                 = 0
@@ -102,6 +155,7 @@ AXIS_ERROR_ESTOP_REQUESTED               = 0x00004000
 AXIS_ERROR_HOMING_WITHOUT_ENDSTOP        = 0x00020000
 AXIS_ERROR_OVER_TEMP                     = 0x00040000
 AXIS_ERROR_UNKNOWN_POSITION              = 0x00080000
+AXIS_ERROR_AUTOTUNE_FAILED               = 0x00100000
 
 # ODrive.Motor.Error
 MOTOR_ERROR_NONE                         = 0x00000000
@@ -156,6 +210,7 @@ ENCODER_ERROR_ABS_SPI_TIMEOUT            = 0x00000040
 ENCODER_ERROR_ABS_SPI_COM_FAIL           = 0x00000080
 ENCODER_ERROR_ABS_SPI_NOT_READY          = 0x00000100
 ENCODER_ERROR_HALL_NOT_CALIBRATED_YET    = 0x00000200
+ENCODER_ERROR_ECCENTRICITY_CALIBRATION_FAILED = 0x00000400
 
 # ODrive.SensorlessEstimator.Error
 SENSORLESS_ESTIMATOR_ERROR_NONE          = 0x00000000
@@ -66,6 +66,18 @@ def launch_shell(args, logger):
         'dump_errors': dump_errors,
         'benchmark': benchmark,
         'oscilloscope_dump': oscilloscope_dump,
+        'oscilloscope_read': oscilloscope_read,
+        'oscilloscope_benchmark': oscilloscope_benchmark,
+        'snapshot_configure': snapshot_configure,
+        'snapshot_read': snapshot_read,
+        'freq_response_read': freq_response_read,
+        'freq_response_run': freq_response_run,
+        'trace_dump': trace_dump,
+        'trace_read': trace_read,
+        'black_box_read': black_box_read,
+        'dump_black_box': dump_black_box,
+        'journal_read': journal_read,
+        'dump_journal': dump_journal,
         'dump_interrupts': dump_interrupts,
         'dump_threads': dump_threads,
         'dump_dma': dump_dma,
@@ -126,15 +126,454 @@ def dump_errors(odrv, clear=False, printfunc = print):
     if clear:
         odrv.clear_errors()
 
-def oscilloscope_dump(odrv, num_vals, filename='oscilloscope.csv'):
+def raw_read(obj, name, n_requests, max_in_flight=64):
+    """
+    Reads the raw data property `name` of obj n_requests times (8 bytes each)
+    and returns the concatenated bytes.
+
+    Up to max_in_flight requests are issued back-to-back so that the USB round
+    trip time is only paid once per batch. The ODrive processes them in order
+    and advances its cursor by 8 bytes per request.
+    """
+    import asyncio
+    import struct
+    from fibre.libfibre import run_coroutine_threadsafe
+
+    raw_data = getattr(obj, '_' + name + '_property')
+    words = []
+    while len(words) < n_requests:
+        batch = min(max_in_flight, n_requests - len(words))
+        words += run_coroutine_threadsafe(obj._libfibre.loop,
+            lambda: asyncio.gather(*[raw_data.read() for _ in range(batch)]))
+    return struct.pack('<{}Q'.format(n_requests), *words)
+
+def oscilloscope_read(odrv, max_in_flight=64):
+    """
+    Reads the last capture of the oscilloscope and returns one list of samples
+    per channel.
+
+    The capture is read in its storage format through `oscilloscope.raw_data`,
+    see raw_read().
+    """
+    import struct
+
+    scope = odrv.oscilloscope
+    if scope.state != CAPTURE_STATE_DONE:
+        raise Exception("the oscilloscope has no finished capture")
+
+    size = scope.size
+    scales = [scope.get_scale(ch) for ch in range(scope.n_channels)]
+    frame_format = '<' + ''.join('h' if scale else 'f' for scale in scales)
+    frame_size = struct.calcsize(frame_format)
+    n_requests = (size * frame_size + 7) // 8
+
+    scope.raw_offset = 0
+    buf = raw_read(scope, 'raw_data', n_requests, max_in_flight)
+
+    # The requests are processed in order so the offset tells if any got lost
+    if scope.raw_offset != 8 * n_requests:
+        raise Exception("oscilloscope readout out of sync")
+
+    channels = [[] for _ in scales]
+    for frame in struct.iter_unpack(frame_format, buf[:size * frame_size]):
+        for ch, (val, scale) in enumerate(zip(frame, scales)):
+            channels[ch].append(val * scale if scale else val)
+    return channels
+
+def oscilloscope_dump(odrv, num_vals=None, filename='oscilloscope.csv'):
+    """
+    Writes the last capture of the oscilloscope to a CSV file with one column
+    per channel. If num_vals is None, the whole capture is written.
+    """
+    channels = oscilloscope_read(odrv)
+    if num_vals is None:
+        num_vals = odrv.oscilloscope.size
     with open(filename, 'w') as f:
-        for x in range(num_vals):
-            f.write(str(odrv.oscilloscope.get_val(x)))
+        for frame in list(zip(*channels))[:num_vals]:
+            f.write(','.join(str(val) for val in frame))
             f.write('\n')
 
+def oscilloscope_benchmark(odrv, n_slow=256):
+    """
+    Measures the oscilloscope readout rate in samples per second.
+
+    Captures the control loop counter and reads the capture back once with
+    get_val() (only the first n_slow samples) and once in bulk with
+    oscilloscope_read(). Both must agree and the counter must increase by
+    one per sample. This overwrites the oscilloscope settings.
+    """
+    scope = odrv.oscilloscope
+    scope.channel0.endpoint = odrv._n_evt_control_loop_property
+    scope.channel0.scale = 0
+    for ch in range(1, 8):
+        getattr(scope, 'channel' + str(ch)).endpoint = None
+    scope.trigger_endpoint = None
+    scope.decimation = 1
+    scope.pretrigger = 0
+    if not scope.arm():
+        raise Exception("failed to arm the oscilloscope")
+    while scope.state != CAPTURE_STATE_DONE:
+        time.sleep(0.01)
+
+    start = time.monotonic()
+    slow = [scope.get_val(i) for i in range(n_slow)]
+    slow_rate = n_slow / (time.monotonic() - start)
+
+    start = time.monotonic()
+    fast = oscilloscope_read(odrv)[0]
+    fast_duration = time.monotonic() - start
+    fast_rate = len(fast) / fast_duration
+
+    if fast[:n_slow] != slow:
+        raise Exception("bulk readout doesn't match get_val()")
+    if any((b - a) != 1 for a, b in zip(fast[:-1], fast[1:]) if b < 2**24):
+        raise Exception("samples are not contiguous")
+
+    print("get_val():          {:10.0f} samples/s".format(slow_rate))
+    print("oscilloscope_read(): {:9.0f} samples/s ({} samples in {:.1f} ms)".format(fast_rate, len(fast), fast_duration * 1000))
+
+# Number of signals of the snapshots that were configured with
+# snapshot_configure() or read before, by id() of the snapshot object
+_snapshot_n_signals = {}
+
+def snapshot_configure(odrv, properties, decimation=1):
+    """
+    Sets up the snapshot to sample the specified properties (at most 12) in
+    the same control loop iteration, for example
+    `snapshot_configure(odrv0, [odrv0.axis0.encoder._pos_estimate_property, odrv0._vbus_voltage_property])`.
+    Returns the number of valid signals.
+    """
+    snapshot = odrv.snapshot
+    if len(properties) > 12:
+        raise Exception("the snapshot supports at most 12 signals")
+    for i in range(12):
+        setattr(snapshot, 'signal{}'.format(i), properties[i] if i < len(properties) else None)
+    snapshot.decimation = decimation
+    n_signals = snapshot.apply() # also resets read_offset
+    _snapshot_n_signals[id(snapshot)] = n_signals
+    return n_signals
+
+def snapshot_read(odrv):
+    """
+    Reads the latest snapshot. Returns a tuple (seq, timestamp, values) where
+    values is a list with one value per signal. All values were sampled in the
+    same control loop iteration.
+
+    The layout is taken from the last snapshot_configure() call and
+    `read_offset` wraps around to 0 after every frame, so normally this is a
+    single batch of back-to-back reads, i.e. about one USB round trip. The
+    layout is only read from the ODrive (and the offset reset) on the first
+    call or after a failed read.
+    """
+    import struct
+
+    snapshot = odrv.snapshot
+    n_signals = _snapshot_n_signals.pop(id(snapshot), None)
+    if n_signals is None:
+        n_signals = snapshot.n_signals
+        snapshot.read_offset = 0
+    if not n_signals:
+        raise Exception("the snapshot has no signals, call snapshot_configure() first")
+
+    # Same as Snapshot::size_
+    n_requests = (8 + 4 * n_signals + 7) // 8
+    buf = raw_read(snapshot, 'raw_data', n_requests)
+    _snapshot_n_signals[id(snapshot)] = n_signals
+
+    seq, timestamp, *values = struct.unpack_from('<II{}f'.format(n_signals), buf)
+    return seq, timestamp, values
+
+def freq_response_read(axis):
+    """
+    Reads the finished points of the frequency response analyzer of an axis.
+    Returns a list of (frequency, magnitude, phase, command_magnitude,
+    command_phase) tuples. See `odrv0.axis0.controller.freq_response`.
+    """
+    import struct
+
+    freq_response = axis.controller.freq_response
+    n_points = freq_response.n_done
+    n_requests = (n_points * 20 + 7) // 8
+    if not n_requests:
+        return []
+
+    freq_response.read_offset = 0
+    data = raw_read(freq_response, 'raw_data', n_requests)
+    return [struct.unpack_from('<5f', data, 20 * i) for i in range(n_points)]
+
+def freq_response_run(axis, excitation_point=EXCITATION_POINT_VELOCITY, amplitude=0.5,
+                      f_start=2.0, f_end=1000.0, n_points=24, plot=True):
+    """
+    Runs a frequency response sweep on an axis that is in closed loop control
+    and returns the result of `freq_response_read()`. If plot is True, the
+    plant response (velocity estimate / torque command) and the sensitivity
+    (torque command / excitation) are shown as Bode plots.
+    """
+    import math
+
+    freq_response = axis.controller.freq_response
+    freq_response.excitation_point = excitation_point
+    freq_response.amplitude = amplitude
+    freq_response.f_start = f_start
+    freq_response.f_end = f_end
+    freq_response.n_points = n_points
+    if not freq_response.start():
+        raise Exception("invalid frequency response settings")
+
+    try:
+        while freq_response.state == FREQ_RESPONSE_STATE_RUNNING:
+            if axis.current_state != AXIS_STATE_CLOSED_LOOP_CONTROL:
+                raise Exception("axis left closed loop control")
+            time.sleep(0.1)
+    finally:
+        freq_response.stop()
+
+    points = freq_response_read(axis)
+
+    if plot:
+        import matplotlib.pyplot as plt
+        freqs = [p[0] for p in points]
+        fig, (ax_mag, ax_phase) = plt.subplots(2, 1, sharex=True)
+        for mag, phase, label in ((1, 2, "plant [turn/s / Nm]"), (3, 4, "sensitivity")):
+            ax_mag.loglog(freqs, [p[mag] for p in points], label=label)
+            ax_phase.semilogx(freqs, [math.degrees(p[phase]) for p in points], label=label)
+        ax_mag.set_ylabel("magnitude")
+        ax_phase.set_ylabel("phase [deg]")
+        ax_phase.set_xlabel("frequency [Hz]")
+        ax_mag.legend()
+        plt.show()
+
+    return points
+
+def eccentricity_lut_read(encoder):
+    """
+    Reads the eccentricity table of an encoder (see
+    `AXIS_STATE_ENCODER_ECCENTRICITY_CALIBRATION`). Returns a list of 128 ints
+    in units of 1/16 count.
+    """
+    import struct
+
+    n_requests = 128 * 2 // 8
+    encoder.eccentricity_lut_offset = 0
+    buf = raw_read(encoder, 'eccentricity_lut_raw', n_requests)
+    if encoder.eccentricity_lut_offset != 8 * n_requests:
+        raise Exception("eccentricity table readout out of sync")
+    return list(struct.unpack('<128h', buf))
+
+def eccentricity_lut_write(encoder, lut):
+    """
+    Writes an eccentricity table that was read with `eccentricity_lut_read()`.
+    Run `save_configuration()` afterwards to keep it.
+    """
+    import struct
+
+    if len(lut) != 128:
+        raise Exception("the eccentricity table has 128 entries")
+    words = struct.unpack('<32Q', struct.pack('<128h', *lut))
+    encoder.eccentricity_lut_offset = 0
+    for word in words:
+        encoder.write_eccentricity_lut(word)
+
+def trace_read(odrv, max_in_flight=64):
+    """
+    Reads all records that are currently in the trace ring of the ODrive.
+    Returns a list of (timestamp, event, arg0, arg1) tuples in the order in
+    which they were written. The timestamps are in CPU clocks.
+
+    Tracing is paused during the readout so that the ring is not overwritten.
+    """
+    import struct
+
+    trace = odrv.trace
+    was_enabled = trace.enabled
+    trace.enabled = False
+    try:
+        end = trace.write_idx
+        start = max(0, end - trace.size)
+        n_requests = 2 * (end - start)
+
+        trace.read_idx = start
+        buf = raw_read(trace, 'raw_data', n_requests, max_in_flight)
+
+        # The requests are processed in order so the index tells if any got lost
+        if trace.read_idx != end:
+            raise Exception("trace readout out of sync")
+    finally:
+        trace.enabled = was_enabled
+
+    records = []
+    for timestamp, event, _, arg0, arg1 in struct.iter_unpack('<IHHII', buf):
+        if event != TRACE_EVENT_NONE:
+            records.append((timestamp, event, arg0, arg1))
+    return records
+
+def trace_to_chrome(records, clock_hz=168e6):
+    """
+    Converts trace records as returned by trace_read() to a dict in the Chrome
+    trace event format. Events whose name ends with _BEGIN/_END become
+    duration events, all others become instant events.
+    """
+    names = {val: name[len('TRACE_EVENT_'):].lower()
+             for name, val in odrive.enums.__dict__.items() if name.startswith('TRACE_EVENT_')}
+    tracks = {'sampling': 'control ISR', 'control_loop': 'control ISR', 'pwm_update': 'control ISR',
+              'usb': 'USB', 'uart': 'UART', 'can': 'CAN'}
+    tids = {track: i for i, track in enumerate(sorted(set(tracks.values())) + ['other'])}
+
+    events = [{'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': tid, 'args': {'name': track}}
+              for track, tid in tids.items()]
+
+    # The cycle counter wraps around every few seconds and records of
+    # interrupted writers can be slightly out of order, so the timestamps are
+    # unwrapped with signed deltas.
+    clocks = 0
+    last_timestamp = records[0][0] if records else 0
+    for timestamp, event, arg0, arg1 in records:
+        clocks += ((timestamp - last_timestamp + 0x80000000) & 0xffffffff) - 0x80000000
+        last_timestamp = timestamp
+
+        name = names.get(event, 'event_{}'.format(event))
+        if name.endswith('_begin'):
+            name, phase = name[:-len('_begin')], 'B'
+        elif name.endswith('_end'):
+            name, phase = name[:-len('_end')], 'E'
+        else:
+            phase = 'i'
+        track = next((t for prefix, t in tracks.items() if name.startswith(prefix)), 'other')
+
+        evt = {'name': name, 'ph': phase, 'ts': clocks / clock_hz * 1e6,
+               'pid': 0, 'tid': tids[track], 'args': {'arg0': arg0, 'arg1': arg1}}
+        if phase == 'i':
+            evt['s'] = 't'
+        events.append(evt)
+
+    return {'traceEvents': events, 'displayTimeUnit': 'ns'}
+
+def trace_dump(odrv, filename='trace.json'):
+    """
+    Reads the trace ring of the ODrive and writes it to a JSON file that can be
+    opened in chrome://tracing or https://ui.perfetto.dev.
+    """
+    import json
+    records = trace_read(odrv)
+    with open(filename, 'w') as f:
+        json.dump(trace_to_chrome(records), f)
+    print("wrote {} records to {}".format(len(records), filename))
+
+def black_box_read(odrv, index=0, max_in_flight=64):
+    """
+    Reads an incident of the black box recorder. Index 0 is the most recent
+    incident. Returns a dict with the error information at the time of the
+    incident and a list of frames in chronological order, or None if there is
+    no such incident.
+    """
+    import struct
+
+    bb = odrv.black_box
+    size = bb.select_incident(index)
+    if not size:
+        return None
+
+    n_requests = (size + 7) // 8
+    buf = raw_read(bb, 'raw_data', n_requests, max_in_flight)[:size]
+    if bb.read_offset != 8 * n_requests:
+        raise Exception("black box readout out of sync")
+
+    header_format = '<IIIIHHHBB'
+    _, _, seq, uptime, n_frames, frame_size, decimation, trigger_axis, n_axes = struct.unpack_from(header_format, buf)
+    offset = struct.calcsize(header_format)
+    incident = {'seq': seq, 'uptime': uptime / 1000, 'decimation': decimation, 'trigger_axis': trigger_axis, 'axes': []}
+    for _ in range(n_axes):
+        motor_error, axis_error, state = struct.unpack_from('<QII', buf, offset)
+        offset += 16
+        incident['axes'].append({'motor_error': motor_error, 'axis_error': axis_error, 'state': state})
+
+    axis_fields = ['Iq_measured', 'Id_measured', 'vel_estimate', 'pos_estimate', 'fet_temp', 'motor_temp', 'state']
+    incident['frames'] = []
+    for i in range(n_frames):
+        vals = struct.unpack_from('<If' + 'ffffffI' * n_axes, buf, offset + i * frame_size)
+        incident['frames'].append({
+            'timestamp': vals[0],
+            'vbus_voltage': vals[1],
+            'axes': [dict(zip(axis_fields, vals[2 + 7 * a:9 + 7 * a])) for a in range(n_axes)]
+        })
+    return incident
+
+def dump_black_box(odrv):
+    """
+    Prints a summary of all incidents of the black box recorder.
+    """
+    bb = odrv.black_box
+    print("{} incidents{}".format(bb.n_incidents, " (one pending)" if bb.pending else ""))
+    for index in range(bb.n_incidents):
+        incident = black_box_read(odrv, index)
+        print("#{} at {:.3f}s uptime, {} samples, triggered by axis{}".format(
+            incident['seq'], incident['uptime'], len(incident['frames']), incident['trigger_axis']))
+        for i, axis in enumerate(incident['axes']):
+            print("  axis{}: error 0x{:x}, motor error 0x{:x}, state {}".format(
+                i, axis['axis_error'], axis['motor_error'], axis['state']))
+
 data_rate = 200
 plot_rate = 10
 num_samples = 500
+def journal_read(odrv, max_in_flight=64):
+    """
+    Reads all entries that are currently in the journal of the ODrive.
+    Returns a list of dicts in the order in which the entries were written.
+    """
+    import struct
+
+    journal = odrv.journal
+    end = journal.write_idx
+    start = max(0, end - journal.size)
+    n_requests = 3 * (end - start)
+
+    journal.read_idx = start
+    buf = raw_read(journal, 'raw_data', n_requests, max_in_flight)
+    if journal.read_idx != end:
+        raise Exception("journal readout out of sync")
+
+    entries = []
+    for timestamp, entry_type, _, error, uptime, axis, state, _ in struct.iter_unpack('<IHHQIBBH', buf):
+        if entry_type != JOURNAL_ENTRY_TYPE_NONE:
+            entries.append({'timestamp': timestamp, 'type': entry_type, 'error': error,
+                            'uptime': uptime / 1000, 'axis': None if axis == 0xff else axis, 'state': state})
+    return entries
+
+def dump_journal(odrv, printfunc = print):
+    """
+    Prints the errors and state changes in the journal of the ODrive in the
+    order in which they happened.
+    """
+    def decode(prefix, value):
+        names = {v: k[len(prefix):] for k, v in odrive.enums.__dict__.items() if k.startswith(prefix)}
+        return names.get(value, str(value))
+
+    error_prefixes = {
+        JOURNAL_ENTRY_TYPE_SYSTEM_ERROR: ("system", "ODRIVE_ERROR_"),
+        JOURNAL_ENTRY_TYPE_AXIS_ERROR: ("axis", "AXIS_ERROR_"),
+        JOURNAL_ENTRY_TYPE_MOTOR_ERROR: ("motor", "MOTOR_ERROR_"),
+        JOURNAL_ENTRY_TYPE_ENCODER_ERROR: ("encoder", "ENCODER_ERROR_"),
+        JOURNAL_ENTRY_TYPE_CONTROLLER_ERROR: ("controller", "CONTROLLER_ERROR_"),
+        JOURNAL_ENTRY_TYPE_SENSORLESS_ESTIMATOR_ERROR: ("sensorless_estimator", "SENSORLESS_ESTIMATOR_ERROR_"),
+    }
+
+    for entry in journal_read(odrv):
+        where = "      " if entry['axis'] is None else "axis{} ".format(entry['axis'])
+        line = "{:10.3f}s {}".format(entry['uptime'], where)
+        if entry['type'] == JOURNAL_ENTRY_TYPE_STATE_CHANGE:
+            line += "-> " + decode("AXIS_STATE_", entry['state'])
+        elif entry['type'] == JOURNAL_ENTRY_TYPE_ERRORS_CLEARED:
+            line += "errors cleared"
+        elif entry['type'] in error_prefixes:
+            name, prefix = error_prefixes[entry['type']]
+            bits = [decode(prefix, 1 << bit) for bit in range(64) if entry['error'] & (1 << bit)]
+            line += _VT100Colors['red'] + name + ": " + ", ".join(bits) + _VT100Colors['default']
+            if entry['axis'] is not None:
+                line += " (in " + decode("AXIS_STATE_", entry['state']) + ")"
+        else:
+            line += "unknown entry type {}".format(entry['type'])
+        printfunc(line)
+
 def start_liveplotter(get_var_callback):
     """
     Starts a liveplotter.
@@ -316,13 +755,9 @@ def print_drv_regs(name, motor):
     print("Control Reg 2: " + str(ctrl_reg_2) + " (" + format(ctrl_reg_2, '#09b') + ")")
 
 def show_oscilloscope(odrv):
-    size = 18000
-    values = []
-    for i in range(size):
-        values.append(odrv.oscilloscope.get_val(i))
-
     import matplotlib.pyplot as plt
-    plt.plot(values)
+    for values in oscilloscope_read(odrv):
+        plt.plot(values)
     plt.show()
 
 def rate_test(device):
@@ -510,18 +945,56 @@ def dump_threads(odrv):
     if len(good_keys) > len(set(keys)):
         print("Warning: incomplete thread information for threads {}".format(set(keys) - good_keys))
 
-    print("| Name    | Stack Size [B] | Max Ever Stack Usage [B] | Prio |")
-    print("|---------|----------------|--------------------------|------|")
+    def fmt_load(k):
+        load = getattr(odrv.system_stats, "cpu_load_" + k, None)
+        return "-" if load is None else "{:.1f}%".format(load * 100)
+
+    print("| Name    | Stack Size [B] | Max Ever Stack Usage [B] | Prio | CPU Load |")
+    print("|---------|----------------|--------------------------|------|----------|")
     for k in sorted(good_keys):
         sz = getattr(odrv.system_stats, "stack_size_" + k)
         use = getattr(odrv.system_stats, "max_stack_usage_" + k)
-        print("| {} | {} | {} | {} |".format(
+        print("| {} | {} | {} | {} | {} |".format(
             k.ljust(7),
             str(sz).rjust(14),
             "{} ({:.1f}%)".format(use, use / sz * 100).rjust(24),
-            str(getattr(odrv.system_stats, "prio_" + k)).rjust(4)
+            str(getattr(odrv.system_stats, "prio_" + k)).rjust(4),
+            fmt_load(k).rjust(8)
         ))
 
+    if hasattr(odrv, "get_thread_stats"):
+        print("")
+        print("| Thread           | Min Free Stack [B] | Prio | CPU Load |")
+        print("|------------------|--------------------|------|----------|")
+        for i in range(odrv.system_stats.n_threads):
+            name0, name1, min_stack_space, prio, cpu_load = odrv.get_thread_stats(i)
+            name = (name0.to_bytes(8, 'little') + name1.to_bytes(8, 'little')).rstrip(b'\0').decode(errors='replace')
+            print("| {} | {} | {} | {} |".format(
+                name.ljust(16),
+                str(min_stack_space).rjust(18),
+                str(prio).rjust(4),
+                "{:.1f}%".format(cpu_load * 100).rjust(8)
+            ))
+
+    if hasattr(odrv.system_stats, "control_isr"):
+        isr = odrv.system_stats.control_isr
+        print("")
+        print("idle: {}, control interrupts: {:.1f}% (window {} ms)".format(
+            fmt_load("idle"), isr.load * 100, odrv.config.cpu_load_window))
+        print("control interrupt headroom: {} clocks (last window), {} clocks (since reset)".format(
+            isr.last_window_min_headroom, isr.min_headroom))
+
+    stats = odrv.system_stats
+    if hasattr(stats, "max_stack_usage_isr"):
+        print("")
+        print("interrupt stack: {} of {} B ({:.1f}%)".format(
+            stats.max_stack_usage_isr, stats.stack_size_isr, stats.max_stack_usage_isr / stats.stack_size_isr * 100))
+        print("event queues: usb {}/{}, uart {}/{}".format(
+            stats.max_queue_usage_usb, stats.queue_size_usb, stats.max_queue_usage_uart, stats.queue_size_uart))
+        print("CAN mailboxes: tx {}/3, rx {}/3; SPI queue: {}".format(
+            stats.max_can_tx_mailbox_usage, stats.max_can_rx_fifo_usage, stats.max_spi_queue_length))
+        print("min free heap: {} B".format(stats.min_heap_space))
+
 
 def dump_dma(odrv):
     if odrv.hw_version_major == 3: